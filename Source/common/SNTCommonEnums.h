@@ -139,10 +139,18 @@ typedef NS_ENUM(NSInteger, SNTEventLogType) {
   SNTEventLogTypeProtobufStream,
   SNTEventLogTypeProtobufStreamGzip,
   SNTEventLogTypeProtobufStreamZstd,
+  SNTEventLogTypeProtobufColumnar,
   SNTEventLogTypeJSON,
   SNTEventLogTypeNull,
 };
 
+// What santad does with new events when the spool's in-memory queue is full.
+typedef NS_ENUM(NSInteger, SNTSpoolQueueFullPolicy) {
+  SNTSpoolQueueFullPolicyDrop,
+  SNTSpoolQueueFullPolicyBlock,
+  SNTSpoolQueueFullPolicyDropLowPriority,
+};
+
 // The return status of a sync.
 typedef NS_ENUM(NSInteger, SNTSyncStatusType) {
   SNTSyncStatusTypeSuccess,
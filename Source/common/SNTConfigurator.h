@@ -203,6 +203,9 @@
 ///      output is compressed as gzip.
 ///    SNTEventLogTypeProtobufStreamZstd "protobufstreamzstd": Similar to "protobufstream", but
 ///      output is compressed as zstd.
+///    SNTEventLogTypeProtobufColumnar "protobufcolumnar": Similar to "protobuf", but each file is
+///      a columnar batch, with events grouped by type and each field stored in its own compressed
+///      column.
 ///    Defaults to SNTEventLogTypeFilelog.
 ///    For mobileconfigs use EventLogType as the key and syslog or filelog strings as the value.
 ///
@@ -268,6 +271,104 @@
 ///
 @property(readonly, nonatomic) float spoolDirectoryEventMaxFlushTimeSec;
 
+///
+///  If eventLogType is set to one of the protobuf types, spoolQueueCapacity sets the maximum number
+///  of events held in memory waiting to be written to the spool directory.
+///  Defaults to 65536.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) NSUInteger spoolQueueCapacity;
+
+///
+///  Defines what happens to new events when the spool queue is full. Valid values are:
+///    SNTSpoolQueueFullPolicyDrop "drop": New events are dropped.
+///    SNTSpoolQueueFullPolicyBlock "block": The event producer waits for space in the queue.
+///    SNTSpoolQueueFullPolicyDropLowPriority "droplowpriority": Events are shed by priority. Fork,
+///      exit and close events are dropped once the queue is three quarters full, and most other
+///      events once it is seven eighths full. Execution, file access and security events are
+///      dropped only when it is full. The same order applies when spool files can't be completed
+///      or the spool is out of space, in which case some higher priority events are held in
+///      memory until space is available.
+///  Defaults to SNTSpoolQueueFullPolicyDrop.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) SNTSpoolQueueFullPolicy spoolQueueFullPolicy;
+
+///
+///  If eventLogType is set to protobufstreamzstd, spoolZstdDictionaryPath is the path to a zstd
+///  dictionary used to compress spool files. The dictionary ID is recorded in each file, and the
+///  same dictionary is needed to decode them, e.g. with `santactl printlog`. Dictionaries can be
+///  trained from existing spool files with the zstd_dictionary_trainer tool.
+///  Defaults to nil, spool files are compressed without a dictionary.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(nullable, readonly, nonatomic) NSString *spoolZstdDictionaryPath;
+
+///
+///  If eventLogType is set to protobufstreamzstd, spoolZstdCompressionLevel sets the zstd
+///  compression level used for spool files. When spoolZstdAdaptiveLevel is enabled, this is the
+///  highest level used. If eventLogType is set to protobufcolumnar, it sets the level used to
+///  compress each column.
+///  Defaults to 3.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) NSInteger spoolZstdCompressionLevel;
+
+///
+///  If eventLogType is set to protobufstreamzstd, spoolZstdWorkers sets the number of background
+///  threads used to compress spool files. When 0, compression happens on the spool's queue.
+///  Defaults to 0.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) NSUInteger spoolZstdWorkers;
+
+///
+///  If eventLogType is set to protobufstreamzstd and spoolZstdAdaptiveLevel is enabled, the
+///  compression level is lowered as events back up waiting to be spooled, and raised back towards
+///  spoolZstdCompressionLevel once the backlog clears.
+///  Defaults to NO.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) BOOL spoolZstdAdaptiveLevel;
+
+///
+///  If eventLogType is set to protobufstreamzstd and spoolZstdFrameRecords is non-zero, spool files
+///  are split into independently decompressible zstd frames of at most this many records, and end
+///  with an index of the frames. Readers can use the index to seek within files by event time.
+///  Defaults to 0 (disabled).
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) NSUInteger spoolZstdFrameRecords;
+
+///
+///  If eventLogType is set to protobufstreamzstd and spoolZstdFrameSizeKB is non-zero, spool files
+///  are split into independently decompressible zstd frames of roughly this many uncompressed KB,
+///  and end with an index of the frames. May be combined with spoolZstdFrameRecords, in which case
+///  frames end at whichever limit is reached first.
+///  Defaults to 0 (disabled).
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) NSUInteger spoolZstdFrameSizeKB;
+
+///
+///  If eventLogType is set to one of the protobufstream types and spoolStringTableEncoding is
+///  enabled, strings repeated within a spool file are written once to a per-file table and
+///  referenced from later events. Files are decoded before being exported, and can be read with
+///  santactl printlog.
+///  Defaults to NO.
+///
+///  @note: This property is KVO compliant, but should only be read once at santad startup.
+///
+@property(readonly, nonatomic) BOOL spoolStringTableEncoding;
+
 ///
 ///  If true, Santa will attempt to periodically export telemetry to configured location.
 ///  Defaults to false.
@@ -890,6 +991,13 @@
 ///
 @property(nullable, readonly, nonatomic) NSArray<NSString *> *enabledProcessAnnotations;
 
+///
+/// Number of processes the process tree may hold before dead processes are
+/// reconciled more frequently. Defaults to 65536.
+/// This property is not KVO compliant.
+///
+@property(readonly, nonatomic) NSUInteger processTreeMaxProcesses;
+
 ///
 ///  Retrieve an initialized singleton configurator object using the default file path.
 ///
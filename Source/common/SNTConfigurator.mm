@@ -146,6 +146,15 @@ static NSString *const kSpoolDirectory = @"SpoolDirectory";
 static NSString *const kSpoolDirectoryFileSizeThresholdKB = @"SpoolDirectoryFileSizeThresholdKB";
 static NSString *const kSpoolDirectorySizeThresholdMB = @"SpoolDirectorySizeThresholdMB";
 static NSString *const kSpoolDirectoryEventMaxFlushTimeSec = @"SpoolDirectoryEventMaxFlushTimeSec";
+static NSString *const kSpoolQueueCapacity = @"SpoolQueueCapacity";
+static NSString *const kSpoolQueueFullPolicy = @"SpoolQueueFullPolicy";
+static NSString *const kSpoolZstdDictionaryPath = @"SpoolZstdDictionaryPath";
+static NSString *const kSpoolZstdCompressionLevel = @"SpoolZstdCompressionLevel";
+static NSString *const kSpoolZstdWorkers = @"SpoolZstdWorkers";
+static NSString *const kSpoolZstdAdaptiveLevel = @"SpoolZstdAdaptiveLevel";
+static NSString *const kSpoolZstdFrameRecords = @"SpoolZstdFrameRecords";
+static NSString *const kSpoolZstdFrameSizeKB = @"SpoolZstdFrameSizeKB";
+static NSString *const kSpoolStringTableEncoding = @"SpoolStringTableEncoding";
 
 static NSString *const kFileAccessPolicy = @"FileAccessPolicy";
 static NSString *const kFileAccessPolicyPlist = @"FileAccessPolicyPlist";
@@ -191,6 +200,7 @@ static NSString *const kMetricExportTimeout = @"MetricExportTimeout";
 static NSString *const kMetricExtraLabels = @"MetricExtraLabels";
 
 static NSString *const kEnabledProcessAnnotations = @"EnabledProcessAnnotations";
+static NSString *const kProcessTreeMaxProcesses = @"ProcessTreeMaxProcesses";
 
 // The keys managed by a sync server or mobileconfig.
 static NSString *const kClientModeKey = @"ClientMode";
@@ -331,6 +341,15 @@ static NSString *const kModeTransitionKey = @"ModeTransition";
       kSpoolDirectoryFileSizeThresholdKB : number,
       kSpoolDirectorySizeThresholdMB : number,
       kSpoolDirectoryEventMaxFlushTimeSec : number,
+      kSpoolQueueCapacity : number,
+      kSpoolQueueFullPolicy : string,
+      kSpoolZstdDictionaryPath : string,
+      kSpoolZstdCompressionLevel : number,
+      kSpoolZstdWorkers : number,
+      kSpoolZstdAdaptiveLevel : number,
+      kSpoolZstdFrameRecords : number,
+      kSpoolZstdFrameSizeKB : number,
+      kSpoolStringTableEncoding : number,
       kFileAccessPolicy : dictionary,
       kFileAccessPolicyPlist : string,
       kFileAccessBlockMessage : string,
@@ -363,6 +382,7 @@ static NSString *const kModeTransitionKey = @"ModeTransition";
       kEntitlementsPrefixFilterKey : array,
       kEntitlementsTeamIDFilterKey : array,
       kEnabledProcessAnnotations : array,
+      kProcessTreeMaxProcesses : number,
       kTelemetryKey : array,
     };
 
@@ -629,6 +649,42 @@ static SNTConfigurator *sharedConfigurator = nil;
   return [self configStateSet];
 }
 
++ (NSSet *)keyPathsForValuesAffectingSpoolQueueCapacity {
+  return [self configStateSet];
+}
+
++ (NSSet *)keyPathsForValuesAffectingSpoolQueueFullPolicy {
+  return [self configStateSet];
+}
+
++ (NSSet *)keyPathsForValuesAffectingSpoolZstdDictionaryPath {
+  return [self configStateSet];
+}
+
++ (NSSet *)keyPathsForValuesAffectingSpoolZstdCompressionLevel {
+  return [self configStateSet];
+}
+
++ (NSSet *)keyPathsForValuesAffectingSpoolZstdWorkers {
+  return [self configStateSet];
+}
+
++ (NSSet *)keyPathsForValuesAffectingSpoolZstdAdaptiveLevel {
+  return [self configStateSet];
+}
+
++ (NSSet *)keyPathsForValuesAffectingSpoolZstdFrameRecords {
+  return [self configStateSet];
+}
+
++ (NSSet *)keyPathsForValuesAffectingSpoolZstdFrameSizeKB {
+  return [self configStateSet];
+}
+
++ (NSSet *)keyPathsForValuesAffectingSpoolStringTableEncoding {
+  return [self configStateSet];
+}
+
 + (NSSet *)keyPathsForValuesAffectingFileAccessPolicy {
   return [self configStateSet];
 }
@@ -1232,6 +1288,8 @@ static SNTConfigurator *sharedConfigurator = nil;
     return SNTEventLogTypeProtobufStreamGzip;
   } else if ([logType isEqualToString:@"protobufstreamzstd"]) {
     return SNTEventLogTypeProtobufStreamZstd;
+  } else if ([logType isEqualToString:@"protobufcolumnar"]) {
+    return SNTEventLogTypeProtobufColumnar;
   } else if ([logType isEqualToString:@"syslog"]) {
     return SNTEventLogTypeSyslog;
   } else if ([logType isEqualToString:@"null"]) {
@@ -1275,6 +1333,53 @@ static SNTConfigurator *sharedConfigurator = nil;
              : 15.0;
 }
 
+- (NSUInteger)spoolQueueCapacity {
+  return self.configState[kSpoolQueueCapacity]
+             ? [self.configState[kSpoolQueueCapacity] unsignedIntegerValue]
+             : 65536;
+}
+
+- (SNTSpoolQueueFullPolicy)spoolQueueFullPolicy {
+  NSString *policy = [self.configState[kSpoolQueueFullPolicy] lowercaseString];
+  if ([policy isEqualToString:@"block"]) {
+    return SNTSpoolQueueFullPolicyBlock;
+  } else if ([policy isEqualToString:@"droplowpriority"]) {
+    return SNTSpoolQueueFullPolicyDropLowPriority;
+  } else {
+    return SNTSpoolQueueFullPolicyDrop;
+  }
+}
+
+- (NSString *)spoolZstdDictionaryPath {
+  return self.configState[kSpoolZstdDictionaryPath];
+}
+
+- (NSInteger)spoolZstdCompressionLevel {
+  return self.configState[kSpoolZstdCompressionLevel]
+             ? [self.configState[kSpoolZstdCompressionLevel] integerValue]
+             : 3;
+}
+
+- (NSUInteger)spoolZstdWorkers {
+  return [self.configState[kSpoolZstdWorkers] unsignedIntegerValue];
+}
+
+- (BOOL)spoolZstdAdaptiveLevel {
+  return [self.configState[kSpoolZstdAdaptiveLevel] boolValue];
+}
+
+- (NSUInteger)spoolZstdFrameRecords {
+  return [self.configState[kSpoolZstdFrameRecords] unsignedIntegerValue];
+}
+
+- (NSUInteger)spoolZstdFrameSizeKB {
+  return [self.configState[kSpoolZstdFrameSizeKB] unsignedIntegerValue];
+}
+
+- (BOOL)spoolStringTableEncoding {
+  return [self.configState[kSpoolStringTableEncoding] boolValue];
+}
+
 - (NSDictionary *)fileAccessPolicy {
   return self.configState[kFileAccessPolicy];
 }
@@ -1543,6 +1648,12 @@ static SNTConfigurator *sharedConfigurator = nil;
   return annotations;
 }
 
+- (NSUInteger)processTreeMaxProcesses {
+  return self.configState[kProcessTreeMaxProcesses]
+             ? [self.configState[kProcessTreeMaxProcesses] unsignedIntegerValue]
+             : 65536;
+}
+
 #pragma mark - Private
 
 ///
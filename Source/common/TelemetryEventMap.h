@@ -18,6 +18,7 @@
 #import <EndpointSecurity/ESTypes.h>
 #import <Foundation/Foundation.h>
 
+#include <string_view>
 #include <type_traits>
 
 namespace santa {
@@ -88,6 +89,10 @@ inline TelemetryEvent operator~(TelemetryEvent rhs) {
 TelemetryEvent TelemetryConfigToBitmask(NSArray<NSString *> *telemetry,
                                         BOOL enableForkAndExitLogging);
 
+// Returns the `Telemetry` configuration name of a single event, e.g.
+// "execution", or "unknown" for values that aren't a single event.
+std::string_view TelemetryEventName(TelemetryEvent event);
+
 // Returns the appropriate `TelemetryEvent` enum value for a given ES event
 TelemetryEvent ESEventToTelemetryEvent(es_event_type_t event);
 
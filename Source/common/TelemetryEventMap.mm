@@ -24,8 +24,8 @@
 
 namespace santa {
 
-static inline TelemetryEvent EventNameToMask(std::string_view event) {
-  static absl::flat_hash_map<std::string_view, TelemetryEvent> event_name_to_mask = {
+static const absl::flat_hash_map<std::string_view, TelemetryEvent> &EventNameMap() {
+  static const absl::flat_hash_map<std::string_view, TelemetryEvent> event_name_to_mask = {
       {"execution", TelemetryEvent::kExecution},
       {"fork", TelemetryEvent::kFork},
       {"exit", TelemetryEvent::kExit},
@@ -58,6 +58,11 @@ static inline TelemetryEvent EventNameToMask(std::string_view event) {
       {"everything", TelemetryEvent::kEverything},
   };
 
+  return event_name_to_mask;
+}
+
+static inline TelemetryEvent EventNameToMask(std::string_view event) {
+  const absl::flat_hash_map<std::string_view, TelemetryEvent> &event_name_to_mask = EventNameMap();
   auto search = event_name_to_mask.find(event);
   if (search != event_name_to_mask.end()) {
     return search->second;
@@ -85,6 +90,19 @@ TelemetryEvent TelemetryConfigToBitmask(NSArray<NSString *> *telemetry,
   return mask;
 }
 
+std::string_view TelemetryEventName(TelemetryEvent event) {
+  static const absl::flat_hash_map<TelemetryEvent, std::string_view> event_to_name = [] {
+    absl::flat_hash_map<TelemetryEvent, std::string_view> names;
+    for (const auto &[name, mask] : EventNameMap()) {
+      names[mask] = name;
+    }
+    return names;
+  }();
+
+  auto search = event_to_name.find(event);
+  return search != event_to_name.end() ? search->second : "unknown";
+}
+
 TelemetryEvent ESEventToTelemetryEvent(es_event_type_t event) {
   switch (event) {
     case ES_EVENT_TYPE_NOTIFY_CLONE: return TelemetryEvent::kClone;
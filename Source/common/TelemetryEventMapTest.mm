@@ -19,6 +19,7 @@
 #import <XCTest/XCTest.h>
 
 #include <map>
+#include <string>
 #include <string_view>
 
 #include "Source/common/Platform.h"
@@ -26,6 +27,7 @@
 using santa::ESEventToTelemetryEvent;
 using santa::TelemetryConfigToBitmask;
 using santa::TelemetryEvent;
+using santa::TelemetryEventName;
 
 @interface TelemetryEventMapTest : XCTestCase
 @end
@@ -87,6 +89,20 @@ using santa::TelemetryEvent;
                  TelemetryEvent::kEverything & ~TelemetryEvent::kFork & ~TelemetryEvent::kExit);
 }
 
+- (void)testTelemetryEventName {
+  XCTAssertTrue(TelemetryEventName(TelemetryEvent::kExecution) == "execution");
+  XCTAssertTrue(TelemetryEventName(TelemetryEvent::kFileAccess) == "fileaccess");
+  XCTAssertTrue(TelemetryEventName(TelemetryEvent::kNone) == "none");
+  XCTAssertTrue(TelemetryEventName(TelemetryEvent::kFork | TelemetryEvent::kExit) == "unknown");
+
+  // Each event's name maps back to the event
+  for (int i = 0; i <= 23; i++) {
+    TelemetryEvent event = static_cast<TelemetryEvent>(1ULL << i);
+    NSString *name = @(std::string(TelemetryEventName(event)).c_str());
+    XCTAssertEqual(TelemetryConfigToBitmask(@[ name ], true), event);
+  }
+}
+
 - (void)testESEventToTelemetryEvent {
   std::map<es_event_type_t, TelemetryEvent> esEventToTelemetryEvent = {
       {ES_EVENT_TYPE_NOTIFY_CLONE, TelemetryEvent::kClone},
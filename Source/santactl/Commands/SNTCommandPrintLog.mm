@@ -16,49 +16,249 @@
 #import <Foundation/Foundation.h>
 #include <google/protobuf/json/json.h>
 #include <stdlib.h>
-#include <sys/stat.h>
 
 #include <cstring>
+#include <initializer_list>
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
 
-#import "Source/common/NSData+Zlib.h"
+#import "Source/common/SNTConfigurator.h"
 #include "Source/common/SNTLogging.h"
-#import "Source/common/SNTXxhash.h"
 #include "Source/common/ScopedFile.h"
 #include "Source/common/santa_proto_include_wrapper.h"
 #import "Source/santactl/SNTCommand.h"
 #import "Source/santactl/SNTCommandController.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/Columnar.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/FrameIndex.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/SeekableStreamBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamReader.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StringTable.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdDictionary.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdInputStream.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/binaryproto_proto_include_wrapper.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_format.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "google/protobuf/any.pb.h"
+#include "google/protobuf/descriptor.h"
 #include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/gzip_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/wire_format_lite.h"
 
 #define ZSTD_STATIC_LINKING_ONLY
 #include "zstd.h"
 
 using JsonPrintOptions = google::protobuf::json::PrintOptions;
+using google::protobuf::internal::WireFormatLite;
 using google::protobuf::json::MessageToJsonString;
 using santa::ScopedFile;
 using santa::fsspool::binaryproto::LogBatch;
+using santa::fsspool::columnar::ColumnarBatch;
 namespace pbv1 = ::santa::pb::v1;
 
-// Semi-arbitrary max compressed file size that will be operated upon.
-// The current implementation decompresses in memory. This variable
-// is used to keep memory requirements semi-reasonable.
-static constexpr size_t kMaxCompressedSize = 1024 * 1024 * 250;
+// Zstd dictionaries available to decode spool files, keyed by dictionary ID.
+using ZstdDictionaries =
+    absl::flat_hash_map<uint32_t, std::shared_ptr<const ::fsspool::ZstdDictionary>>;
+
+// Max size of a single record. Records are read into memory one at a time, so
+// this bounds memory use regardless of the size of the file.
+static constexpr uint32_t kMaxRecordSize = ::fsspool::kMaxStreamRecordSize;
+
+// Semi-arbitrary max size of a seekable zstd frame. Frames are decompressed in
+// memory, and writers keep them far smaller than this.
+static constexpr uint64_t kMaxFrameSize = 1024 * 1024 * 250;
+
+// Selects the records that are printed. Event types and times are checked on
+// the serialized record, so that records filtered out by them are never fully
+// parsed. Pids and paths are checked once a record is parsed.
+class RecordFilter {
+ public:
+  // Adds an event type by the name of its SantaMessage field, e.g. "execution".
+  // Returns false if there is no such event type.
+  bool AddEventType(std::string_view name) {
+    const google::protobuf::OneofDescriptor *event =
+        ::pbv1::SantaMessage::descriptor()->FindOneofByName("event");
+    for (int i = 0; i < event->field_count(); i++) {
+      if (event->field(i)->name() == name) {
+        event_types_.insert(event->field(i)->number());
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Matches events where any of the processes involved has one of the given pids
+  void AddPid(int pid) { pids_.insert(pid); }
+
+  // Matches events where the executable of any of the processes involved, or
+  // any of the files involved, has a path starting with the given prefix
+  void SetPathPrefix(std::string prefix) { path_prefix_ = std::move(prefix); }
+
+  // Matches events that occurred in [start_time, end_time)
+  void SetStartTime(absl::Time start_time) { start_time_ = start_time; }
+  void SetEndTime(absl::Time end_time) { end_time_ = end_time; }
+
+  // Whether any record in the frame may match, based on its index entry
+  bool MayMatchFrame(const ::fsspool::FrameIndexEntry &frame) const {
+    // Frames whose records had no event times are indexed with the epoch
+    if (frame.first_event_time == absl::UnixEpoch() &&
+        frame.last_event_time == absl::UnixEpoch()) {
+      return true;
+    }
+    return !(start_time_ && frame.last_event_time < *start_time_) &&
+           !(end_time_ && frame.first_event_time >= *end_time_);
+  }
+
+  // Whether records of the event type, given by its SantaMessage field number,
+  // may match
+  bool MayMatchEventType(int event_type) const {
+    return event_types_.empty() || event_types_.contains(event_type);
+  }
+
+  // Checks the event type and time of a serialized SantaMessage
+  bool MayMatch(absl::Span<const uint8_t> record) const {
+    if (!MayMatchEventType(EventType(record))) {
+      return false;
+    }
+
+    if (start_time_ || end_time_) {
+      std::optional<absl::Time> event_time = ::fsspool::SeekableStreamBatcher::EventTime(record);
+      if (!event_time || (start_time_ && *event_time < *start_time_) ||
+          (end_time_ && *event_time >= *end_time_)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // Checks the pids and paths of a parsed SantaMessage
+  bool Matches(const ::pbv1::SantaMessage &message) const {
+    if (pids_.empty() && !path_prefix_) {
+      return true;
+    }
+
+    const google::protobuf::FieldDescriptor *event_field =
+        message.GetReflection()->GetOneofFieldDescriptor(
+            message, ::pbv1::SantaMessage::descriptor()->FindOneofByName("event"));
+    if (!event_field) {
+      return false;
+    }
+
+    bool pid_matched = pids_.empty();
+    bool path_matched = !path_prefix_;
+    const google::protobuf::Message &event =
+        message.GetReflection()->GetMessage(message, event_field);
+    std::vector<const google::protobuf::FieldDescriptor *> fields;
+    event.GetReflection()->ListFields(event, &fields);
+    for (const google::protobuf::FieldDescriptor *field : fields) {
+      if (field->is_repeated() ||
+          field->cpp_type() != google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE) {
+        continue;
+      }
+
+      // Processes (ProcessInfo and ProcessInfoLight) have an id and executable,
+      // while files (FileInfo and FileInfoLight) have a path
+      const google::protobuf::Message &subject = event.GetReflection()->GetMessage(event, field);
+      if (std::optional<int> pid = IntField(subject, {"id", "pid"})) {
+        pid_matched |= pids_.contains(*pid);
+      }
+      if (path_prefix_) {
+        std::optional<std::string> path = StringField(subject, {"executable", "path"});
+        if (!path) {
+          path = StringField(subject, {"path"});
+        }
+        path_matched |= path && absl::StartsWith(*path, *path_prefix_);
+      }
+    }
+
+    return pid_matched && path_matched;
+  }
+
+ private:
+  // Returns the field number of the event in a serialized SantaMessage, or 0 if
+  // there is none. Fields are serialized in field number order, so only the few
+  // fields preceding the event are examined.
+  static int EventType(absl::Span<const uint8_t> record) {
+    google::protobuf::io::CodedInputStream input(record.data(), static_cast<int>(record.size()));
+    while (uint32_t tag = input.ReadTag()) {
+      int field = WireFormatLite::GetTagFieldNumber(tag);
+      if (field >= ::pbv1::SantaMessage::kExecutionFieldNumber) {
+        return field;
+      }
+      if (!WireFormatLite::SkipField(&input, tag)) {
+        break;
+      }
+    }
+    return 0;
+  }
+
+  // Returns the set, singular field found by following the given field names
+  static const google::protobuf::FieldDescriptor *FindField(
+      const google::protobuf::Message *&message, std::initializer_list<const char *> names) {
+    const google::protobuf::FieldDescriptor *field = nullptr;
+    for (const char *name : names) {
+      if (field) {
+        if (field->cpp_type() != google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE) {
+          return nullptr;
+        }
+        message = &message->GetReflection()->GetMessage(*message, field);
+      }
+      field = message->GetDescriptor()->FindFieldByName(name);
+      if (!field || field->is_repeated() || !message->GetReflection()->HasField(*message, field)) {
+        return nullptr;
+      }
+    }
+    return field;
+  }
+
+  static std::optional<int> IntField(const google::protobuf::Message &message,
+                                     std::initializer_list<const char *> names) {
+    const google::protobuf::Message *parent = &message;
+    const google::protobuf::FieldDescriptor *field = FindField(parent, names);
+    if (!field || field->cpp_type() != google::protobuf::FieldDescriptor::CPPTYPE_INT32) {
+      return std::nullopt;
+    }
+    return parent->GetReflection()->GetInt32(*parent, field);
+  }
+
+  static std::optional<std::string> StringField(const google::protobuf::Message &message,
+                                                std::initializer_list<const char *> names) {
+    const google::protobuf::Message *parent = &message;
+    const google::protobuf::FieldDescriptor *field = FindField(parent, names);
+    if (!field || field->cpp_type() != google::protobuf::FieldDescriptor::CPPTYPE_STRING) {
+      return std::nullopt;
+    }
+    return parent->GetReflection()->GetString(*parent, field);
+  }
+
+  absl::flat_hash_set<int> event_types_;
+  absl::flat_hash_set<int> pids_;
+  std::optional<std::string> path_prefix_;
+  std::optional<absl::Time> start_time_;
+  std::optional<absl::Time> end_time_;
+};
 
 class MessageSource {
  public:
   // Factory method to return either a AnyMessageSource or StreamMessageSource based
   // on the type of the log file being parsed.
-  static absl::StatusOr<std::unique_ptr<MessageSource>> Create(NSString *path);
+  static absl::StatusOr<std::unique_ptr<MessageSource>> Create(
+      NSString *path, const ZstdDictionaries &dictionaries, const RecordFilter &filter);
 
   virtual ~MessageSource() = default;
 
@@ -66,212 +266,456 @@ class MessageSource {
   MessageSource(const MessageSource &) = delete;
   MessageSource &operator=(const MessageSource &) = delete;
 
-  virtual absl::StatusOr<::pbv1::SantaMessage> Next() = 0;
+  // Returns the next record matching the filter, or OutOfRangeError once the
+  // source is exhausted.
+  absl::StatusOr<::pbv1::SantaMessage> Next() {
+    while (true) {
+      absl::StatusOr<absl::Span<const uint8_t>> record = NextRecord();
+      if (!record.ok()) {
+        return record.status();
+      }
+
+      // String table encoded batches start with a marker. Every record that
+      // follows is decoded, even if it is then filtered out, since it may add
+      // to the table.
+      if (::fsspool::IsStringTableMarker(*record)) {
+        if (!string_table_) {
+          string_table_.emplace(::pbv1::SantaMessage::descriptor());
+        }
+        string_table_->Reset();
+        continue;
+      }
+      if (string_table_) {
+        if (absl::Status status = string_table_->Decode(*record, decoded_); !status.ok()) {
+          return status;
+        }
+        record = absl::Span<const uint8_t>(reinterpret_cast<const uint8_t *>(decoded_.data()),
+                                           decoded_.size());
+      }
+
+      if (!filter_.MayMatch(*record)) {
+        continue;
+      }
+
+      ::pbv1::SantaMessage santa_msg;
+      if (!santa_msg.ParseFromArray(record->data(), (int)record->size())) {
+        return absl::InternalError("Failed to parse message data");
+      }
+      if (filter_.Matches(santa_msg)) {
+        return santa_msg;
+      }
+    }
+  }
 
  protected:
   MessageSource(ScopedFile scoped_file) : scoped_file_(std::move(scoped_file)) {}
 
+  // Returns the next serialized SantaMessage, which remains valid until the
+  // following call.
+  virtual absl::StatusOr<absl::Span<const uint8_t>> NextRecord() = 0;
+
+  const RecordFilter &filter() const { return filter_; }
+
+  // Whether records are string table encoded, and so can't be skipped
+  bool UsesStringTable() const { return string_table_.has_value(); }
+
  private:
   ScopedFile scoped_file_;
+  RecordFilter filter_;
+  std::optional<::fsspool::StringTableDecoder> string_table_;
+  std::string decoded_;
 };
 
+// Returns an error if reading the file failed, as opposed to reaching its end.
+absl::Status FileStatus(const google::protobuf::io::FileInputStream &file_input) {
+  if (file_input.GetErrno() != 0) {
+    return absl::ErrnoToStatus(file_input.GetErrno(), "Failed to read file");
+  }
+  return absl::OkStatus();
+}
+
+// Reads the records of a LogBatch one at a time, rather than parsing the whole
+// batch up front.
 class AnyMessageSource : public MessageSource {
  public:
   static std::unique_ptr<AnyMessageSource> Create(ScopedFile scoped_file) {
-    LogBatch batch;
-    if (!batch.ParseFromFileDescriptor(scoped_file.UnsafeFD())) {
-      return nullptr;
-    }
+    auto file_input =
+        std::make_unique<google::protobuf::io::FileInputStream>(scoped_file.UnsafeFD());
 
-    return std::make_unique<AnyMessageSource>(std::move(scoped_file), std::move(batch));
+    return std::unique_ptr<AnyMessageSource>(
+        new AnyMessageSource(std::move(scoped_file), std::move(file_input)));
   }
 
-  AnyMessageSource(ScopedFile scoped_file, LogBatch batch)
-      : MessageSource(std::move(scoped_file)), batch_(std::move(batch)), current_index_(0) {}
+  absl::StatusOr<absl::Span<const uint8_t>> NextRecord() override {
+    // A CodedInputStream per record avoids its total bytes limit on large files
+    google::protobuf::io::CodedInputStream coded_input(file_input_.get());
 
-  absl::StatusOr<::pbv1::SantaMessage> Next() override {
-    // Check if we've reached the end of the batch
-    if (current_index_ >= static_cast<size_t>(batch_.records_size())) {
-      return absl::OutOfRangeError("No more data");
-    }
+    while (uint32_t tag = coded_input.ReadTag()) {
+      if (tag != kRecordsTag) {
+        if (!WireFormatLite::SkipField(&coded_input, tag)) {
+          return absl::InternalError("Failed to parse log batch");
+        }
+        continue;
+      }
+
+      uint32_t length;
+      if (!coded_input.ReadVarint32(&length)) {
+        return absl::InternalError("Failed to parse record length");
+      }
+      if (length > kMaxRecordSize) {
+        return absl::DataLossError("Record too large");
+      }
 
-    ::pbv1::SantaMessage santa_msg;
-    if (!santa_msg.ParseFromString(batch_.records(current_index_++).value())) {
-      return absl::InternalError("Failed to parse Any proto");
+      google::protobuf::io::CodedInputStream::Limit limit = coded_input.PushLimit((int)length);
+      if (!any_.ParseFromCodedStream(&coded_input) || !coded_input.ConsumedEntireMessage()) {
+        return absl::InternalError("Failed to parse Any proto");
+      }
+      coded_input.PopLimit(limit);
+
+      return absl::Span<const uint8_t>(reinterpret_cast<const uint8_t *>(any_.value().data()),
+                                       any_.value().size());
     }
 
-    return santa_msg;
+    if (absl::Status status = FileStatus(*file_input_); !status.ok()) {
+      return status;
+    }
+    return absl::OutOfRangeError("No more data");
   }
 
  private:
-  LogBatch batch_;
-  int current_index_;
+  static constexpr uint32_t kRecordsTag = WireFormatLite::MakeTag(
+      LogBatch::kRecordsFieldNumber, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+
+  AnyMessageSource(ScopedFile scoped_file,
+                   std::unique_ptr<google::protobuf::io::FileInputStream> file_input)
+      : MessageSource(std::move(scoped_file)), file_input_(std::move(file_input)) {}
+
+  std::unique_ptr<google::protobuf::io::FileInputStream> file_input_;
+  google::protobuf::Any any_;
 };
 
-class StreamMessageSource : public MessageSource {
+// Reads the batches of a columnar file one at a time. Only the columns of event
+// types the filter may match are decoded.
+class ColumnarMessageSource : public MessageSource {
  public:
-  static std::unique_ptr<StreamMessageSource> Create(ScopedFile scoped_file) {
+  static std::unique_ptr<ColumnarMessageSource> Create(ScopedFile scoped_file) {
     auto file_input =
         std::make_unique<google::protobuf::io::FileInputStream>(scoped_file.UnsafeFD());
-    auto coded_input = std::make_unique<google::protobuf::io::CodedInputStream>(file_input.get());
 
-    return std::unique_ptr<StreamMessageSource>(new StreamMessageSource(
-        std::move(scoped_file), std::move(file_input), std::move(coded_input)));
+    return std::unique_ptr<ColumnarMessageSource>(
+        new ColumnarMessageSource(std::move(scoped_file), std::move(file_input)));
   }
 
-  StreamMessageSource(ScopedFile scoped_file,
-                      std::unique_ptr<google::protobuf::io::FileInputStream> file_input,
-                      std::unique_ptr<google::protobuf::io::CodedInputStream> coded_input)
-      : MessageSource(std::move(scoped_file)),
-        file_input_(std::move(file_input)),
-        coded_input_(std::move(coded_input)) {}
+  absl::StatusOr<absl::Span<const uint8_t>> NextRecord() override {
+    while (true) {
+      if (reader_) {
+        absl::StatusOr<absl::Span<const uint8_t>> record = reader_->Next();
+        if (!absl::IsOutOfRange(record.status())) {
+          return record;
+        }
+        reader_.reset();
+      }
 
-  absl::StatusOr<::pbv1::SantaMessage> Next() override {
-    // Check the magic value
-    // Failing to read the first value indicates we're at the end of a file.
-    uint32_t magic;
-    if (!coded_input_->ReadLittleEndian32(&magic)) {
-      return absl::OutOfRangeError("No more data");
-    }
-    if (magic != ::fsspool::kStreamBatcherMagic) {
-      return absl::InternalError("Invalid magic value");
-    }
+      // A CodedInputStream per batch avoids its total bytes limit on large files
+      google::protobuf::io::CodedInputStream coded_input(file_input_.get());
+      ColumnarBatch batch;
+      if (absl::Status status = ::fsspool::ReadColumnarBatch(coded_input, batch); !status.ok()) {
+        if (absl::IsOutOfRange(status)) {
+          if (absl::Status file_status = FileStatus(*file_input_); !file_status.ok()) {
+            return file_status;
+          }
+        }
+        return status;
+      }
 
-    // Check the hash
-    uint64_t expected_hash;
-    if (!coded_input_->ReadRaw(&expected_hash, sizeof(expected_hash))) {
-      return absl::InternalError("Failed to parse hash data");
+      absl::StatusOr<std::unique_ptr<::fsspool::ColumnarBatchReader>> reader =
+          ::fsspool::ColumnarBatchReader::Create(std::move(batch), [this](uint32_t event_field) {
+            return filter().MayMatchEventType(static_cast<int>(event_field));
+          });
+      if (!reader.ok()) {
+        return reader.status();
+      }
+      reader_ = *std::move(reader);
     }
+  }
 
-    // Read the length
-    uint32_t message_length;
-    if (!coded_input_->ReadVarint32(&message_length)) {
-      return absl::InternalError("Failed to parse message length");
-    }
+ private:
+  ColumnarMessageSource(ScopedFile scoped_file,
+                        std::unique_ptr<google::protobuf::io::FileInputStream> file_input)
+      : MessageSource(std::move(scoped_file)), file_input_(std::move(file_input)) {}
 
-    // Read the raw message data
-    std::vector<uint8_t> msg_buf(message_length);
-    if (!coded_input_->ReadRaw(msg_buf.data(), message_length)) {
-      return absl::InternalError("Failed to read message into buffer");
-    }
+  std::unique_ptr<google::protobuf::io::FileInputStream> file_input_;
+  std::unique_ptr<::fsspool::ColumnarBatchReader> reader_;
+};
 
-    if (expected_hash != 0) {
-      santa::Xxhash64 xxhash;
-      xxhash.Update(msg_buf.data(), msg_buf.size());
-      __block uint64_t got_hash;
-      xxhash.Digest(^(const uint8_t *buf, size_t size) {
-        got_hash = *(uint64_t *)buf;
-      });
+// Reads stream batcher records from a file as it is read, holding only a single
+// record in memory. Subclasses decompress the file on the way.
+class StreamMessageSource : public MessageSource {
+ public:
+  static std::unique_ptr<StreamMessageSource> Create(ScopedFile scoped_file) {
+    auto file_input =
+        std::make_unique<google::protobuf::io::FileInputStream>(scoped_file.UnsafeFD());
 
-      if (got_hash != expected_hash) {
-        return absl::InternalError("Message corruption detected");
+    return std::unique_ptr<StreamMessageSource>(
+        new StreamMessageSource(std::move(scoped_file), std::move(file_input)));
+  }
+
+  absl::StatusOr<absl::Span<const uint8_t>> NextRecord() override {
+    // A CodedInputStream per record avoids its total bytes limit on large files
+    google::protobuf::io::CodedInputStream coded_input(Input());
+    absl::StatusOr<absl::Span<const uint8_t>> record =
+        ::fsspool::ReadStreamRecord(coded_input, record_);
+    if (absl::IsOutOfRange(record.status())) {
+      if (absl::Status status = InputStatus(); !status.ok()) {
+        return status;
       }
     }
+    return record;
+  }
 
-    ::pbv1::SantaMessage santa_msg;
-    if (!santa_msg.ParseFromArray(msg_buf.data(), (int)msg_buf.size())) {
-      return absl::InternalError("Failed to parse message data");
-    }
+ protected:
+  StreamMessageSource(ScopedFile scoped_file,
+                      std::unique_ptr<google::protobuf::io::FileInputStream> file_input)
+      : MessageSource(std::move(scoped_file)), file_input_(std::move(file_input)) {}
 
-    return santa_msg;
-  }
+  // The stream records are read from
+  virtual google::protobuf::io::ZeroCopyInputStream *Input() { return file_input_.get(); }
+
+  // Once the input stops producing data, distinguishes the end of the file from
+  // read and decompression failures.
+  virtual absl::Status InputStatus() { return FileStatus(*file_input_); }
+
+  google::protobuf::io::FileInputStream *FileInput() { return file_input_.get(); }
 
  private:
   std::unique_ptr<google::protobuf::io::FileInputStream> file_input_;
-  std::unique_ptr<google::protobuf::io::CodedInputStream> coded_input_;
+  std::vector<uint8_t> record_;
 };
 
-absl::Status CanProcessFile(const ScopedFile &scoped_file) {
-  struct stat sb;
-  if (fstat(scoped_file.UnsafeFD(), &sb) != 0) {
-    return absl::ErrnoToStatus(errno, "Unable to stat file");
-  }
+class GzipMessageSource : public StreamMessageSource {
+ public:
+  static std::unique_ptr<GzipMessageSource> Create(ScopedFile scoped_file) {
+    auto file_input =
+        std::make_unique<google::protobuf::io::FileInputStream>(scoped_file.UnsafeFD());
 
-  if (sb.st_size > kMaxCompressedSize) {
-    return absl::OutOfRangeError(absl::StrFormat(
-        "Compressed file too large. Please decompress first. (Max allowed compressed size: %zu",
-        kMaxCompressedSize));
+    return std::unique_ptr<GzipMessageSource>(
+        new GzipMessageSource(std::move(scoped_file), std::move(file_input)));
   }
 
-  return absl::OkStatus();
-}
+ protected:
+  google::protobuf::io::ZeroCopyInputStream *Input() override { return &gzip_input_; }
 
-absl::StatusOr<std::unique_ptr<MessageSource>> CreateStreamSource(NSData *buffer) {
-  auto temp_file = santa::ScopedFile::CreateTemporary();
-  if (!temp_file.ok()) {
-    return temp_file.status();
+  absl::Status InputStatus() override {
+    if (absl::Status status = StreamMessageSource::InputStatus(); !status.ok()) {
+      return status;
+    }
+    if (gzip_input_.ZlibErrorCode() < 0) {
+      return absl::DataLossError(
+          absl::StrFormat("Failed to decompress gzip file: %d: %s", gzip_input_.ZlibErrorCode(),
+                          gzip_input_.ZlibErrorMessage() ?: "unknown error"));
+    }
+    return absl::OkStatus();
   }
 
-  NSFileHandle *temp_handle = temp_file->Writer();
-  NSError *err;
-  if (![temp_handle writeData:buffer error:&err]) {
-    return absl::InternalError(absl::StrFormat("Failed to write decompressed data to temp file: %s",
-                                               err.localizedDescription.UTF8String));
-  }
+ private:
+  GzipMessageSource(ScopedFile scoped_file,
+                    std::unique_ptr<google::protobuf::io::FileInputStream> file_input)
+      : StreamMessageSource(std::move(scoped_file), std::move(file_input)),
+        gzip_input_(FileInput(), google::protobuf::io::GzipInputStream::GZIP) {}
 
-  // Reset back to the beginning for reading
-  [temp_handle seekToFileOffset:0];
+  google::protobuf::io::GzipInputStream gzip_input_;
+};
 
-  return StreamMessageSource::Create(std::move(*temp_file));
-}
+class ZstdMessageSource : public StreamMessageSource {
+ public:
+  static std::unique_ptr<ZstdMessageSource> Create(
+      ScopedFile scoped_file, std::vector<std::shared_ptr<const ::fsspool::ZstdDictionary>> dicts) {
+    auto file_input =
+        std::make_unique<google::protobuf::io::FileInputStream>(scoped_file.UnsafeFD());
+    std::unique_ptr<::fsspool::ZstdInputStream> zstd_input = ::fsspool::ZstdInputStream::Create(
+        file_input.get(), {.dictionaries = std::move(dicts)});
+    if (!zstd_input) {
+      return nullptr;
+    }
 
-absl::StatusOr<std::unique_ptr<MessageSource>> HandleGzipFileSource(ScopedFile scoped_file) {
-  if (absl::Status status = CanProcessFile(scoped_file); !status.ok()) {
-    return status;
+    return std::unique_ptr<ZstdMessageSource>(new ZstdMessageSource(
+        std::move(scoped_file), std::move(file_input), std::move(zstd_input)));
   }
 
-  NSFileHandle *handle = scoped_file.Reader();
-  NSError *err;
-  NSData *compressed = [handle readDataToEndOfFileAndReturnError:&err];
-  if (err) {
-    return absl::InternalError(
-        absl::StrFormat("Failed to read compressed file: %s", err.localizedDescription.UTF8String));
+ protected:
+  google::protobuf::io::ZeroCopyInputStream *Input() override { return zstd_input_.get(); }
+
+  absl::Status InputStatus() override {
+    if (absl::Status status = StreamMessageSource::InputStatus(); !status.ok()) {
+      return status;
+    }
+    return zstd_input_->status();
   }
 
-  NSData *decompressed = [compressed gzipDecompressed];
-  if (!decompressed) {
-    return absl::InternalError("Failed to decompress file");
+ private:
+  ZstdMessageSource(ScopedFile scoped_file,
+                    std::unique_ptr<google::protobuf::io::FileInputStream> file_input,
+                    std::unique_ptr<::fsspool::ZstdInputStream> zstd_input)
+      : StreamMessageSource(std::move(scoped_file), std::move(file_input)),
+        zstd_input_(std::move(zstd_input)) {}
+
+  std::unique_ptr<::fsspool::ZstdInputStream> zstd_input_;
+};
+
+// Returns the dictionary needed to decompress the zstd frame at the start of the
+// given data, or nullptr if the frame was compressed without one.
+absl::StatusOr<const ZSTD_DDict *> DictionaryForFrame(const void *data, size_t size,
+                                                      const ZstdDictionaries &dictionaries) {
+  // Files compressed with a dictionary record its ID in the frame header
+  uint32_t dict_id = ZSTD_getDictID_fromFrame(data, size);
+  if (dict_id == 0) {
+    return nullptr;
   }
 
-  return CreateStreamSource(decompressed);
+  auto it = dictionaries.find(dict_id);
+  if (it == dictionaries.end()) {
+    return absl::FailedPreconditionError(absl::StrFormat(
+        "File requires zstd dictionary ID %u. Use --zstd-dictionary to provide it.", dict_id));
+  }
+  return it->second->DDict();
 }
 
-absl::StatusOr<std::unique_ptr<MessageSource>> HandleZstdFileSource(ScopedFile scoped_file) {
-  if (absl::Status status = CanProcessFile(scoped_file); !status.ok()) {
-    return status;
+// Reads zstd files split into indexed frames one frame at a time, so that only a
+// single decompressed frame is held in memory.
+class SeekableMessageSource : public MessageSource {
+ public:
+  static std::unique_ptr<SeekableMessageSource> Create(
+      ScopedFile scoped_file, std::vector<::fsspool::FrameIndexEntry> frames,
+      const ZstdDictionaries &dictionaries) {
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    if (!dctx) {
+      return nullptr;
+    }
+
+    int fd = scoped_file.UnsafeFD();
+    return std::unique_ptr<SeekableMessageSource>(new SeekableMessageSource(
+        std::move(scoped_file), fd, std::move(frames), dictionaries, dctx));
   }
 
-  NSFileHandle *handle = scoped_file.Reader();
-  NSError *err;
-  NSData *compressed = [handle readDataToEndOfFileAndReturnError:&err];
-  if (err) {
-    return absl::InternalError(
-        absl::StrFormat("Failed to read compressed file: %s", err.localizedDescription.UTF8String));
+  ~SeekableMessageSource() override { ZSTD_freeDCtx(dctx_); }
+
+  absl::StatusOr<absl::Span<const uint8_t>> NextRecord() override {
+    while (true) {
+      if (coded_input_) {
+        absl::StatusOr<absl::Span<const uint8_t>> record =
+            ::fsspool::ReadStreamRecord(*coded_input_, record_);
+        if (!absl::IsOutOfRange(record.status())) {
+          return record;
+        }
+      }
+
+      // Frames without any records in the filtered time range are never read.
+      // The first frame is always read to find out whether the file is string
+      // table encoded, in which case later frames depend on earlier ones.
+      while (next_frame_ > 0 && next_frame_ < frames_.size() && !UsesStringTable() &&
+             !filter().MayMatchFrame(frames_[next_frame_])) {
+        next_frame_++;
+      }
+      if (next_frame_ >= frames_.size()) {
+        return absl::OutOfRangeError("No more data");
+      }
+      if (absl::Status status = LoadFrame(frames_[next_frame_++]); !status.ok()) {
+        return status;
+      }
+    }
   }
 
-  uint64_t max_size = ZSTD_decompressBound(compressed.bytes, compressed.length);
-  if (max_size == ZSTD_CONTENTSIZE_ERROR) {
-    return absl::OutOfRangeError("Failed to calculate decompressed size");
+ private:
+  SeekableMessageSource(ScopedFile scoped_file, int fd,
+                        std::vector<::fsspool::FrameIndexEntry> frames,
+                        const ZstdDictionaries &dictionaries, ZSTD_DCtx *dctx)
+      : MessageSource(std::move(scoped_file)),
+        fd_(fd),
+        frames_(std::move(frames)),
+        dictionaries_(dictionaries),
+        dctx_(dctx),
+        next_frame_(0) {}
+
+  absl::Status LoadFrame(const ::fsspool::FrameIndexEntry &frame) {
+    if (frame.compressed_size > kMaxFrameSize || frame.uncompressed_size > kMaxFrameSize) {
+      return absl::OutOfRangeError("Frame too large");
+    }
+
+    coded_input_.reset();
+
+    std::vector<uint8_t> compressed(frame.compressed_size);
+    if (pread(fd_, compressed.data(), compressed.size(), (off_t)frame.offset) !=
+        (ssize_t)compressed.size()) {
+      return absl::ErrnoToStatus(errno, "Failed to read frame");
+    }
+
+    absl::StatusOr<const ZSTD_DDict *> ddict =
+        DictionaryForFrame(compressed.data(), compressed.size(), dictionaries_);
+    if (!ddict.ok()) {
+      return ddict.status();
+    }
+
+    decompressed_.resize(frame.uncompressed_size);
+    size_t bytes_decompressed =
+        ZSTD_decompress_usingDDict(dctx_, decompressed_.data(), decompressed_.size(),
+                                   compressed.data(), compressed.size(), *ddict);
+    if (ZSTD_isError(bytes_decompressed)) {
+      return absl::InternalError(absl::StrFormat("Failed to decompress zstd frame: %d: %s",
+                                                 ZSTD_getErrorCode(bytes_decompressed),
+                                                 ZSTD_getErrorName(bytes_decompressed)));
+    } else if (bytes_decompressed != decompressed_.size()) {
+      return absl::DataLossError("Frame size does not match index");
+    }
+
+    coded_input_ = std::make_unique<google::protobuf::io::CodedInputStream>(
+        decompressed_.data(), (int)decompressed_.size());
+    return absl::OkStatus();
   }
 
-  NSMutableData *decompressed = [[NSMutableData alloc] initWithCapacity:max_size];
-  decompressed.length = max_size;
+  int fd_;
+  std::vector<::fsspool::FrameIndexEntry> frames_;
+  ZstdDictionaries dictionaries_;
+  ZSTD_DCtx *dctx_;
+  size_t next_frame_;
+  std::vector<uint8_t> decompressed_;
+  std::unique_ptr<google::protobuf::io::CodedInputStream> coded_input_;
+  std::vector<uint8_t> record_;
+};
 
-  size_t bytes_decompressed =
-      ZSTD_decompress(decompressed.mutableBytes, max_size, compressed.bytes, compressed.length);
-  if (ZSTD_isError(bytes_decompressed)) {
-    return absl::InternalError(absl::StrFormat("Failed to decompress zstd file: %d: %s",
-                                               ZSTD_getErrorCode(bytes_decompressed),
-                                               ZSTD_getErrorName(bytes_decompressed)));
+absl::StatusOr<std::unique_ptr<MessageSource>> HandleZstdFileSource(
+    ScopedFile scoped_file, const ZstdDictionaries &dictionaries) {
+  // Check the first frame's dictionary up front so a missing one is reported
+  // before any output is produced
+  uint8_t header[ZSTD_FRAMEHEADERSIZE_MAX];
+  ssize_t header_size = pread(scoped_file.UnsafeFD(), header, sizeof(header), 0);
+  if (header_size < 0) {
+    return absl::ErrnoToStatus(errno, "Failed to read zstd frame header");
   }
 
-  // Clamp the length now that we know the true size
-  decompressed.length = bytes_decompressed;
+  absl::StatusOr<const ZSTD_DDict *> ddict =
+      DictionaryForFrame(header, (size_t)header_size, dictionaries);
+  if (!ddict.ok()) {
+    return ddict.status();
+  }
 
-  return CreateStreamSource(decompressed);
+  // Later frames may have been compressed with other dictionaries, e.g. across
+  // a dictionary rotation, so make all of them available
+  std::vector<std::shared_ptr<const ::fsspool::ZstdDictionary>> dicts;
+  dicts.reserve(dictionaries.size());
+  for (const auto &[dict_id, dictionary] : dictionaries) {
+    dicts.push_back(dictionary);
+  }
+
+  std::unique_ptr<ZstdMessageSource> source =
+      ZstdMessageSource::Create(std::move(scoped_file), std::move(dicts));
+  if (!source) {
+    return absl::InternalError("Failed to create zstd decompression stream");
+  }
+  return source;
 }
 
-absl::StatusOr<std::unique_ptr<MessageSource>> MessageSource::Create(NSString *path) {
+absl::StatusOr<std::unique_ptr<MessageSource>> MessageSource::Create(
+    NSString *path, const ZstdDictionaries &dictionaries, const RecordFilter &filter) {
   // Open the file
   int fd = open(path.UTF8String, O_RDONLY);
   if (fd < 0) {
@@ -297,17 +741,85 @@ absl::StatusOr<std::unique_ptr<MessageSource>> MessageSource::Create(NSString *p
   }
 
   // Determine which derived class to instantiate based on magic number
+  absl::StatusOr<std::unique_ptr<MessageSource>> source;
   if (magic_number == ::fsspool::kStreamBatcherMagic) {
-    return StreamMessageSource::Create(std::move(scoped_file));
+    source = StreamMessageSource::Create(std::move(scoped_file));
+  } else if (magic_number == ::fsspool::kColumnarBatchMagic) {
+    source = ColumnarMessageSource::Create(std::move(scoped_file));
   } else if (magic_number == 0xfd2fb528) {
-    return HandleZstdFileSource(std::move(scoped_file));
+    // Files with a frame index are decoded a frame at a time. Otherwise, or if the index
+    // is unusable, fall back to decompressing the file as a stream.
+    if (auto frames = ::fsspool::ReadFrameIndex(fd); frames.ok()) {
+      source = SeekableMessageSource::Create(std::move(scoped_file), *std::move(frames),
+                                             dictionaries);
+    } else {
+      source = HandleZstdFileSource(std::move(scoped_file), dictionaries);
+    }
   } else if ((magic_number & 0xffff) == 0x8b1f) {
-    return HandleGzipFileSource(std::move(scoped_file));
+    source = GzipMessageSource::Create(std::move(scoped_file));
   } else if ((magic_number & 0xff) == 0x0a) {
-    return AnyMessageSource::Create(std::move(scoped_file));
+    source = AnyMessageSource::Create(std::move(scoped_file));
   } else {
     return absl::InvalidArgumentError("Unsupported file type");
   }
+
+  if (!source.ok()) {
+    return source.status();
+  } else if (!*source) {
+    return absl::InternalError("Failed to create message source");
+  }
+
+  (*source)->filter_ = filter;
+  return source;
+}
+
+// Parses an RFC 3339 or Unix seconds time argument
+std::optional<absl::Time> ParseTimeArgument(NSString *arg) {
+  absl::Time time;
+  std::string err;
+  if (absl::ParseTime(absl::RFC3339_full, arg.UTF8String, &time, &err)) {
+    return time;
+  }
+
+  int64_t seconds;
+  if (absl::SimpleAtoi(arg.UTF8String, &seconds)) {
+    return absl::FromUnixSeconds(seconds);
+  }
+  return std::nullopt;
+}
+
+// Writes the source's records to out as a JSON array
+void PrintRecords(NSString *path, MessageSource &source, const JsonPrintOptions &options,
+                  std::ostream &out) {
+  // Print the opening inner JSON array
+  out << "\n[\n";
+
+  bool first_message = true;
+  while (true) {
+    auto message = source.Next();
+    if (!message.ok()) {
+      // Check if we've reached the end of the source, or some other error
+      if (!absl::IsOutOfRange(message.status())) {
+        TEE_LOGE(@"%@: Error reading message: %s", path, message.status().ToString().c_str());
+      }
+      break;
+    }
+
+    // Print the comma between records
+    if (first_message) {
+      first_message = false;
+    } else {
+      out << ",\n";
+    }
+
+    std::string json;
+    if (!MessageToJsonString(*message, &json, options).ok()) {
+      TEE_LOGE(@"Unable to convert message to JSON in file: '%@'\n", path);
+    }
+    out << json;
+  }
+
+  out << "]";
 }
 
 @interface SNTCommandPrintLog : SNTCommand <SNTCommandProtocol>
@@ -340,7 +852,108 @@ REGISTER_COMMAND_NAME(@"printlog")
          @"    [\n"
          @"      ... file N contents ...\n"
          @"    ]\n"
-         @"  ]";
+         @"  ]\n"
+         @"\n"
+         @"Options:\n"
+         @"  --zstd-dictionary PATH: A zstd dictionary used to decode spool files\n"
+         @"                          that were compressed with it. May be repeated.\n"
+         @"                          The configured SpoolZstdDictionaryPath is\n"
+         @"                          always loaded when set.\n"
+         @"  --jobs N:               Number of files to process in parallel.\n"
+         @"                          Defaults to 1. With more than 1, each file's\n"
+         @"                          output is held in memory until it is printed.\n"
+         @"  --unordered:            With --jobs, print files as they complete\n"
+         @"                          rather than in the order given.\n"
+         @"\n"
+         @"Filters (only matching records are printed):\n"
+         @"  --event-type TYPE:      Event type, e.g. execution, fork or close.\n"
+         @"                          May be repeated.\n"
+         @"  --pid PID:              Pid of any process involved in the event.\n"
+         @"                          May be repeated.\n"
+         @"  --path-prefix PREFIX:   Path prefix of any executable or file involved\n"
+         @"                          in the event.\n"
+         @"  --start-time TIME:      Events at or after TIME, given as RFC 3339\n"
+         @"                          (e.g. 2026-01-02T15:04:05Z) or Unix seconds.\n"
+         @"  --end-time TIME:        Events before TIME.";
+}
+
+// Loads the given dictionaries, along with the configured spool dictionary, and
+// populates the filter and output options. Returns any non-flag args as path
+// names in an NSArray.
+- (NSArray *)parseArguments:(NSArray<NSString *> *)arguments
+               dictionaries:(ZstdDictionaries &)dictionaries
+                     filter:(RecordFilter &)filter
+                       jobs:(int &)jobs
+                  unordered:(bool &)unordered {
+  NSMutableArray *paths = [NSMutableArray array];
+  NSMutableArray *dictionaryPaths = [NSMutableArray array];
+  if ([[SNTConfigurator configurator] spoolZstdDictionaryPath]) {
+    [dictionaryPaths addObject:[[SNTConfigurator configurator] spoolZstdDictionaryPath]];
+  }
+
+  NSUInteger nargs = [arguments count];
+  // Advances to the argument of the flag at index i and returns it
+  NSString * (^flagArgument)(NSUInteger &) = ^NSString *(NSUInteger &i) {
+    NSString *flag = arguments[i];
+    i += 1;
+    if (i >= nargs || [arguments[i] hasPrefix:@"--"]) {
+      [self printErrorUsageAndExit:[NSString stringWithFormat:@"\n%@ requires an argument", flag]];
+    }
+    return arguments[i];
+  };
+
+  for (NSUInteger i = 0; i < nargs; i++) {
+    NSString *arg = [arguments objectAtIndex:i];
+    if ([arg caseInsensitiveCompare:@"--zstd-dictionary"] == NSOrderedSame) {
+      [dictionaryPaths addObject:flagArgument(i)];
+    } else if ([arg caseInsensitiveCompare:@"--jobs"] == NSOrderedSame) {
+      NSScanner *scanner = [NSScanner scannerWithString:flagArgument(i)];
+      if (![scanner scanInt:&jobs] || !scanner.atEnd || jobs < 1) {
+        [self printErrorUsageAndExit:@"\n--jobs requires a positive number"];
+      }
+    } else if ([arg caseInsensitiveCompare:@"--unordered"] == NSOrderedSame) {
+      unordered = true;
+    } else if ([arg caseInsensitiveCompare:@"--event-type"] == NSOrderedSame) {
+      NSString *eventType = flagArgument(i);
+      if (!filter.AddEventType(eventType.UTF8String)) {
+        [self printErrorUsageAndExit:[NSString
+                                         stringWithFormat:@"\nUnknown event type: %@", eventType]];
+      }
+    } else if ([arg caseInsensitiveCompare:@"--pid"] == NSOrderedSame) {
+      NSScanner *scanner = [NSScanner scannerWithString:flagArgument(i)];
+      int pid;
+      if (![scanner scanInt:&pid] || !scanner.atEnd) {
+        [self printErrorUsageAndExit:@"\n--pid requires a number"];
+      }
+      filter.AddPid(pid);
+    } else if ([arg caseInsensitiveCompare:@"--path-prefix"] == NSOrderedSame) {
+      filter.SetPathPrefix(flagArgument(i).UTF8String);
+    } else if ([arg caseInsensitiveCompare:@"--start-time"] == NSOrderedSame ||
+               [arg caseInsensitiveCompare:@"--end-time"] == NSOrderedSame) {
+      std::optional<absl::Time> time = ParseTimeArgument(flagArgument(i));
+      if (!time) {
+        [self printErrorUsageAndExit:[NSString stringWithFormat:@"\nInvalid time for %@", arg]];
+      }
+      if ([arg caseInsensitiveCompare:@"--start-time"] == NSOrderedSame) {
+        filter.SetStartTime(*time);
+      } else {
+        filter.SetEndTime(*time);
+      }
+    } else {
+      [paths addObject:arg];
+    }
+  }
+
+  for (NSString *path in dictionaryPaths) {
+    auto dictionary = ::fsspool::ZstdDictionary::Load(path.UTF8String);
+    if (!dictionary.ok()) {
+      TEE_LOGE(@"%@: %s", path, dictionary.status().ToString().c_str());
+      continue;
+    }
+    dictionaries[(*dictionary)->ID()] = *std::move(dictionary);
+  }
+
+  return paths;
 }
 
 - (void)runWithArguments:(NSArray *)arguments {
@@ -350,15 +963,19 @@ REGISTER_COMMAND_NAME(@"printlog")
   options.preserve_proto_field_names = true;
   options.add_whitespace = true;
 
-  bool printed_opening_brace = false;
-
-  for (NSString *path in arguments) {
-    auto source = MessageSource::Create(path);
-    if (!source.ok()) {
-      TEE_LOGE(@"%@: %s", path, source.status().ToString().c_str());
-      continue;
-    }
+  ZstdDictionaries dictionaries;
+  RecordFilter filter;
+  int jobs = 1;
+  bool unordered = false;
+  NSArray *paths = [self parseArguments:arguments
+                           dictionaries:dictionaries
+                                 filter:filter
+                                   jobs:jobs
+                              unordered:unordered];
 
+  bool printed_opening_brace = false;
+  // Prints the separator preceding each file's inner JSON array
+  auto printSeparator = [&printed_opening_brace]() {
     if (printed_opening_brace) {
       std::cout << ",";
     } else {
@@ -366,36 +983,87 @@ REGISTER_COMMAND_NAME(@"printlog")
       std::cout << "[";
       printed_opening_brace = true;
     }
-
-    // Print the opening inner JSON array
-    std::cout << "\n[\n";
-
-    bool first_message = true;
-    while (true) {
-      auto message = (*source)->Next();
-      if (!message.ok()) {
-        // Check if we've reached the end of the source, or some other error
-        if (!absl::IsOutOfRange(message.status())) {
-          TEE_LOGE(@"%@: Error reading message: %s", path, message.status().ToString().c_str());
-        }
-        break;
+  };
+
+  if (jobs == 1) {
+    // Records are printed as they are read, without holding a file's output in memory
+    for (NSString *path in paths) {
+      auto source = MessageSource::Create(path, dictionaries, filter);
+      if (!source.ok()) {
+        TEE_LOGE(@"%@: %s", path, source.status().ToString().c_str());
+        continue;
       }
 
-      // Print the comma between records
-      if (first_message) {
-        first_message = false;
-      } else {
-        std::cout << ",\n";
+      printSeparator();
+      PrintRecords(path, **source, options, std::cout);
+      std::cout << std::flush;
+    }
+  } else {
+    // The output of each file, or nullopt if it couldn't be read. Only accessed on printQueue.
+    std::vector<std::optional<std::string>> outputs(paths.count);
+    std::vector<bool> completed(paths.count, false);
+    NSUInteger nextToPrint = 0;
+
+    auto printOutput = [&](const std::optional<std::string> &output) {
+      if (output) {
+        printSeparator();
+        std::cout << *output << std::flush;
       }
+    };
+
+    const ZstdDictionaries *dictionariesPtr = &dictionaries;
+    const RecordFilter *filterPtr = &filter;
+    const JsonPrintOptions *optionsPtr = &options;
+    auto *outputsPtr = &outputs;
+    auto *completedPtr = &completed;
+    NSUInteger *nextToPrintPtr = &nextToPrint;
+    auto *printOutputPtr = &printOutput;
+
+    dispatch_queue_t workQueue = dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+    dispatch_queue_t printQueue =
+        dispatch_queue_create("com.northpolesec.santa.santactl.printlog", DISPATCH_QUEUE_SERIAL);
+    dispatch_group_t group = dispatch_group_create();
+    // Limits the number of files being processed, or held waiting to be printed
+    dispatch_semaphore_t slots = dispatch_semaphore_create(jobs);
+
+    for (NSUInteger i = 0; i < paths.count; i++) {
+      dispatch_semaphore_wait(slots, DISPATCH_TIME_FOREVER);
+      NSString *path = paths[i];
+
+      dispatch_group_async(group, workQueue, ^{
+        std::optional<std::string> output;
+        auto source = MessageSource::Create(path, *dictionariesPtr, *filterPtr);
+        if (source.ok()) {
+          std::ostringstream out;
+          PrintRecords(path, **source, *optionsPtr, out);
+          output = std::move(out).str();
+        } else {
+          TEE_LOGE(@"%@: %s", path, source.status().ToString().c_str());
+        }
 
-      std::string json;
-      if (!MessageToJsonString(*message, &json, options).ok()) {
-        TEE_LOGE(@"Unable to convert message to JSON in file: '%@'\n", path);
-      }
-      std::cout << json;
+        std::optional<std::string> *outputPtr = &output;
+        dispatch_sync(printQueue, ^{
+          if (unordered) {
+            (*printOutputPtr)(*outputPtr);
+            dispatch_semaphore_signal(slots);
+            return;
+          }
+
+          // Print this file's output and that of any following files that
+          // completed before it
+          (*outputsPtr)[i] = std::move(*outputPtr);
+          (*completedPtr)[i] = true;
+          while (*nextToPrintPtr < completedPtr->size() && (*completedPtr)[*nextToPrintPtr]) {
+            (*printOutputPtr)((*outputsPtr)[*nextToPrintPtr]);
+            (*outputsPtr)[*nextToPrintPtr].reset();
+            (*nextToPrintPtr)++;
+            dispatch_semaphore_signal(slots);
+          }
+        });
+      });
     }
 
-    std::cout << "]" << std::flush;
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
   }
 
   if (printed_opening_brace) {
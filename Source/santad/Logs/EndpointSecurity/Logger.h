@@ -20,6 +20,7 @@
 
 #include <atomic>
 #include <memory>
+#include <optional>
 #include <string_view>
 
 #import "Source/common/SNTCommonEnums.h"
@@ -29,6 +30,8 @@
 #include "Source/santad/EventProviders/EndpointSecurity/EnrichedTypes.h"
 #include "Source/santad/EventProviders/EndpointSecurity/Message.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Serializer.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdDictionary.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdLevelController.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/Writer.h"
 #import "Source/santad/SNTDecisionCache.h"
 
@@ -44,6 +47,20 @@ namespace santa {
 
 using GetExportConfigBlock = SNTExportConfiguration * (^)(void);
 
+// Queueing and encoding settings for the spool based event log types.
+struct SpoolOptions {
+  size_t queue_capacity = 65536;
+  SNTSpoolQueueFullPolicy queue_full_policy = SNTSpoolQueueFullPolicyDrop;
+  NSString *zstd_dictionary_path = nil;
+  int zstd_compression_level = 3;
+  int zstd_workers = 0;
+  bool zstd_adaptive_level = false;
+  // When either is non-zero, zstd spool files are split into indexed frames.
+  size_t zstd_frame_records = 0;
+  size_t zstd_frame_size_kb = 0;
+  bool string_table_encoding = false;
+};
+
 class Logger : public Timer<Logger> {
  public:
   enum class ExportLogType {
@@ -51,6 +68,7 @@ class Logger : public Timer<Logger> {
     kUncompressedStream,
     kGzipStream,
     kZstdStream,
+    kColumnar,
   };
 
   static std::unique_ptr<Logger> Create(
@@ -60,7 +78,7 @@ class Logger : public Timer<Logger> {
       NSString *spool_log_path, size_t spool_dir_size_threshold, size_t spool_file_size_threshold,
       uint64_t spool_flush_timeout_ms, uint32_t telemetry_export_seconds,
       uint32_t telemetry_export_timeout_seconds, uint32_t telemetry_export_batch_threshold_size_mb,
-      uint32_t telemetry_export_max_files_per_batch);
+      uint32_t telemetry_export_max_files_per_batch, SpoolOptions spool_options = {});
 
   Logger(SNTSyncdQueue *syncd_queue, GetExportConfigBlock getExportConfigBlock,
          TelemetryEvent telemetry_mask, uint32_t telemetry_export_timeout_seconds,
@@ -92,6 +110,11 @@ class Logger : public Timer<Logger> {
 
   void Flush();
 
+  std::optional<Writer::Stats> GetWriterStats();
+
+  /// Compression statistics, only available when spool files are zstd compressed.
+  std::optional<::fsspool::ZstdLevelController::Stats> GetCompressionStats();
+
   void SetTelemetryMask(TelemetryEvent mask);
 
   inline bool ShouldLog(TelemetryEvent event) { return ((event & telemetry_mask_) == event); }
@@ -160,12 +183,19 @@ class Logger : public Timer<Logger> {
   };
 
   void ExportTelemetrySerialized();
+  // Returns a handle to the decoded contents of a string table encoded spool
+  // file, updating size. Any other file, or one that fails to decode, is
+  // returned as is so that its telemetry is still exported.
+  NSFileHandle *DecodeForExport(NSFileHandle *handle, NSString *path, off_t *size);
 
   SNTSyncdQueue *syncd_queue_;
   GetExportConfigBlock get_export_config_block_;
   TelemetryEvent telemetry_mask_;
   std::shared_ptr<santa::Serializer> serializer_;
   std::shared_ptr<santa::Writer> writer_;
+  std::shared_ptr<::fsspool::ZstdLevelController> zstd_level_controller_;
+  // Needed to decode string table encoded files compressed with the dictionary
+  std::shared_ptr<const ::fsspool::ZstdDictionary> zstd_dictionary_;
   ExportTracker tracker_;
   std::unique_ptr<std::atomic_uint64_t> export_batch_threshold_size_bytes_;
   std::unique_ptr<std::atomic_uint32_t> export_max_files_per_batch_;
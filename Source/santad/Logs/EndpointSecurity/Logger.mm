@@ -22,19 +22,27 @@
 #include <atomic>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #import "Source/common/SNTCommonEnums.h"
 #import "Source/common/SNTExportConfiguration.h"
 #include "Source/common/SNTLogging.h"
 #include "Source/common/SNTStoredExecutionEvent.h"
 #include "Source/common/SNTSystemInfo.h"
+#include "Source/common/ScopedFile.h"
 #include "Source/common/TelemetryEventMap.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/BasicString.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Empty.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Protobuf.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Serializer.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/Columnar.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ColumnarBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/SeekableStreamBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamReader.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StringTableBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdDictionary.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/File.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/Null.h"
@@ -57,6 +65,25 @@ static constexpr size_t kMaxExpectedWriteSizeBytes = 4096;
 static constexpr uint32_t kMinTelemetryExportIntervalSecs = 60;
 static constexpr uint32_t kMaxTelemetryExportIntervalSecs = 3600;
 
+// Creates a spool for the stream batcher, string table encoding each batch when enabled
+template <typename B>
+static std::shared_ptr<Writer> CreateStreamSpool(B batcher, bool string_table_encoding,
+                                                 NSString *spool_log_path,
+                                                 size_t spool_dir_size_threshold,
+                                                 size_t spool_file_size_threshold,
+                                                 uint64_t spool_flush_timeout_ms,
+                                                 SpoolQueueOptions spool_queue_options) {
+  if (string_table_encoding) {
+    return Spool<::fsspool::StringTableBatcher<B>>::Create(
+        ::fsspool::StringTableBatcher<B>(std::move(batcher)), [spool_log_path UTF8String],
+        spool_dir_size_threshold, spool_file_size_threshold, spool_flush_timeout_ms,
+        std::move(spool_queue_options));
+  }
+  return Spool<B>::Create(std::move(batcher), [spool_log_path UTF8String],
+                          spool_dir_size_threshold, spool_file_size_threshold,
+                          spool_flush_timeout_ms, std::move(spool_queue_options));
+}
+
 // Translate configured log type to appropriate Serializer/Writer pairs
 std::unique_ptr<Logger> Logger::Create(
     std::shared_ptr<EndpointSecurityAPI> esapi, SNTSyncdQueue *syncd_queue,
@@ -65,9 +92,22 @@ std::unique_ptr<Logger> Logger::Create(
     NSString *spool_log_path, size_t spool_dir_size_threshold, size_t spool_file_size_threshold,
     uint64_t spool_flush_timeout_ms, uint32_t telemetry_export_seconds,
     uint32_t telemetry_export_timeout_seconds, uint32_t telemetry_export_batch_threshold_size_mb,
-    uint32_t telemetry_export_max_files_per_batch) {
+    uint32_t telemetry_export_max_files_per_batch, SpoolOptions spool_options) {
   std::shared_ptr<santa::Serializer> serializer;
   std::shared_ptr<santa::Writer> writer;
+  std::shared_ptr<::fsspool::ZstdLevelController> zstd_level_controller;
+  std::shared_ptr<const ::fsspool::ZstdDictionary> zstd_dictionary;
+
+  SpoolQueueOptions spool_queue_options{.capacity = spool_options.queue_capacity};
+  switch (spool_options.queue_full_policy) {
+    case SNTSpoolQueueFullPolicyBlock:
+      spool_queue_options.full_policy = QueueFullPolicy::kBlock;
+      break;
+    case SNTSpoolQueueFullPolicyDropLowPriority:
+      spool_queue_options.full_policy = QueueFullPolicy::kDropLowPriority;
+      break;
+    default: spool_queue_options.full_policy = QueueFullPolicy::kDrop; break;
+  }
 
   switch (log_type) {
     case SNTEventLogTypeFilelog:
@@ -87,31 +127,88 @@ std::unique_ptr<Logger> Logger::Create(
       serializer = Protobuf::Create(esapi, std::move(decision_cache));
       writer = Spool<::fsspool::AnyBatcher>::Create(
           ::fsspool::AnyBatcher(), [spool_log_path UTF8String], spool_dir_size_threshold,
-          spool_file_size_threshold, spool_flush_timeout_ms);
+          spool_file_size_threshold, spool_flush_timeout_ms, spool_queue_options);
       break;
     case SNTEventLogTypeProtobufStream:
       serializer = Protobuf::Create(esapi, std::move(decision_cache));
-      writer = Spool<::fsspool::UncompressedStreamBatcher>::Create(
-          ::fsspool::UncompressedStreamBatcher(), [spool_log_path UTF8String],
-          spool_dir_size_threshold, spool_file_size_threshold, spool_flush_timeout_ms);
+      writer = CreateStreamSpool(::fsspool::UncompressedStreamBatcher(),
+                                 spool_options.string_table_encoding, spool_log_path,
+                                 spool_dir_size_threshold, spool_file_size_threshold,
+                                 spool_flush_timeout_ms, spool_queue_options);
       break;
     case SNTEventLogTypeProtobufStreamGzip:
       serializer = Protobuf::Create(esapi, std::move(decision_cache));
-      writer = Spool<::fsspool::GzipStreamBatcher>::Create(
+      writer = CreateStreamSpool(
           ::fsspool::GzipStreamBatcher(^(google::protobuf::io::ZeroCopyOutputStream *raw_stream) {
             return std::make_shared<google::protobuf::io::GzipOutputStream>(raw_stream);
           }),
-          [spool_log_path UTF8String], spool_dir_size_threshold, spool_file_size_threshold,
-          spool_flush_timeout_ms);
+          spool_options.string_table_encoding, spool_log_path, spool_dir_size_threshold,
+          spool_file_size_threshold, spool_flush_timeout_ms, spool_queue_options);
       break;
-    case SNTEventLogTypeProtobufStreamZstd:
+    case SNTEventLogTypeProtobufStreamZstd: {
+      // A dictionary that fails to load isn't fatal, fall back to compressing without one.
+      std::shared_ptr<const ::fsspool::ZstdDictionary> dictionary;
+      if (spool_options.zstd_dictionary_path) {
+        auto loaded =
+            ::fsspool::ZstdDictionary::Load(spool_options.zstd_dictionary_path.UTF8String);
+        if (loaded.ok()) {
+          dictionary = *std::move(loaded);
+        } else {
+          LOGW(@"Unable to load zstd dictionary, compressing without it: %s",
+               loaded.status().ToString().c_str());
+        }
+      }
+
+      // The controller tracks compression statistics, and in adaptive mode lowers the level
+      // as events back up in the spool queue.
+      zstd_level_controller = std::make_shared<::fsspool::ZstdLevelController>(
+          std::clamp(spool_options.zstd_compression_level, ZSTD_minCLevel(), ZSTD_maxCLevel()),
+          spool_options.zstd_adaptive_level);
+      spool_queue_options.backlog_observer = [zstd_level_controller](size_t depth,
+                                                                     size_t capacity) {
+        zstd_level_controller->ObserveBacklog(depth, capacity);
+      };
+
+      zstd_dictionary = dictionary;
+      ::fsspool::ZstdOutputStreamOptions zstd_options{
+          .workers = std::max(spool_options.zstd_workers, 0),
+          .dictionary = std::move(dictionary),
+          .level_controller = zstd_level_controller,
+      };
+
+      serializer = Protobuf::Create(esapi, std::move(decision_cache));
+      if (spool_options.zstd_frame_records > 0 || spool_options.zstd_frame_size_kb > 0) {
+        // Split files into indexed frames so that readers can seek within them
+        writer = CreateStreamSpool(
+            ::fsspool::SeekableStreamBatcher(
+                ^(google::protobuf::io::ZeroCopyOutputStream *raw_stream) {
+                  return ::fsspool::ZstdOutputStream::Create(raw_stream, zstd_options);
+                },
+                {
+                    .max_frame_records = spool_options.zstd_frame_records,
+                    .max_frame_bytes = spool_options.zstd_frame_size_kb * 1024,
+                }),
+            spool_options.string_table_encoding, spool_log_path, spool_dir_size_threshold,
+            spool_file_size_threshold, spool_flush_timeout_ms, spool_queue_options);
+      } else {
+        writer = CreateStreamSpool(
+            ::fsspool::ZstdStreamBatcher(^(google::protobuf::io::ZeroCopyOutputStream *raw_stream) {
+              return ::fsspool::ZstdOutputStream::Create(raw_stream, zstd_options);
+            }),
+            spool_options.string_table_encoding, spool_log_path, spool_dir_size_threshold,
+            spool_file_size_threshold, spool_flush_timeout_ms, spool_queue_options);
+      }
+      break;
+    }
+    case SNTEventLogTypeProtobufColumnar:
       serializer = Protobuf::Create(esapi, std::move(decision_cache));
-      writer = Spool<::fsspool::ZstdStreamBatcher>::Create(
-          ::fsspool::ZstdStreamBatcher(^(google::protobuf::io::ZeroCopyOutputStream *raw_stream) {
-            return ::fsspool::ZstdOutputStream::Create(raw_stream);
+      writer = Spool<::fsspool::ColumnarBatcher>::Create(
+          ::fsspool::ColumnarBatcher({
+              .compression_level = std::clamp(spool_options.zstd_compression_level,
+                                              ZSTD_minCLevel(), ZSTD_maxCLevel()),
           }),
           [spool_log_path UTF8String], spool_dir_size_threshold, spool_file_size_threshold,
-          spool_flush_timeout_ms);
+          spool_flush_timeout_ms, spool_queue_options);
       break;
     case SNTEventLogTypeJSON:
       serializer = Protobuf::Create(esapi, std::move(decision_cache), true);
@@ -125,6 +222,8 @@ std::unique_ptr<Logger> Logger::Create(
       syncd_queue, getExportConfigBlock, telemetry_mask, telemetry_export_timeout_seconds,
       telemetry_export_batch_threshold_size_mb, telemetry_export_max_files_per_batch,
       std::move(serializer), std::move(writer));
+  logger->zstd_level_controller_ = std::move(zstd_level_controller);
+  logger->zstd_dictionary_ = std::move(zstd_dictionary);
 
   logger->SetTimerInterval(telemetry_export_seconds);
 
@@ -225,6 +324,8 @@ Logger::ExportLogType Logger::GetLogType(NSFileHandle *handle, NSString *path) {
   uint32_t magic = *(uint32_t *)(magic_bytes.bytes);
   if (magic == ::fsspool::kStreamBatcherMagic) {
     return ExportLogType::kUncompressedStream;
+  } else if (magic == ::fsspool::kColumnarBatchMagic) {
+    return ExportLogType::kColumnar;
   } else if (magic == 0xfd2fb528) {
     return ExportLogType::kZstdStream;
   } else if ((magic & 0xffff) == 0x8b1f) {
@@ -240,10 +341,49 @@ std::pair<NSString *, NSString *> Logger::GetContentTypeAndExtension(ExportLogTy
     case ExportLogType::kUncompressedStream: return {@"application/octet-stream", @"stream"};
     case ExportLogType::kGzipStream: return {@"application/gzip", @"gz"};
     case ExportLogType::kZstdStream: return {@"application/zstd", @"zst"};
+    case ExportLogType::kColumnar: return {@"application/x-santa-columnar", @"col"};
     default: return {nil, nil};
   }
 }
 
+// String table encoded files are decoded into a temporary file before export, so that consumers
+// don't need to understand the encoding. Other files are exported as is. Returns nil if the file
+// couldn't be decoded.
+NSFileHandle *Logger::DecodeForExport(NSFileHandle *handle, NSString *path, off_t *size) {
+  absl::StatusOr<ScopedFile> decoded = ScopedFile::CreateTemporary(nil, @"santa_export_XXXXXX");
+  if (!decoded.ok()) {
+    LOGW(@"Unable to create file to decode telemetry file, exporting as is: %@: %s", path,
+         decoded.status().ToString().c_str());
+    return handle;
+  }
+
+  std::vector<std::shared_ptr<const ::fsspool::ZstdDictionary>> dictionaries;
+  if (zstd_dictionary_) {
+    dictionaries.push_back(zstd_dictionary_);
+  }
+
+  absl::StatusOr<bool> was_encoded = ::fsspool::DecodeStringTableFile(
+      handle.fileDescriptor, decoded->UnsafeFD(), std::move(dictionaries));
+  [handle seekToFileOffset:0];
+  if (!was_encoded.ok()) {
+    LOGW(@"Failed to decode telemetry file, exporting as is: %@: %s", path,
+         was_encoded.status().ToString().c_str());
+    return handle;
+  } else if (!*was_encoded) {
+    return handle;
+  }
+
+  struct stat sb;
+  if (fstat(decoded->UnsafeFD(), &sb) != 0 || lseek(decoded->UnsafeFD(), 0, SEEK_SET) != 0) {
+    LOGW(@"Failed to read decoded telemetry file, exporting as is: %@", path);
+    return handle;
+  }
+
+  [handle closeFile];
+  *size = sb.st_size;
+  return decoded->Reader();
+}
+
 bool Logger::OnTimer() {
   ExportTelemetry();
   return true;
@@ -307,6 +447,11 @@ void Logger::ExportTelemetrySerialized() {
         continue;
       }
 
+      // Columnar files are exported as they are
+      if (log_type != ExportLogType::kColumnar) {
+        handle = DecodeForExport(handle, path, &sb.st_size);
+      }
+
       // Track all files as initially unsuccessfully processed
       // in case the export times out.
       tracker_.Track(*file_to_export);
@@ -391,34 +536,35 @@ void Logger::ExportTelemetrySerialized() {
 }
 
 void Logger::Log(std::unique_ptr<EnrichedMessage> msg) {
-  if (ShouldLog(msg->GetTelemetryEvent())) {
-    writer_->Write(serializer_->SerializeMessage(std::move(msg)));
+  TelemetryEvent event = msg->GetTelemetryEvent();
+  if (ShouldLog(event)) {
+    writer_->WriteEvent(serializer_->SerializeMessage(std::move(msg)), event);
   }
 }
 
 void Logger::LogAllowlist(const Message &msg, const std::string_view hash) {
   if (ShouldLog(TelemetryEvent::kAllowlist)) {
-    writer_->Write(serializer_->SerializeAllowlist(msg, hash));
+    writer_->WriteEvent(serializer_->SerializeAllowlist(msg, hash), TelemetryEvent::kAllowlist);
   }
 }
 
 void Logger::LogBundleHashingEvents(NSArray<SNTStoredExecutionEvent *> *events) {
   if (ShouldLog(TelemetryEvent::kBundle)) {
     for (SNTStoredExecutionEvent *se in events) {
-      writer_->Write(serializer_->SerializeBundleHashingEvent(se));
+      writer_->WriteEvent(serializer_->SerializeBundleHashingEvent(se), TelemetryEvent::kBundle);
     }
   }
 }
 
 void Logger::LogDiskAppeared(NSDictionary *props) {
   if (ShouldLog(TelemetryEvent::kDisk)) {
-    writer_->Write(serializer_->SerializeDiskAppeared(props));
+    writer_->WriteEvent(serializer_->SerializeDiskAppeared(props), TelemetryEvent::kDisk);
   }
 }
 
 void Logger::LogDiskDisappeared(NSDictionary *props) {
   if (ShouldLog(TelemetryEvent::kDisk)) {
-    writer_->Write(serializer_->SerializeDiskDisappeared(props));
+    writer_->WriteEvent(serializer_->SerializeDiskDisappeared(props), TelemetryEvent::kDisk);
   }
 }
 
@@ -428,9 +574,10 @@ void Logger::LogFileAccess(const std::string &policy_version, const std::string
                            std::optional<santa::EnrichedFile> enriched_event_target,
                            FileAccessPolicyDecision decision) {
   if (ShouldLog(TelemetryEvent::kFileAccess)) {
-    writer_->Write(serializer_->SerializeFileAccess(policy_version, policy_name, msg,
-                                                    enriched_process, target_index,
-                                                    std::move(enriched_event_target), decision));
+    writer_->WriteEvent(
+        serializer_->SerializeFileAccess(policy_version, policy_name, msg, enriched_process,
+                                         target_index, std::move(enriched_event_target), decision),
+        TelemetryEvent::kFileAccess);
   }
 }
 
@@ -438,6 +585,17 @@ void Logger::Flush() {
   writer_->Flush();
 }
 
+std::optional<Writer::Stats> Logger::GetWriterStats() {
+  return writer_->GetStats();
+}
+
+std::optional<::fsspool::ZstdLevelController::Stats> Logger::GetCompressionStats() {
+  if (!zstd_level_controller_) {
+    return std::nullopt;
+  }
+  return zstd_level_controller_->GetStats();
+}
+
 void Logger::UpdateMachineIDLogging() const {
   serializer_->UpdateMachineID();
 }
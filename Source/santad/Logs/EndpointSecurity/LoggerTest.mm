@@ -38,6 +38,9 @@
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Protobuf.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Serializer.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/Columnar.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ColumnarBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/SeekableStreamBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/File.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/Null.h"
@@ -171,6 +174,7 @@ class MockWriter : public santa::Writer {
     case ExportLogType::kUncompressedStream: magic = ::fsspool::kStreamBatcherMagic; break;
     case ExportLogType::kGzipStream: magic = 0x8b1f; break;
     case ExportLogType::kZstdStream: magic = 0xfd2fb528; break;
+    case ExportLogType::kColumnar: magic = ::fsspool::kColumnarBatchMagic; break;
     default: XCTFail("Creating unsupported file type: %d", fileType); break;
   }
 
@@ -242,6 +246,21 @@ class MockWriter : public santa::Writer {
   XCTAssertNotEqual(nullptr,
                     std::dynamic_pointer_cast<Spool<::fsspool::ZstdStreamBatcher>>(logger.writer_));
 
+  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, TelemetryEvent::kEverything,
+                                     SNTEventLogTypeProtobufStreamZstd, nil, @"/tmp/temppy",
+                                     @"/tmp/spool", 1, 1, 1, 1, 1, 1, 1,
+                                     {.zstd_frame_records = 128}));
+  XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<Protobuf>(logger.serializer_));
+  XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<Spool<::fsspool::SeekableStreamBatcher>>(
+                                 logger.writer_));
+
+  logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, TelemetryEvent::kEverything,
+                                     SNTEventLogTypeProtobufColumnar, nil, @"/tmp/temppy",
+                                     @"/tmp/spool", 1, 1, 1, 1, 1, 1, 1));
+  XCTAssertNotEqual(nullptr, std::dynamic_pointer_cast<Protobuf>(logger.serializer_));
+  XCTAssertNotEqual(nullptr,
+                    std::dynamic_pointer_cast<Spool<::fsspool::ColumnarBatcher>>(logger.writer_));
+
   logger = LoggerPeer(Logger::Create(mockESApi, nil, nil, TelemetryEvent::kEverything,
                                      SNTEventLogTypeJSON, nil, @"/tmp/temppy", @"/tmp/spool", 1, 1,
                                      1, 1, 1, 1, 1));
@@ -534,6 +553,42 @@ class MockWriter : public santa::Writer {
   XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
 }
 
+- (void)testExportColumnarFiles {
+  auto mockWriter = std::make_shared<MockWriter>();
+
+  // Columnar files are batched separately from stream files, and exported as they are
+  NSString *f1 = [self createTestFile:@"f1" contentSize:5 type:ExportLogType::kColumnar];
+  NSString *f2 = [self createTestFile:@"f2" contentSize:10 type:ExportLogType::kZstdStream];
+  NSString *f3 = [self createTestFile:@"f3" contentSize:30 type:ExportLogType::kColumnar];
+
+  XCTAssertEqual(Logger::GetLogType([NSFileHandle fileHandleForReadingAtPath:f1], f1),
+                 ExportLogType::kColumnar);
+
+  [self setExportExpectationSize:35 success:YES];
+  [self setExportExpectationSize:10 success:YES];
+
+  LoggerPeer l(self.mockSyncdQueue, self.exportConfigBlock, TelemetryEvent::kEverything, 5, 1, 10,
+               nullptr, mockWriter);
+
+  EXPECT_CALL(*mockWriter, NextFileToExport)
+      .WillOnce(Return(f1.UTF8String))
+      .WillOnce(Return(f2.UTF8String))
+      .WillOnce(Return(f3.UTF8String))
+      .WillOnce(Return(std::nullopt))
+      .WillOnce(Return(f2.UTF8String))
+      .WillOnce(Return(std::nullopt));
+
+  EXPECT_CALL(*mockWriter, FilesExported(UnorderedElementsAre(Pair(f2.UTF8String, true))))
+      .After(EXPECT_CALL(*mockWriter, FilesExported(UnorderedElementsAre(
+                                          Pair(f1.UTF8String, true), Pair(f2.UTF8String, false),
+                                          Pair(f3.UTF8String, true)))));
+
+  l.ExportTelemetrySerialized();
+
+  XCTAssertTrue(OCMVerifyAll(self.mockSyncdQueue));
+  XCTBubbleMockVerifyAndClearExpectations(mockWriter.get());
+}
+
 - (void)testExportMaxOpenedFiles {
   auto mockWriter = std::make_shared<MockWriter>();
 
@@ -692,6 +747,10 @@ class MockWriter : public santa::Writer {
   typeAndExt = Logger::GetContentTypeAndExtension(ExportLogType::kZstdStream);
   XCTAssertEqualObjects(typeAndExt.first, @"application/zstd");
   XCTAssertEqualObjects(typeAndExt.second, @"zst");
+
+  typeAndExt = Logger::GetContentTypeAndExtension(ExportLogType::kColumnar);
+  XCTAssertEqualObjects(typeAndExt.first, @"application/x-santa-columnar");
+  XCTAssertEqualObjects(typeAndExt.second, @"col");
 }
 
 - (void)testExportSettingsClamp {
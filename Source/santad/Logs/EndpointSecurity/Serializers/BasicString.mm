@@ -39,6 +39,7 @@
 #import "Source/common/String.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/SanitizableString.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Utilities.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/RecordBufferPool.h"
 #import "Source/santad/SNTDecisionCache.h"
 
 namespace santa {
@@ -294,7 +295,7 @@ std::vector<uint8_t> BasicString::FinalizeString(std::string &str) {
   }
   str.append("\n");
 
-  std::vector<uint8_t> vec(str.length());
+  std::vector<uint8_t> vec = RecordBufferPool::Shared().Acquire(str.length());
   std::copy(str.begin(), str.end(), vec.begin());
   return vec;
 }
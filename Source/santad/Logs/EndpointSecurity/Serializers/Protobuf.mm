@@ -39,6 +39,7 @@
 #import "Source/common/String.h"
 #include "Source/santad/EventProviders/EndpointSecurity/EndpointSecurityAPI.h"
 #include "Source/santad/Logs/EndpointSecurity/Serializers/Utilities.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/RecordBufferPool.h"
 #import "Source/santad/SNTDecisionCache.h"
 #include "absl/status/status.h"
 #include "google/protobuf/timestamp.pb.h"
@@ -455,13 +456,14 @@ std::vector<uint8_t> Protobuf::FinalizeProto(::pbv1::SantaMessage *santa_msg) {
       LOGE(@"Failed to convert protobuf to JSON: %s", status.ToString().c_str());
     }
 
-    std::vector<uint8_t> vec(json.begin(), json.end());
+    std::vector<uint8_t> vec = RecordBufferPool::Shared().Acquire(json.size() + 1);
+    std::copy(json.begin(), json.end(), vec.begin());
     // Add a newline to the end of the JSON row.
-    vec.push_back('\n');
+    vec.back() = '\n';
     return vec;
   }
 
-  std::vector<uint8_t> vec(santa_msg->ByteSizeLong());
+  std::vector<uint8_t> vec = RecordBufferPool::Shared().Acquire(santa_msg->ByteSizeLong());
   santa_msg->SerializeWithCachedSizesToArray(vec.data());
   return vec;
 }
@@ -20,6 +20,7 @@
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/binaryproto.pb.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 
 namespace fsspool {
 
@@ -30,7 +31,7 @@ class AnyBatcher {
   inline bool ShouldInitializeBeforeWrite() { return false; }
   absl::Status InitializeBatch(int fd);
   bool NeedToOpenFile();
-  absl::Status Write(std::vector<uint8_t> bytes);
+  absl::Status Write(absl::Span<const uint8_t> bytes);
   absl::StatusOr<size_t> CompleteBatch(int fd);
 
   std::string TypeURL() { return type_url_; }
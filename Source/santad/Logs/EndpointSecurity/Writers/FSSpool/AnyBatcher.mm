@@ -37,7 +37,7 @@ bool AnyBatcher::NeedToOpenFile() {
   return cache_.records().size() > 0;
 }
 
-absl::Status AnyBatcher::Write(std::vector<uint8_t> bytes) {
+absl::Status AnyBatcher::Write(absl::Span<const uint8_t> bytes) {
   google::protobuf::Any any;
   any.set_value(absl::string_view((const char *)bytes.data(), bytes.size()));
   any.set_type_url(type_url_);
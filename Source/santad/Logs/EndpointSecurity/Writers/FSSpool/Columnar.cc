@@ -0,0 +1,912 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/Columnar.h"
+
+#include <climits>
+#include <cstring>
+
+#include "absl/cleanup/cleanup.h"
+#include "absl/strings/str_format.h"
+#include "google/protobuf/wire_format_lite.h"
+
+using google::protobuf::Descriptor;
+using google::protobuf::FieldDescriptor;
+using google::protobuf::OneofDescriptor;
+using google::protobuf::internal::WireFormatLite;
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
+using santa::fsspool::columnar::Column;
+using santa::fsspool::columnar::ColumnarBatch;
+using santa::fsspool::columnar::ColumnGroup;
+using santa::fsspool::columnar::Shape;
+
+namespace fsspool {
+
+namespace {
+
+// Matches the protobuf parser's default recursion limit
+constexpr int kMaxDepth = 100;
+
+constexpr size_t kMaxVarintBytes = 10;
+
+// Shape tokens for the start and end of a nested message, using the wire types
+// protobuf doesn't
+constexpr uint32_t kOpenWireType = 6;
+constexpr uint32_t kCloseToken = 7;
+
+bool IsOpenToken(uint32_t token) {
+  return (token & 7) == kOpenWireType;
+}
+
+// Whether a field's values are stored as bytes rather than numbers
+bool HasBytesValues(uint32_t tag) {
+  WireFormatLite::WireType wire_type = WireFormatLite::GetTagWireType(tag);
+  return wire_type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED ||
+         wire_type == WireFormatLite::WIRETYPE_START_GROUP;
+}
+
+bool IsValueTag(uint32_t tag) {
+  if (WireFormatLite::GetTagFieldNumber(tag) == 0) {
+    return false;
+  }
+  switch (WireFormatLite::GetTagWireType(tag)) {
+    case WireFormatLite::WIRETYPE_VARINT:
+    case WireFormatLite::WIRETYPE_FIXED64:
+    case WireFormatLite::WIRETYPE_LENGTH_DELIMITED:
+    case WireFormatLite::WIRETYPE_START_GROUP:
+    case WireFormatLite::WIRETYPE_FIXED32: return true;
+    default: return false;
+  }
+}
+
+// Width of values written plainly as little endian, or 0 for varints
+size_t FixedWidth(uint32_t tag) {
+  switch (WireFormatLite::GetTagWireType(tag)) {
+    case WireFormatLite::WIRETYPE_FIXED64: return sizeof(uint64_t);
+    case WireFormatLite::WIRETYPE_FIXED32: return sizeof(uint32_t);
+    default: return 0;
+  }
+}
+
+void AppendVarint(std::string &out, uint64_t value) {
+  uint8_t buf[kMaxVarintBytes];
+  uint8_t *end = CodedOutputStream::WriteVarint64ToArray(value, buf);
+  out.append(reinterpret_cast<const char *>(buf), end - buf);
+}
+
+void AppendFixed(std::string &out, uint64_t value, size_t width) {
+  uint8_t buf[sizeof(uint64_t)];
+  if (width == sizeof(uint32_t)) {
+    CodedOutputStream::WriteLittleEndian32ToArray(static_cast<uint32_t>(value),
+                                                  buf);
+  } else {
+    CodedOutputStream::WriteLittleEndian64ToArray(value, buf);
+  }
+  out.append(reinterpret_cast<const char *>(buf), width);
+}
+
+// Appends a 32 bit value to a column key
+void AppendKeyPart(std::string &key, uint32_t value) {
+  key.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+size_t VarintSize(uint64_t value) {
+  return CodedOutputStream::VarintSize64(value);
+}
+
+uint64_t Delta(uint64_t value, uint64_t previous) {
+  return WireFormatLite::ZigZagEncode64(static_cast<int64_t>(value - previous));
+}
+
+// Calls f with the value and length of each run of equal values
+template <typename F>
+void ForEachRun(absl::Span<const uint64_t> values, F f) {
+  size_t start = 0;
+  for (size_t i = 1; i <= values.size(); i++) {
+    if (i == values.size() || values[i] != values[start]) {
+      f(values[start], i - start);
+      start = i;
+    }
+  }
+}
+
+// Returns the smallest encoding of the values, and its size
+std::pair<Column::Encoding, size_t> ChooseEncoding(
+    absl::Span<const uint64_t> values, size_t fixed_width) {
+  size_t plain = 0;
+  size_t delta = 0;
+  uint64_t previous = 0;
+  for (uint64_t value : values) {
+    plain += fixed_width ? fixed_width : VarintSize(value);
+    delta += VarintSize(Delta(value, previous));
+    previous = value;
+  }
+
+  size_t run_length = 0;
+  ForEachRun(values, [&run_length](uint64_t value, size_t length) {
+    run_length += VarintSize(value) + VarintSize(length);
+  });
+
+  if (run_length < plain && run_length <= delta) {
+    return {Column::ENCODING_RUN_LENGTH, run_length};
+  } else if (delta < plain) {
+    return {Column::ENCODING_DELTA, delta};
+  }
+  return {Column::ENCODING_PLAIN, plain};
+}
+
+void AppendNumbers(std::string &out, absl::Span<const uint64_t> values,
+                   Column::Encoding encoding, size_t fixed_width) {
+  switch (encoding) {
+    case Column::ENCODING_RUN_LENGTH:
+      ForEachRun(values, [&out](uint64_t value, size_t length) {
+        AppendVarint(out, value);
+        AppendVarint(out, length);
+      });
+      break;
+    case Column::ENCODING_DELTA: {
+      uint64_t previous = 0;
+      for (uint64_t value : values) {
+        AppendVarint(out, Delta(value, previous));
+        previous = value;
+      }
+      break;
+    }
+    default:
+      for (uint64_t value : values) {
+        if (fixed_width) {
+          AppendFixed(out, value, fixed_width);
+        } else {
+          AppendVarint(out, value);
+        }
+      }
+      break;
+  }
+}
+
+// Reads count values, which must make up all of the data
+bool ReadNumbers(std::string_view data, Column::Encoding encoding,
+                 size_t fixed_width, uint64_t count,
+                 std::vector<uint64_t> &out) {
+  out.clear();
+  out.reserve(std::min<uint64_t>(count, data.size()));
+  CodedInputStream input(reinterpret_cast<const uint8_t *>(data.data()),
+                         static_cast<int>(data.size()));
+
+  switch (encoding) {
+    case Column::ENCODING_PLAIN:
+      while (out.size() < count) {
+        uint64_t value;
+        if (fixed_width == sizeof(uint64_t)) {
+          if (!input.ReadLittleEndian64(&value)) {
+            return false;
+          }
+        } else if (fixed_width == sizeof(uint32_t)) {
+          uint32_t value32;
+          if (!input.ReadLittleEndian32(&value32)) {
+            return false;
+          }
+          value = value32;
+        } else if (!input.ReadVarint64(&value)) {
+          return false;
+        }
+        out.push_back(value);
+      }
+      break;
+    case Column::ENCODING_RUN_LENGTH:
+      while (out.size() < count) {
+        uint64_t value;
+        uint64_t length;
+        if (!input.ReadVarint64(&value) || !input.ReadVarint64(&length) ||
+            length == 0 || length > count - out.size()) {
+          return false;
+        }
+        out.insert(out.end(), length, value);
+      }
+      break;
+    case Column::ENCODING_DELTA: {
+      uint64_t previous = 0;
+      while (out.size() < count) {
+        uint64_t delta;
+        if (!input.ReadVarint64(&delta)) {
+          return false;
+        }
+        previous += static_cast<uint64_t>(WireFormatLite::ZigZagDecode64(delta));
+        out.push_back(previous);
+      }
+      break;
+    }
+    default: return false;
+  }
+
+  return static_cast<size_t>(input.CurrentPosition()) == data.size();
+}
+
+}  // namespace
+
+ColumnarEncoder::ColumnarEncoder(const Descriptor *descriptor,
+                                 const OneofDescriptor *group_by,
+                                 ColumnarOptions options)
+    : descriptor_(descriptor),
+      group_by_(group_by),
+      options_(options),
+      cctx_(ZSTD_createCCtx(), &ZSTD_freeCCtx) {}
+
+void ColumnarEncoder::Reset() {
+  keys_.clear();
+  keys_by_id_.clear();
+  record_count_ = 0;
+  record_groups_.clear();
+  group_ids_.clear();
+  groups_.clear();
+}
+
+absl::Status ColumnarEncoder::Add(absl::Span<const uint8_t> message) {
+  if (message.size() > INT_MAX) {
+    return absl::InvalidArgumentError("Record too large");
+  }
+
+  data_ = message.data();
+  path_.clear();
+  tokens_.clear();
+  leaves_.clear();
+  event_field_ = 0;
+
+  CodedInputStream input(message.data(), static_cast<int>(message.size()));
+  if (!Tokenize(descriptor_, input, 0)) {
+    return absl::DataLossError("Failed to encode malformed message");
+  }
+
+  Commit();
+  return absl::OkStatus();
+}
+
+bool ColumnarEncoder::Tokenize(const Descriptor *descriptor,
+                               CodedInputStream &input, int depth) {
+  while (true) {
+    uint32_t tag = input.ReadTag();
+    if (tag == 0) {
+      return input.ConsumedEntireMessage();
+    }
+
+    int field_number = WireFormatLite::GetTagFieldNumber(tag);
+    const FieldDescriptor *field = descriptor->FindFieldByNumber(field_number);
+    if (depth == 0 && event_field_ == 0 && group_by_ && field &&
+        field->containing_oneof() == group_by_) {
+      event_field_ = field_number;
+    }
+
+    switch (WireFormatLite::GetTagWireType(tag)) {
+      case WireFormatLite::WIRETYPE_VARINT: {
+        uint64_t value;
+        if (!input.ReadVarint64(&value)) {
+          return false;
+        }
+        AddLeaf(tag, value);
+        break;
+      }
+      case WireFormatLite::WIRETYPE_FIXED64: {
+        uint64_t value;
+        if (!input.ReadLittleEndian64(&value)) {
+          return false;
+        }
+        AddLeaf(tag, value);
+        break;
+      }
+      case WireFormatLite::WIRETYPE_FIXED32: {
+        uint32_t value;
+        if (!input.ReadLittleEndian32(&value)) {
+          return false;
+        }
+        AddLeaf(tag, value);
+        break;
+      }
+      case WireFormatLite::WIRETYPE_LENGTH_DELIMITED: {
+        uint32_t length;
+        if (!input.ReadVarint32(&length) || length > INT_MAX) {
+          return false;
+        }
+        int offset = input.CurrentPosition();
+
+        if (field && field->type() == FieldDescriptor::TYPE_MESSAGE &&
+            depth < kMaxDepth) {
+          size_t token_count = tokens_.size();
+          size_t leaf_count = leaves_.size();
+          size_t path_size = path_.size();
+          tokens_.push_back(
+              static_cast<uint32_t>(field_number << 3) | kOpenWireType);
+          AppendKeyPart(path_, field_number);
+
+          CodedInputStream::Limit limit =
+              input.PushLimit(static_cast<int>(length));
+          bool nested = Tokenize(field->message_type(), input, depth + 1) &&
+                        input.BytesUntilLimit() == 0;
+          input.PopLimit(limit);
+          path_.resize(path_size);
+
+          if (nested) {
+            tokens_.push_back(kCloseToken);
+            break;
+          }
+
+          // Not a valid message, e.g. one written with a different schema, so
+          // keep its bytes as they are
+          tokens_.resize(token_count);
+          leaves_.resize(leaf_count);
+          if (!input.Skip(offset + static_cast<int>(length) -
+                          input.CurrentPosition())) {
+            return false;
+          }
+        } else if (!input.Skip(static_cast<int>(length))) {
+          return false;
+        }
+
+        AddLeaf(tag, 0, offset, length);
+        break;
+      }
+      case WireFormatLite::WIRETYPE_START_GROUP: {
+        // Groups are kept as they are, up to and including their end tag
+        int offset = input.CurrentPosition();
+        if (!WireFormatLite::SkipField(&input, tag)) {
+          return false;
+        }
+        AddLeaf(tag, 0, offset, input.CurrentPosition() - offset);
+        break;
+      }
+      default: return false;
+    }
+  }
+}
+
+void ColumnarEncoder::AddLeaf(uint32_t tag, uint64_t number, uint32_t offset,
+                              uint32_t size) {
+  size_t path_size = path_.size();
+  AppendKeyPart(path_, tag);
+  auto [it, inserted] = keys_.try_emplace(path_, keys_by_id_.size());
+  if (inserted) {
+    keys_by_id_.push_back(path_);
+  }
+  path_.resize(path_size);
+
+  tokens_.push_back(tag);
+  leaves_.push_back({
+      .key = it->second,
+      .tag = tag,
+      .number = number,
+      .offset = offset,
+      .size = size,
+  });
+}
+
+void ColumnarEncoder::Commit() {
+  auto [group_it, new_group] =
+      group_ids_.try_emplace(event_field_, groups_.size());
+  if (new_group) {
+    groups_.emplace_back().event_field = event_field_;
+  }
+  GroupBuilder &group = groups_[group_it->second];
+  record_groups_.push_back(group_it->second);
+
+  shape_key_.assign(reinterpret_cast<const char *>(tokens_.data()),
+                    tokens_.size() * sizeof(uint32_t));
+  auto [shape_it, new_shape] =
+      group.shape_ids.try_emplace(shape_key_, group.shapes.size());
+  if (new_shape) {
+    group.shapes.push_back(tokens_);
+  }
+  group.record_shapes.push_back(shape_it->second);
+
+  if (group.column_ids.size() < keys_by_id_.size()) {
+    group.column_ids.resize(keys_by_id_.size(), -1);
+  }
+  for (const Leaf &leaf : leaves_) {
+    int32_t &column_id = group.column_ids[leaf.key];
+    if (column_id < 0) {
+      column_id = static_cast<int32_t>(group.columns.size());
+      group.columns.emplace_back().key = leaf.key;
+    }
+
+    ColumnBuilder &column = group.columns[column_id];
+    if (HasBytesValues(leaf.tag)) {
+      column.bytes.append(reinterpret_cast<const char *>(data_) + leaf.offset,
+                          leaf.size);
+      column.ends.push_back(column.bytes.size());
+    } else {
+      column.numbers.push_back(leaf.number);
+    }
+  }
+
+  group.record_count++;
+  record_count_++;
+}
+
+absl::Status ColumnarEncoder::Finish(std::string &out) {
+  // The batch is started over even if it fails, rather than failing forever
+  absl::Cleanup reset = [this] { Reset(); };
+
+  ColumnarBatch batch;
+  batch.set_version(kColumnarVersion);
+  batch.set_message_type(descriptor_->full_name());
+  batch.set_record_count(record_count_);
+  if (absl::Status status = EncodeNumbers(record_groups_, 0,
+                                          *batch.mutable_record_groups());
+      !status.ok()) {
+    return status;
+  }
+
+  for (const GroupBuilder &group : groups_) {
+    ColumnGroup *encoded_group = batch.add_groups();
+    encoded_group->set_event_field(group.event_field);
+    encoded_group->set_record_count(group.record_count);
+    if (absl::Status status =
+            EncodeNumbers(group.record_shapes, 0,
+                          *encoded_group->mutable_record_shapes());
+        !status.ok()) {
+      return status;
+    }
+
+    for (const std::vector<uint32_t> &tokens : group.shapes) {
+      encoded_group->add_shapes()->mutable_tokens()->Add(tokens.begin(),
+                                                         tokens.end());
+    }
+
+    for (const ColumnBuilder &builder : group.columns) {
+      // Keys are the path followed by the tag
+      const std::string &key = keys_by_id_[builder.key];
+      std::vector<uint32_t> parts(key.size() / sizeof(uint32_t));
+      memcpy(parts.data(), key.data(), key.size());
+
+      Column *column = encoded_group->add_columns();
+      column->mutable_path()->Add(parts.begin(), parts.end() - 1);
+      uint32_t tag = parts.back();
+      absl::Status status = HasBytesValues(tag)
+                                ? EncodeValues(builder, tag, *column)
+                                : EncodeNumbers(builder.numbers, tag, *column);
+      if (!status.ok()) {
+        return status;
+      }
+    }
+  }
+
+  size_t size = batch.ByteSizeLong();
+  if (size > kMaxColumnarBatchSize) {
+    return absl::ResourceExhaustedError("Columnar batch too large");
+  }
+
+  out.clear();
+  out.reserve(sizeof(kColumnarBatchMagic) + kMaxVarintBytes + size);
+  AppendFixed(out, kColumnarBatchMagic, sizeof(kColumnarBatchMagic));
+  AppendVarint(out, size);
+  if (!batch.AppendToString(&out)) {
+    return absl::InternalError("Failed to serialize columnar batch");
+  }
+
+  return absl::OkStatus();
+}
+
+absl::Status ColumnarEncoder::EncodeNumbers(absl::Span<const uint64_t> numbers,
+                                            uint32_t tag, Column &column) {
+  size_t fixed_width = FixedWidth(tag);
+  auto [encoding, size] = ChooseEncoding(numbers, fixed_width);
+
+  std::string data;
+  data.reserve(size);
+  AppendNumbers(data, numbers, encoding, fixed_width);
+
+  column.set_tag(tag);
+  column.set_value_count(numbers.size());
+  column.set_encoding(encoding);
+  return Compress(std::move(data), column);
+}
+
+absl::Status ColumnarEncoder::EncodeValues(const ColumnBuilder &builder,
+                                           uint32_t tag, Column &column) {
+  std::vector<std::string_view> values;
+  values.reserve(builder.ends.size());
+  size_t start = 0;
+  for (size_t end : builder.ends) {
+    values.emplace_back(builder.bytes.data() + start, end - start);
+    start = end;
+  }
+
+  size_t plain_size = 0;
+  absl::flat_hash_map<std::string_view, uint64_t> ids;
+  std::vector<std::string_view> entries;
+  std::vector<uint64_t> indices;
+  indices.reserve(values.size());
+  size_t entries_size = 0;
+  for (std::string_view value : values) {
+    plain_size += VarintSize(value.size()) + value.size();
+    auto [it, inserted] = ids.try_emplace(value, entries.size());
+    if (inserted) {
+      entries.push_back(value);
+      entries_size += VarintSize(value.size()) + value.size();
+    }
+    indices.push_back(it->second);
+  }
+
+  auto [index_encoding, indices_size] = ChooseEncoding(indices, 0);
+  size_t dictionary_size =
+      VarintSize(entries.size()) + entries_size + indices_size;
+
+  std::string data;
+  if (dictionary_size < plain_size) {
+    data.reserve(dictionary_size);
+    AppendVarint(data, entries.size());
+    for (std::string_view entry : entries) {
+      AppendVarint(data, entry.size());
+      data.append(entry);
+    }
+    AppendNumbers(data, indices, index_encoding, 0);
+    column.set_encoding(Column::ENCODING_DICTIONARY);
+    column.set_index_encoding(index_encoding);
+  } else {
+    data.reserve(plain_size);
+    for (std::string_view value : values) {
+      AppendVarint(data, value.size());
+      data.append(value);
+    }
+    column.set_encoding(Column::ENCODING_PLAIN);
+  }
+
+  column.set_tag(tag);
+  column.set_value_count(values.size());
+  return Compress(std::move(data), column);
+}
+
+absl::Status ColumnarEncoder::Compress(std::string data, Column &column) {
+  column.set_uncompressed_size(data.size());
+
+  if (cctx_ && data.size() >= options_.min_compress_size) {
+    std::string compressed(ZSTD_compressBound(data.size()), '\0');
+    size_t result =
+        ZSTD_compressCCtx(cctx_.get(), compressed.data(), compressed.size(),
+                          data.data(), data.size(), options_.compression_level);
+    if (ZSTD_isError(result)) {
+      return absl::InternalError(absl::StrFormat(
+          "Failed to compress column: %s", ZSTD_getErrorName(result)));
+    }
+
+    // Incompressible columns are stored as they are
+    if (result < data.size()) {
+      compressed.resize(result);
+      column.set_compression(Column::COMPRESSION_ZSTD);
+      column.set_data(std::move(compressed));
+      return absl::OkStatus();
+    }
+  }
+
+  column.set_compression(Column::COMPRESSION_NONE);
+  column.set_data(std::move(data));
+  return absl::OkStatus();
+}
+
+ColumnarBatchReader::ColumnarBatchReader(ColumnarBatch batch)
+    : batch_(std::move(batch)), dctx_(ZSTD_createDCtx(), &ZSTD_freeDCtx) {}
+
+absl::StatusOr<std::unique_ptr<ColumnarBatchReader>> ColumnarBatchReader::Create(
+    ColumnarBatch batch, std::function<bool(uint32_t event_field)> include_group) {
+  if (batch.version() != kColumnarVersion) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Unsupported columnar batch version: %d", batch.version()));
+  }
+
+  auto reader = std::unique_ptr<ColumnarBatchReader>(
+      new ColumnarBatchReader(std::move(batch)));
+  if (!reader->dctx_) {
+    return absl::InternalError("Failed to create zstd decompression context");
+  }
+
+  const ColumnarBatch &decoded_batch = reader->batch_;
+  if (absl::Status status = reader->DecodeColumn(decoded_batch.record_groups(),
+                                                 reader->record_groups_);
+      !status.ok()) {
+    return status;
+  }
+  if (reader->record_groups_.numbers.size() != decoded_batch.record_count()) {
+    return absl::DataLossError("Mismatched columnar batch record count");
+  }
+
+  // Groups are sized up front, since decoded columns may refer to themselves
+  reader->groups_.resize(decoded_batch.groups_size());
+  for (int i = 0; i < decoded_batch.groups_size(); i++) {
+    const ColumnGroup &group = decoded_batch.groups(i);
+    if (include_group && !include_group(group.event_field())) {
+      continue;
+    }
+    if (absl::Status status = reader->DecodeGroup(group, reader->groups_[i]);
+        !status.ok()) {
+      return status;
+    }
+  }
+
+  return reader;
+}
+
+absl::Status ColumnarBatchReader::DecodeColumn(const Column &column,
+                                               DecodedColumn &decoded) {
+  if (column.uncompressed_size() > kMaxColumnSize ||
+      column.value_count() > kMaxColumnSize) {
+    return absl::DataLossError("Column too large");
+  }
+
+  switch (column.compression()) {
+    case Column::COMPRESSION_NONE: decoded.data = column.data(); break;
+    case Column::COMPRESSION_ZSTD: {
+      // Checked before allocating, in case the size is corrupt
+      if (ZSTD_getFrameContentSize(column.data().data(), column.data().size()) !=
+          column.uncompressed_size()) {
+        return absl::DataLossError("Mismatched column size");
+      }
+      decoded.decompressed.resize(column.uncompressed_size());
+      size_t result = ZSTD_decompressDCtx(
+          dctx_.get(), decoded.decompressed.data(), decoded.decompressed.size(),
+          column.data().data(), column.data().size());
+      if (ZSTD_isError(result)) {
+        return absl::DataLossError(absl::StrFormat(
+            "Failed to decompress column: %s", ZSTD_getErrorName(result)));
+      }
+      decoded.data = decoded.decompressed;
+      break;
+    }
+    default: return absl::DataLossError("Unsupported column compression");
+  }
+  if (decoded.data.size() != column.uncompressed_size()) {
+    return absl::DataLossError("Mismatched column size");
+  }
+
+  if (!HasBytesValues(column.tag())) {
+    if (!ReadNumbers(decoded.data, column.encoding(), FixedWidth(column.tag()),
+                     column.value_count(), decoded.numbers)) {
+      return absl::DataLossError("Failed to decode column");
+    }
+    return absl::OkStatus();
+  }
+
+  // Length delimited values refer to the column data
+  CodedInputStream input(reinterpret_cast<const uint8_t *>(decoded.data.data()),
+                         static_cast<int>(decoded.data.size()));
+  auto read_values = [&](uint64_t count, std::vector<std::string_view> &values) {
+    values.reserve(std::min<uint64_t>(count, decoded.data.size()));
+    for (uint64_t i = 0; i < count; i++) {
+      uint32_t length;
+      if (!input.ReadVarint32(&length) ||
+          length > decoded.data.size() - input.CurrentPosition()) {
+        return false;
+      }
+      values.emplace_back(decoded.data.data() + input.CurrentPosition(), length);
+      input.Skip(static_cast<int>(length));
+    }
+    return true;
+  };
+
+  if (column.encoding() == Column::ENCODING_PLAIN) {
+    if (!read_values(column.value_count(), decoded.values) ||
+        static_cast<size_t>(input.CurrentPosition()) != decoded.data.size()) {
+      return absl::DataLossError("Failed to decode column");
+    }
+    return absl::OkStatus();
+  } else if (column.encoding() != Column::ENCODING_DICTIONARY) {
+    return absl::DataLossError("Unsupported column encoding");
+  }
+
+  uint64_t entry_count;
+  std::vector<std::string_view> entries;
+  if (!input.ReadVarint64(&entry_count) || entry_count > decoded.data.size() ||
+      !read_values(entry_count, entries) ||
+      !ReadNumbers(decoded.data.substr(input.CurrentPosition()),
+                   column.index_encoding(), 0, column.value_count(),
+                   decoded.numbers)) {
+    return absl::DataLossError("Failed to decode column");
+  }
+
+  decoded.values.reserve(decoded.numbers.size());
+  for (uint64_t index : decoded.numbers) {
+    if (index >= entries.size()) {
+      return absl::DataLossError("Invalid column dictionary index");
+    }
+    decoded.values.push_back(entries[index]);
+  }
+  decoded.numbers.clear();
+  return absl::OkStatus();
+}
+
+absl::Status ColumnarBatchReader::DecodeGroup(const ColumnGroup &group,
+                                              DecodedGroup &decoded) {
+  DecodedColumn record_shapes;
+  if (absl::Status status = DecodeColumn(group.record_shapes(), record_shapes);
+      !status.ok()) {
+    return status;
+  }
+  if (record_shapes.numbers.size() != group.record_count()) {
+    return absl::DataLossError("Mismatched column group record count");
+  }
+  decoded.record_shapes = std::move(record_shapes.numbers);
+
+  decoded.columns.resize(group.columns_size());
+  absl::flat_hash_map<std::string, int32_t> column_ids;
+  for (int i = 0; i < group.columns_size(); i++) {
+    const Column &column = group.columns(i);
+    if (!IsValueTag(column.tag())) {
+      return absl::DataLossError("Invalid column tag");
+    }
+    if (absl::Status status = DecodeColumn(column, decoded.columns[i]);
+        !status.ok()) {
+      return status;
+    }
+
+    std::string key;
+    for (uint32_t field_number : column.path()) {
+      AppendKeyPart(key, field_number);
+    }
+    AppendKeyPart(key, column.tag());
+    if (!column_ids.try_emplace(std::move(key), i).second) {
+      return absl::DataLossError("Duplicate column");
+    }
+  }
+
+  // Resolve the column of each token up front, so that records are reproduced
+  // without looking them up
+  decoded.shape_columns.reserve(group.shapes_size());
+  for (const Shape &shape : group.shapes()) {
+    std::vector<int32_t> &shape_columns = decoded.shape_columns.emplace_back();
+    shape_columns.reserve(shape.tokens_size());
+    std::string path;
+    for (uint32_t token : shape.tokens()) {
+      if (token == kCloseToken) {
+        if (path.empty()) {
+          return absl::DataLossError("Unbalanced shape");
+        }
+        path.resize(path.size() - sizeof(uint32_t));
+        shape_columns.push_back(-1);
+      } else if (IsOpenToken(token)) {
+        if (path.size() / sizeof(uint32_t) >= kMaxDepth ||
+            WireFormatLite::GetTagFieldNumber(token) == 0) {
+          return absl::DataLossError("Invalid shape");
+        }
+        AppendKeyPart(path, WireFormatLite::GetTagFieldNumber(token));
+        shape_columns.push_back(-1);
+      } else {
+        size_t path_size = path.size();
+        AppendKeyPart(path, token);
+        auto it = column_ids.find(path);
+        path.resize(path_size);
+        if (it == column_ids.end()) {
+          return absl::DataLossError("Shape refers to a missing column");
+        }
+        shape_columns.push_back(it->second);
+      }
+    }
+    if (!path.empty()) {
+      return absl::DataLossError("Unbalanced shape");
+    }
+  }
+
+  decoded.included = true;
+  return absl::OkStatus();
+}
+
+absl::StatusOr<absl::Span<const uint8_t>> ColumnarBatchReader::Next() {
+  if (scratch_.empty()) {
+    scratch_.resize(kMaxDepth + 1);
+  }
+
+  while (next_record_ < record_groups_.numbers.size()) {
+    uint64_t group_index = record_groups_.numbers[next_record_++];
+    if (group_index >= groups_.size()) {
+      return absl::DataLossError("Invalid record group");
+    }
+
+    DecodedGroup &group = groups_[group_index];
+    if (!group.included) {
+      continue;
+    }
+    if (group.next >= group.record_shapes.size() ||
+        group.record_shapes[group.next] >= group.shape_columns.size()) {
+      return absl::DataLossError("Invalid record shape");
+    }
+
+    uint64_t shape_index = group.record_shapes[group.next++];
+    const Shape &shape = batch_.groups(static_cast<int>(group_index))
+                             .shapes(static_cast<int>(shape_index));
+    const std::vector<int32_t> &shape_columns = group.shape_columns[shape_index];
+
+    // Nested messages are reproduced in their own buffer, since their length
+    // precedes them
+    uint32_t open_tags[kMaxDepth + 1];
+    int depth = 0;
+    scratch_[0].clear();
+    for (int i = 0; i < shape.tokens_size(); i++) {
+      uint32_t token = shape.tokens(i);
+      if (token == kCloseToken) {
+        const std::string &message = scratch_[depth--];
+        std::string &out = scratch_[depth];
+        AppendVarint(out, open_tags[depth]);
+        AppendVarint(out, message.size());
+        out.append(message);
+        continue;
+      } else if (IsOpenToken(token)) {
+        open_tags[depth++] = WireFormatLite::MakeTag(
+            WireFormatLite::GetTagFieldNumber(token),
+            WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+        scratch_[depth].clear();
+        continue;
+      }
+
+      DecodedColumn &column = group.columns[shape_columns[i]];
+      std::string &out = scratch_[depth];
+      AppendVarint(out, token);
+      if (HasBytesValues(token)) {
+        if (column.next >= column.values.size()) {
+          return absl::DataLossError("Column has too few values");
+        }
+        std::string_view value = column.values[column.next++];
+        // Group values include their end tag, and have no length
+        if (WireFormatLite::GetTagWireType(token) ==
+            WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+          AppendVarint(out, value.size());
+        }
+        out.append(value);
+      } else {
+        if (column.next >= column.numbers.size()) {
+          return absl::DataLossError("Column has too few values");
+        }
+        uint64_t value = column.numbers[column.next++];
+        if (size_t width = FixedWidth(token)) {
+          AppendFixed(out, value, width);
+        } else {
+          AppendVarint(out, value);
+        }
+      }
+    }
+
+    return absl::Span<const uint8_t>(
+        reinterpret_cast<const uint8_t *>(scratch_[0].data()),
+        scratch_[0].size());
+  }
+
+  return absl::OutOfRangeError("No more records");
+}
+
+absl::Status ReadColumnarBatch(CodedInputStream &coded_input,
+                               ColumnarBatch &batch) {
+  // Failing to read the magic value indicates the end of the input
+  uint32_t magic;
+  if (!coded_input.ReadLittleEndian32(&magic)) {
+    return absl::OutOfRangeError("No more data");
+  }
+  if (magic != kColumnarBatchMagic) {
+    return absl::DataLossError("Invalid magic value");
+  }
+
+  uint32_t size;
+  if (!coded_input.ReadVarint32(&size)) {
+    return absl::DataLossError("Failed to read columnar batch size");
+  }
+  if (size > kMaxColumnarBatchSize) {
+    return absl::DataLossError("Columnar batch too large");
+  }
+
+  CodedInputStream::Limit limit = coded_input.PushLimit(static_cast<int>(size));
+  bool parsed = batch.ParseFromCodedStream(&coded_input) &&
+                coded_input.BytesUntilLimit() == 0;
+  coded_input.PopLimit(limit);
+  if (!parsed) {
+    return absl::DataLossError("Failed to parse columnar batch");
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace fsspool
@@ -0,0 +1,201 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_COLUMNAR_H
+#define SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_COLUMNAR_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/columnar.pb.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "zstd.h"
+
+// Columnar encoding of batches of serialized messages, described in
+// columnar.proto.
+//
+// Records are split into fields at the wire level, guided by the message
+// descriptor, without being parsed. Nested messages are split into their own
+// fields, while everything else, including unknown fields, is kept as a value
+// in a column. Records serialized by protobuf are reproduced byte for byte
+// when decoded.
+
+namespace fsspool {
+
+// "SNTC", written before each batch
+inline constexpr uint32_t kColumnarBatchMagic = 0x43544E53;
+inline constexpr uint32_t kColumnarVersion = 1;
+
+// Semi-arbitrary max sizes of a serialized batch and a decompressed column.
+// Batches are held in memory, and spool files are far smaller than this.
+inline constexpr uint32_t kMaxColumnarBatchSize = 1024 * 1024 * 256;
+inline constexpr uint64_t kMaxColumnSize = 1024 * 1024 * 256;
+
+struct ColumnarOptions {
+  int compression_level = 3;
+  // Columns smaller than this aren't worth the zstd frame overhead
+  size_t min_compress_size = 64;
+};
+
+class ColumnarEncoder {
+ public:
+  // Records are grouped by the field of the group_by oneof they contain. If
+  // group_by is null, all records are in a single group.
+  ColumnarEncoder(const google::protobuf::Descriptor *descriptor,
+                  const google::protobuf::OneofDescriptor *group_by,
+                  ColumnarOptions options = {});
+
+  // Adds a serialized message to the batch
+  absl::Status Add(absl::Span<const uint8_t> message);
+
+  size_t record_count() const { return record_count_; }
+
+  // Writes the batch, preceded by the magic value and its size, replacing the
+  // contents of out. The encoder is then ready to start a new batch.
+  absl::Status Finish(std::string &out);
+
+  // Discards the records added since the last batch
+  void Reset();
+
+ private:
+  struct Leaf {
+    uint32_t key;
+    uint32_t tag;
+    uint64_t number;
+    uint32_t offset;
+    uint32_t size;
+  };
+
+  struct ColumnBuilder {
+    uint32_t key;
+    std::vector<uint64_t> numbers;
+    // Length delimited values, concatenated, and the end offset of each
+    std::string bytes;
+    std::vector<size_t> ends;
+  };
+
+  struct GroupBuilder {
+    uint32_t event_field;
+    uint64_t record_count = 0;
+    std::vector<uint64_t> record_shapes;
+    absl::flat_hash_map<std::string, uint32_t> shape_ids;
+    std::vector<std::vector<uint32_t>> shapes;
+    // Index in columns by key, or -1 if the group has no such column
+    std::vector<int32_t> column_ids;
+    std::vector<ColumnBuilder> columns;
+  };
+
+  bool Tokenize(const google::protobuf::Descriptor *descriptor,
+                google::protobuf::io::CodedInputStream &input, int depth);
+  void AddLeaf(uint32_t tag, uint64_t number, uint32_t offset = 0,
+               uint32_t size = 0);
+  void Commit();
+  absl::Status EncodeNumbers(absl::Span<const uint64_t> numbers, uint32_t tag,
+                             ::santa::fsspool::columnar::Column &column);
+  absl::Status EncodeValues(const ColumnBuilder &builder, uint32_t tag,
+                            ::santa::fsspool::columnar::Column &column);
+  absl::Status Compress(std::string data,
+                        ::santa::fsspool::columnar::Column &column);
+
+  const google::protobuf::Descriptor *descriptor_;
+  const google::protobuf::OneofDescriptor *group_by_;
+  ColumnarOptions options_;
+  std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> cctx_;
+
+  // Columns are keyed by the field numbers of the messages containing the
+  // field followed by its tag, packed as 32 bit values
+  absl::flat_hash_map<std::string, uint32_t> keys_;
+  std::vector<std::string> keys_by_id_;
+
+  uint64_t record_count_ = 0;
+  std::vector<uint64_t> record_groups_;
+  absl::flat_hash_map<uint32_t, uint32_t> group_ids_;
+  std::vector<GroupBuilder> groups_;
+
+  // The record being encoded
+  const uint8_t *data_ = nullptr;
+  std::string path_;
+  std::vector<uint32_t> tokens_;
+  std::vector<Leaf> leaves_;
+  uint32_t event_field_ = 0;
+  std::string shape_key_;
+};
+
+// Reproduces the records of a batch, in the order they were added
+class ColumnarBatchReader {
+ public:
+  // Only the columns of groups for which include_group returns true are
+  // decoded, and records of other groups are skipped.
+  static absl::StatusOr<std::unique_ptr<ColumnarBatchReader>> Create(
+      ::santa::fsspool::columnar::ColumnarBatch batch,
+      std::function<bool(uint32_t event_field)> include_group = nullptr);
+
+  // Returns the next record, which remains valid until the following call, or
+  // OutOfRangeError once all records were read.
+  absl::StatusOr<absl::Span<const uint8_t>> Next();
+
+ private:
+  struct DecodedColumn {
+    // The column data, either in the batch or decompressed
+    std::string_view data;
+    std::string decompressed;
+    std::vector<uint64_t> numbers;
+    std::vector<std::string_view> values;
+    size_t next = 0;
+  };
+
+  struct DecodedGroup {
+    bool included = false;
+    std::vector<uint64_t> record_shapes;
+    size_t next = 0;
+    std::vector<DecodedColumn> columns;
+    // The column of each token of each shape, or -1 for nested messages
+    std::vector<std::vector<int32_t>> shape_columns;
+  };
+
+  explicit ColumnarBatchReader(::santa::fsspool::columnar::ColumnarBatch batch);
+
+  absl::Status DecodeColumn(const ::santa::fsspool::columnar::Column &column,
+                            DecodedColumn &decoded);
+  absl::Status DecodeGroup(const ::santa::fsspool::columnar::ColumnGroup &group,
+                           DecodedGroup &decoded);
+
+  ::santa::fsspool::columnar::ColumnarBatch batch_;
+  std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> dctx_;
+  DecodedColumn record_groups_;
+  std::vector<DecodedGroup> groups_;
+  uint64_t next_record_ = 0;
+
+  // Buffers for the record being reproduced, one per level of nesting
+  std::vector<std::string> scratch_;
+};
+
+// Reads the next batch of a columnar spool file. Returns OutOfRangeError once
+// the input is exhausted.
+absl::Status ReadColumnarBatch(
+    google::protobuf::io::CodedInputStream &coded_input,
+    ::santa::fsspool::columnar::ColumnarBatch &batch);
+
+}  // namespace fsspool
+
+#endif  // SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_COLUMNAR_H
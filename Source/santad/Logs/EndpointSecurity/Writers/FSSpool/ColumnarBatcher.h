@@ -0,0 +1,43 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_COLUMNARBATCHER_H_
+#define SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_COLUMNARBATCHER_H_
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/Columnar.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+
+namespace fsspool {
+
+// Buffers the SantaMessage records of a batch, grouped by event type, and
+// writes them as a single columnar batch when the batch is completed.
+class ColumnarBatcher {
+ public:
+  explicit ColumnarBatcher(ColumnarOptions options = {});
+
+  inline bool ShouldInitializeBeforeWrite() { return false; }
+  absl::Status InitializeBatch(int fd);
+  bool NeedToOpenFile();
+  absl::Status Write(absl::Span<const uint8_t> bytes);
+  absl::StatusOr<size_t> CompleteBatch(int fd);
+
+ private:
+  ColumnarEncoder encoder_;
+};
+
+}  // namespace fsspool
+
+#endif  // SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_COLUMNARBATCHER_H_
@@ -0,0 +1,52 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ColumnarBatcher.h"
+
+#include "Source/common/santa_proto_include_wrapper.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/fsspool_platform_specific.h"
+
+namespace fsspool {
+
+ColumnarBatcher::ColumnarBatcher(ColumnarOptions options)
+    : encoder_(::santa::pb::v1::SantaMessage::descriptor(),
+               ::santa::pb::v1::SantaMessage::descriptor()->FindOneofByName("event"), options) {}
+
+absl::Status ColumnarBatcher::InitializeBatch(int fd) {
+  return absl::OkStatus();
+}
+
+bool ColumnarBatcher::NeedToOpenFile() {
+  // Only indicate a new file should be opened if there are records to write.
+  return encoder_.record_count() > 0;
+}
+
+absl::Status ColumnarBatcher::Write(absl::Span<const uint8_t> bytes) {
+  return encoder_.Add(bytes);
+}
+
+absl::StatusOr<size_t> ColumnarBatcher::CompleteBatch(int fd) {
+  std::string batch;
+  if (absl::Status status = encoder_.Finish(batch); !status.ok()) {
+    return status;
+  }
+
+  if (absl::Status status = WriteBuffer(fd, batch); !status.ok()) {
+    return status;
+  }
+
+  return batch.size();
+}
+
+}  // namespace fsspool
@@ -0,0 +1,259 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "Source/common/santa_proto_include_wrapper.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/Columnar.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ColumnarBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/columnar.pb.h"
+#include "absl/status/statusor.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+
+using fsspool::ColumnarBatchReader;
+using fsspool::ColumnarEncoder;
+using santa::fsspool::columnar::ColumnarBatch;
+namespace pbv1 = ::santa::pb::v1;
+
+namespace {
+
+absl::Span<const uint8_t> AsSpan(const std::string &s) {
+  return absl::Span<const uint8_t>(reinterpret_cast<const uint8_t *>(s.data()), s.size());
+}
+
+ColumnarEncoder MakeEncoder() {
+  return ColumnarEncoder(pbv1::SantaMessage::descriptor(),
+                         pbv1::SantaMessage::descriptor()->FindOneofByName("event"));
+}
+
+// Serialized executions interleaved with forks and closes
+std::vector<std::string> MakeRecords(int count) {
+  std::vector<std::string> records;
+  for (int i = 0; i < count; i++) {
+    pbv1::SantaMessage msg;
+    msg.set_machine_id("my-machine-id");
+    msg.mutable_event_time()->set_seconds(1700000000 + i);
+    if (i % 3 == 0) {
+      pbv1::Execution *exec = msg.mutable_execution();
+      exec->mutable_target()->mutable_id()->set_pid(100 + i);
+      exec->mutable_target()->mutable_executable()->set_path(
+          "/Applications/App" + std::to_string(i % 4) + ".app/Contents/MacOS/App");
+      exec->mutable_instigator()->mutable_executable()->set_path("/bin/zsh");
+      for (int j = 0; j <= i % 5; j++) {
+        exec->add_args("--arg-" + std::to_string(j));
+      }
+      exec->set_decision(pbv1::Execution::DECISION_ALLOW);
+    } else if (i % 3 == 1) {
+      msg.mutable_fork()->mutable_instigator()->mutable_id()->set_pid(100 + i);
+      msg.mutable_fork()->mutable_child()->mutable_id()->set_pid(200 + i);
+    } else {
+      msg.mutable_close()->mutable_instigator()->mutable_id()->set_pid(100 + i);
+      msg.mutable_close()->mutable_target()->set_path("/tmp/file" + std::to_string(i % 2));
+      msg.mutable_close()->set_modified(i % 4 == 0);
+    }
+    records.push_back(msg.SerializeAsString());
+  }
+  return records;
+}
+
+absl::StatusOr<std::unique_ptr<ColumnarBatchReader>> ReadBatch(
+    const std::string &encoded, std::function<bool(uint32_t)> include_group = nullptr) {
+  google::protobuf::io::CodedInputStream coded_input(
+      reinterpret_cast<const uint8_t *>(encoded.data()), static_cast<int>(encoded.size()));
+  ColumnarBatch batch;
+  if (absl::Status status = fsspool::ReadColumnarBatch(coded_input, batch); !status.ok()) {
+    return status;
+  }
+  return ColumnarBatchReader::Create(std::move(batch), std::move(include_group));
+}
+
+std::vector<std::string> ReadAll(ColumnarBatchReader &reader) {
+  std::vector<std::string> records;
+  absl::StatusOr<absl::Span<const uint8_t>> record;
+  while ((record = reader.Next()).ok()) {
+    records.emplace_back(reinterpret_cast<const char *>(record->data()), record->size());
+  }
+  return records;
+}
+
+}  // namespace
+
+@interface ColumnarTest : XCTestCase
+@end
+
+@implementation ColumnarTest
+
+- (void)testRoundTrip {
+  ColumnarEncoder encoder = MakeEncoder();
+  std::vector<std::string> records = MakeRecords(300);
+  size_t original_size = 0;
+  for (const std::string &record : records) {
+    XCTAssertTrue(encoder.Add(AsSpan(record)).ok());
+    original_size += record.size();
+  }
+  XCTAssertEqual(encoder.record_count(), records.size());
+
+  std::string encoded;
+  XCTAssertTrue(encoder.Finish(encoded).ok());
+  XCTAssertEqual(encoder.record_count(), 0);
+  XCTAssertLessThan(encoded.size(), original_size / 4);
+
+  absl::StatusOr<std::unique_ptr<ColumnarBatchReader>> reader = ReadBatch(encoded);
+  XCTAssertTrue(reader.ok());
+  XCTAssertTrue(ReadAll(**reader) == records);
+  XCTAssertTrue(absl::IsOutOfRange((*reader)->Next().status()));
+
+  // The encoder starts over after each batch
+  XCTAssertTrue(encoder.Add(AsSpan(records[1])).ok());
+  XCTAssertTrue(encoder.Finish(encoded).ok());
+  reader = ReadBatch(encoded);
+  XCTAssertTrue(reader.ok());
+  XCTAssertTrue(ReadAll(**reader) == std::vector<std::string>{records[1]});
+}
+
+- (void)testGroups {
+  ColumnarEncoder encoder = MakeEncoder();
+  std::vector<std::string> records = MakeRecords(30);
+  for (const std::string &record : records) {
+    XCTAssertTrue(encoder.Add(AsSpan(record)).ok());
+  }
+  std::string encoded;
+  XCTAssertTrue(encoder.Finish(encoded).ok());
+
+  google::protobuf::io::CodedInputStream coded_input(
+      reinterpret_cast<const uint8_t *>(encoded.data()), static_cast<int>(encoded.size()));
+  ColumnarBatch batch;
+  XCTAssertTrue(fsspool::ReadColumnarBatch(coded_input, batch).ok());
+  XCTAssertEqual(batch.record_count(), records.size());
+  XCTAssertEqual(batch.groups_size(), 3);
+  XCTAssertEqual(batch.groups(0).event_field(), pbv1::SantaMessage::kExecutionFieldNumber);
+  XCTAssertEqual(batch.groups(0).record_count(), 10);
+  XCTAssertTrue(batch.message_type() == "santa.pb.v1.SantaMessage");
+
+  // Only records of the included groups are reproduced, in their original order
+  absl::StatusOr<std::unique_ptr<ColumnarBatchReader>> reader =
+      ReadBatch(encoded, [](uint32_t event_field) {
+        return event_field == pbv1::SantaMessage::kCloseFieldNumber;
+      });
+  XCTAssertTrue(reader.ok());
+  std::vector<std::string> expected;
+  for (size_t i = 2; i < records.size(); i += 3) {
+    expected.push_back(records[i]);
+  }
+  XCTAssertTrue(ReadAll(**reader) == expected);
+}
+
+- (void)testUnknownAndInvalidFields {
+  pbv1::SantaMessage msg;
+  msg.mutable_execution()->mutable_target()->mutable_id()->set_pid(1);
+  std::string record = msg.SerializeAsString();
+
+  // An unknown field and a group
+  google::protobuf::io::StringOutputStream output(&record);
+  {
+    google::protobuf::io::CodedOutputStream coded_output(&output);
+    coded_output.WriteTag((1000 << 3) | 5);
+    coded_output.WriteLittleEndian32(42);
+    coded_output.WriteTag((1001 << 3) | 3);
+    coded_output.WriteTag((1 << 3) | 0);
+    coded_output.WriteVarint32(7);
+    coded_output.WriteTag((1001 << 3) | 4);
+    // A message field whose contents don't parse as a message
+    coded_output.WriteTag((pbv1::SantaMessage::kEventTimeFieldNumber << 3) | 2);
+    coded_output.WriteVarint32(3);
+    coded_output.WriteRaw("\xff\xff\xff", 3);
+  }
+
+  ColumnarEncoder encoder = MakeEncoder();
+  XCTAssertTrue(encoder.Add(AsSpan(record)).ok());
+  std::string encoded;
+  XCTAssertTrue(encoder.Finish(encoded).ok());
+
+  absl::StatusOr<std::unique_ptr<ColumnarBatchReader>> reader = ReadBatch(encoded);
+  XCTAssertTrue(reader.ok());
+  XCTAssertTrue(ReadAll(**reader) == std::vector<std::string>{record});
+}
+
+- (void)testMalformed {
+  ColumnarEncoder encoder = MakeEncoder();
+  std::vector<std::string> records = MakeRecords(10);
+
+  // Truncated records aren't added to the batch
+  std::string truncated = records[0].substr(0, records[0].size() - 3);
+  XCTAssertFalse(encoder.Add(AsSpan(truncated)).ok());
+  XCTAssertEqual(encoder.record_count(), 0);
+
+  for (const std::string &record : records) {
+    XCTAssertTrue(encoder.Add(AsSpan(record)).ok());
+  }
+  std::string encoded;
+  XCTAssertTrue(encoder.Finish(encoded).ok());
+
+  // Truncated and corrupted batches fail to read rather than producing records
+  XCTAssertFalse(ReadBatch(encoded.substr(0, encoded.size() - 10)).ok());
+  for (size_t i = 8; i < encoded.size(); i += 7) {
+    std::string corrupted = encoded;
+    corrupted[i] ^= 0x55;
+    absl::StatusOr<std::unique_ptr<ColumnarBatchReader>> reader = ReadBatch(corrupted);
+    if (reader.ok()) {
+      while ((*reader)->Next().ok()) {
+      }
+    }
+  }
+}
+
+- (void)testBatcher {
+  std::vector<std::string> records = MakeRecords(50);
+
+  std::string path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"columnar_batch"]
+                         .UTF8String;
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  unlink(path.c_str());
+  XCTAssertGreaterThanOrEqual(fd, 0);
+
+  // Batches are written as one batch when they are completed
+  fsspool::ColumnarBatcher batcher;
+  XCTAssertFalse(batcher.NeedToOpenFile());
+  XCTAssertTrue(batcher.InitializeBatch(fd).ok());
+  for (const std::string &record : records) {
+    XCTAssertTrue(batcher.Write(AsSpan(record)).ok());
+  }
+  XCTAssertTrue(batcher.NeedToOpenFile());
+  absl::StatusOr<size_t> size = batcher.CompleteBatch(fd);
+  XCTAssertTrue(size.ok());
+  XCTAssertFalse(batcher.NeedToOpenFile());
+  XCTAssertEqual((size_t)lseek(fd, 0, SEEK_CUR), *size);
+
+  lseek(fd, 0, SEEK_SET);
+  google::protobuf::io::FileInputStream file_input(fd);
+  google::protobuf::io::CodedInputStream coded_input(&file_input);
+  ColumnarBatch batch;
+  XCTAssertTrue(fsspool::ReadColumnarBatch(coded_input, batch).ok());
+  absl::StatusOr<std::unique_ptr<ColumnarBatchReader>> reader =
+      ColumnarBatchReader::Create(std::move(batch));
+  XCTAssertTrue(reader.ok());
+  XCTAssertTrue(ReadAll(**reader) == records);
+  XCTAssertTrue(absl::IsOutOfRange(fsspool::ReadColumnarBatch(coded_input, batch)));
+
+  close(fd);
+}
+
+@end
@@ -0,0 +1,196 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/FrameIndex.h"
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+
+namespace fsspool {
+
+namespace {
+
+template <typename T>
+void PutLittleEndian(std::string &out, T value) {
+  for (size_t i = 0; i < sizeof(T); i++) {
+    out.push_back(static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) &
+                                    0xff));
+  }
+}
+
+template <typename T>
+T GetLittleEndian(const uint8_t *data) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < sizeof(T); i++) {
+    value |= static_cast<uint64_t>(data[i]) << (8 * i);
+  }
+  return static_cast<T>(value);
+}
+
+absl::Status ReadFully(int fd, uint8_t *buf, size_t size, off_t offset) {
+  while (size > 0) {
+    ssize_t n = pread(fd, buf, size, offset);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return absl::ErrnoToStatus(errno, "pread() failed");
+    } else if (n == 0) {
+      return absl::DataLossError("Unexpected end of file");
+    }
+    buf += n;
+    size -= n;
+    offset += n;
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+std::string EncodeFrameIndex(absl::Span<const FrameIndexEntry> entries) {
+  size_t body_size =
+      entries.size() * kFrameIndexEntrySize + kFrameIndexFooterSize;
+
+  std::string out;
+  out.reserve(kFrameIndexHeaderSize + body_size);
+  PutLittleEndian(out, kFrameIndexSkippableMagic);
+  PutLittleEndian(out, static_cast<uint32_t>(body_size));
+
+  for (const FrameIndexEntry &entry : entries) {
+    PutLittleEndian(out, entry.offset);
+    PutLittleEndian(out, entry.compressed_size);
+    PutLittleEndian(out, entry.uncompressed_size);
+    PutLittleEndian(out, entry.record_count);
+    PutLittleEndian(out, absl::ToUnixNanos(entry.first_event_time));
+    PutLittleEndian(out, absl::ToUnixNanos(entry.last_event_time));
+  }
+
+  PutLittleEndian(out, static_cast<uint32_t>(entries.size()));
+  PutLittleEndian(out, kFrameIndexVersion);
+  PutLittleEndian(out, kFrameIndexMagic);
+  return out;
+}
+
+absl::StatusOr<std::vector<FrameIndexEntry>> DecodeFrameIndex(
+    absl::Span<const uint8_t> data) {
+  if (data.size() < kFrameIndexHeaderSize + kFrameIndexFooterSize) {
+    return absl::NotFoundError("Too small to hold a frame index");
+  }
+
+  const uint8_t *footer = data.data() + data.size() - kFrameIndexFooterSize;
+  if (GetLittleEndian<uint32_t>(footer + 8) != kFrameIndexMagic) {
+    return absl::NotFoundError("Missing frame index");
+  }
+  if (uint32_t version = GetLittleEndian<uint32_t>(footer + 4);
+      version != kFrameIndexVersion) {
+    return absl::UnimplementedError(
+        absl::StrFormat("Unsupported frame index version: %u", version));
+  }
+
+  uint64_t count = GetLittleEndian<uint32_t>(footer);
+  if (data.size() != kFrameIndexHeaderSize + count * kFrameIndexEntrySize +
+                         kFrameIndexFooterSize ||
+      GetLittleEndian<uint32_t>(data.data()) != kFrameIndexSkippableMagic ||
+      GetLittleEndian<uint32_t>(data.data() + 4) !=
+          data.size() - kFrameIndexHeaderSize) {
+    return absl::DataLossError("Malformed frame index");
+  }
+
+  std::vector<FrameIndexEntry> entries;
+  entries.reserve(count);
+  const uint8_t *pos = data.data() + kFrameIndexHeaderSize;
+  for (uint64_t i = 0; i < count; i++, pos += kFrameIndexEntrySize) {
+    FrameIndexEntry entry{
+        .offset = GetLittleEndian<uint64_t>(pos),
+        .compressed_size = GetLittleEndian<uint64_t>(pos + 8),
+        .uncompressed_size = GetLittleEndian<uint64_t>(pos + 16),
+        .record_count = GetLittleEndian<uint64_t>(pos + 24),
+        .first_event_time =
+            absl::FromUnixNanos(GetLittleEndian<int64_t>(pos + 32)),
+        .last_event_time =
+            absl::FromUnixNanos(GetLittleEndian<int64_t>(pos + 40)),
+    };
+
+    // Frames are written back to back from the start of the file
+    uint64_t expected_offset =
+        entries.empty()
+            ? 0
+            : entries.back().offset + entries.back().compressed_size;
+    if (entry.offset != expected_offset) {
+      return absl::DataLossError("Frame index entries are not contiguous");
+    }
+    entries.push_back(entry);
+  }
+
+  return entries;
+}
+
+absl::StatusOr<std::vector<FrameIndexEntry>> ReadFrameIndex(int fd) {
+  struct stat sb;
+  if (fstat(fd, &sb) != 0) {
+    return absl::ErrnoToStatus(errno, "fstat() failed");
+  }
+
+  uint64_t file_size = static_cast<uint64_t>(sb.st_size);
+  if (file_size < kFrameIndexHeaderSize + kFrameIndexFooterSize) {
+    return absl::NotFoundError("Too small to hold a frame index");
+  }
+
+  uint8_t footer[kFrameIndexFooterSize];
+  if (absl::Status status = ReadFully(fd, footer, sizeof(footer),
+                                      file_size - kFrameIndexFooterSize);
+      !status.ok()) {
+    return status;
+  }
+  if (GetLittleEndian<uint32_t>(footer + 8) != kFrameIndexMagic) {
+    return absl::NotFoundError("Missing frame index");
+  }
+
+  uint64_t index_size = kFrameIndexHeaderSize +
+                        GetLittleEndian<uint32_t>(footer) *
+                            static_cast<uint64_t>(kFrameIndexEntrySize) +
+                        kFrameIndexFooterSize;
+  if (index_size > file_size) {
+    return absl::DataLossError("Frame index larger than file");
+  }
+
+  std::vector<uint8_t> data(index_size);
+  if (absl::Status status =
+          ReadFully(fd, data.data(), data.size(), file_size - index_size);
+      !status.ok()) {
+    return status;
+  }
+
+  absl::StatusOr<std::vector<FrameIndexEntry>> entries =
+      DecodeFrameIndex(data);
+  if (!entries.ok()) {
+    return entries.status();
+  }
+
+  // The frames must account for everything preceding the index
+  uint64_t frames_end = entries->empty() ? 0
+                                         : entries->back().offset +
+                                               entries->back().compressed_size;
+  if (frames_end != file_size - index_size) {
+    return absl::DataLossError("Frame index does not match file contents");
+  }
+
+  return entries;
+}
+
+}  // namespace fsspool
@@ -0,0 +1,84 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_FRAMEINDEX_H_
+#define SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_FRAMEINDEX_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+
+namespace fsspool {
+
+// Seekable spool files are a sequence of independently decompressible zstd
+// frames followed by an index of those frames. The index is stored in a zstd
+// skippable frame, which decoders pass over, so the file remains an ordinary
+// zstd stream to readers unaware of the index.
+//
+// Index layout, all integers little endian:
+//   uint32  kFrameIndexSkippableMagic
+//   uint32  Size of the rest of the index
+//   Entry   One per frame, kFrameIndexEntrySize bytes each:
+//             uint64 offset, uint64 compressed size,
+//             uint64 uncompressed size, uint64 record count,
+//             int64 first event time (ns), int64 last event time (ns)
+//   uint32  Number of entries
+//   uint32  kFrameIndexVersion
+//   uint32  kFrameIndexMagic
+//
+// The footer ends the file so that readers can locate the index without
+// scanning the frames.
+static constexpr uint32_t kFrameIndexSkippableMagic = 0x184D2A5A;
+static constexpr uint32_t kFrameIndexMagic = 0x58544E53;
+static constexpr uint32_t kFrameIndexVersion = 1;
+static constexpr size_t kFrameIndexEntrySize = 6 * sizeof(uint64_t);
+static constexpr size_t kFrameIndexHeaderSize = 2 * sizeof(uint32_t);
+static constexpr size_t kFrameIndexFooterSize = 3 * sizeof(uint32_t);
+
+struct FrameIndexEntry {
+  // Location of the compressed frame within the file
+  uint64_t offset = 0;
+  uint64_t compressed_size = 0;
+  // Size of the stream batcher records held in the frame
+  uint64_t uncompressed_size = 0;
+  uint64_t record_count = 0;
+  // Range of event times of the records in the frame. Both are the Unix epoch
+  // if no record carried an event time.
+  absl::Time first_event_time = absl::UnixEpoch();
+  absl::Time last_event_time = absl::UnixEpoch();
+
+  bool operator==(const FrameIndexEntry &) const = default;
+};
+
+// Serializes the index, including the skippable frame header and footer, to be
+// appended after the last frame.
+std::string EncodeFrameIndex(absl::Span<const FrameIndexEntry> entries);
+
+// Parses an index previously returned by EncodeFrameIndex. The data must start
+// at the skippable frame header and end with the footer.
+absl::StatusOr<std::vector<FrameIndexEntry>> DecodeFrameIndex(
+    absl::Span<const uint8_t> data);
+
+// Reads the index at the end of the given file. Returns NotFoundError if the
+// file doesn't end with an index, e.g. when it was written without one or the
+// writer did not complete the file.
+absl::StatusOr<std::vector<FrameIndexEntry>> ReadFrameIndex(int fd);
+
+}  // namespace fsspool
+
+#endif  // SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_FRAMEINDEX_H_
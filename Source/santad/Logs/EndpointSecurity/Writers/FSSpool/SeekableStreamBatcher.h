@@ -0,0 +1,81 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_SEEKABLESTREAMBATCHER_H_
+#define SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_SEEKABLESTREAMBATCHER_H_
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/FrameIndex.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+
+namespace fsspool {
+
+struct SeekableStreamOptions {
+  // A frame is ended once it holds this many records or uncompressed bytes,
+  // whichever comes first. Zero disables the respective limit.
+  size_t max_frame_records = 0;
+  size_t max_frame_bytes = 0;
+};
+
+// Writes the same records as ZstdStreamBatcher, but splits each file into
+// independently decompressible zstd frames and appends a FrameIndex. Readers
+// may use the index to seek to frames by event time, decode frames in
+// parallel, or skip frames entirely.
+class SeekableStreamBatcher {
+ public:
+  template <typename F>
+  SeekableStreamBatcher(F &&factory, SeekableStreamOptions options = {})
+      : factory_(std::forward<F>(factory)), options_(options) {}
+
+  inline bool ShouldInitializeBeforeWrite() { return true; }
+  absl::Status InitializeBatch(int fd);
+  inline bool NeedToOpenFile() { return true; }
+  absl::Status Write(absl::Span<const uint8_t> bytes);
+  absl::StatusOr<size_t> CompleteBatch(int fd);
+
+  // Returns the event time of a serialized SantaMessage, if present.
+  static std::optional<absl::Time> EventTime(absl::Span<const uint8_t> bytes);
+
+ private:
+  absl::Status EndFrame();
+
+  std::function<std::shared_ptr<ZstdOutputStream>(
+      google::protobuf::io::ZeroCopyOutputStream *)>
+      factory_;
+  SeekableStreamOptions options_;
+  std::shared_ptr<google::protobuf::io::FileOutputStream> raw_output_;
+  std::shared_ptr<ZstdOutputStream> compressed_output_;
+  std::shared_ptr<google::protobuf::io::CodedOutputStream> coded_output_;
+
+  std::vector<FrameIndexEntry> index_;
+  // The frame currently being written, and where its records began in the
+  // uncompressed stream
+  FrameIndexEntry frame_;
+  bool frame_has_event_time_ = false;
+  int64_t frame_uncompressed_start_ = 0;
+};
+
+}  // namespace fsspool
+
+#endif  // SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_SEEKABLESTREAMBATCHER_H_
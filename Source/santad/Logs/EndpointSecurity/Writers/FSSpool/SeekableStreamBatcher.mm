@@ -0,0 +1,169 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/SeekableStreamBatcher.h"
+
+#include <algorithm>
+#include <climits>
+#include <string>
+
+#include "Source/common/SNTXxhash.h"
+#include "Source/common/santa_proto_include_wrapper.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
+#include "google/protobuf/timestamp.pb.h"
+#include "google/protobuf/wire_format_lite.h"
+
+using google::protobuf::internal::WireFormatLite;
+
+namespace fsspool {
+
+std::optional<absl::Time> SeekableStreamBatcher::EventTime(absl::Span<const uint8_t> bytes) {
+  // Fields are serialized in field number order, so event_time is found within the first few
+  // bytes and the rest of the message is never examined.
+  google::protobuf::io::CodedInputStream input(bytes.data(), static_cast<int>(bytes.size()));
+  while (uint32_t tag = input.ReadTag()) {
+    int field = WireFormatLite::GetTagFieldNumber(tag);
+    if (field > ::santa::pb::v1::SantaMessage::kEventTimeFieldNumber) {
+      break;
+    }
+
+    if (field == ::santa::pb::v1::SantaMessage::kEventTimeFieldNumber &&
+        WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+      uint32_t length;
+      if (!input.ReadVarint32(&length)) {
+        break;
+      }
+
+      google::protobuf::io::CodedInputStream::Limit limit = input.PushLimit(length);
+      google::protobuf::Timestamp timestamp;
+      if (!timestamp.ParseFromCodedStream(&input) || !input.ConsumedEntireMessage()) {
+        break;
+      }
+      input.PopLimit(limit);
+
+      return absl::FromUnixSeconds(timestamp.seconds()) + absl::Nanoseconds(timestamp.nanos());
+    }
+
+    if (!WireFormatLite::SkipField(&input, tag)) {
+      break;
+    }
+  }
+
+  return std::nullopt;
+}
+
+absl::Status SeekableStreamBatcher::InitializeBatch(int fd) {
+  raw_output_ = std::make_shared<google::protobuf::io::FileOutputStream>(fd);
+  compressed_output_ = factory_(raw_output_.get());
+  if (!compressed_output_) {
+    return absl::InternalError("Creating compressed stream batcher failed");
+  }
+  coded_output_ =
+      std::make_shared<google::protobuf::io::CodedOutputStream>(compressed_output_.get());
+
+  index_.clear();
+  frame_ = FrameIndexEntry{};
+  frame_has_event_time_ = false;
+  frame_uncompressed_start_ = 0;
+  return absl::OkStatus();
+}
+
+absl::Status SeekableStreamBatcher::Write(absl::Span<const uint8_t> bytes) {
+  if (bytes.size() > INT_MAX) {
+    return absl::InternalError("Telemetry event size too large");
+  }
+
+  coded_output_->WriteLittleEndian32(kStreamBatcherMagic);
+
+  santa::Xxhash64 hash;
+  hash.Update(bytes.data(), bytes.size());
+  hash.Digest([&](const uint8_t *buf, size_t length) {
+    assert(length == sizeof(uint64_t));
+    coded_output_->WriteRaw(buf, (int)length);
+  });
+
+  coded_output_->WriteVarint32(static_cast<uint32_t>(bytes.size()));
+  coded_output_->WriteRaw(bytes.data(), static_cast<int>(bytes.size()));
+
+  if (std::optional<absl::Time> event_time = EventTime(bytes)) {
+    if (!frame_has_event_time_) {
+      frame_.first_event_time = *event_time;
+      frame_.last_event_time = *event_time;
+      frame_has_event_time_ = true;
+    } else {
+      // Events aren't necessarily spooled in the order they occurred
+      frame_.first_event_time = std::min(frame_.first_event_time, *event_time);
+      frame_.last_event_time = std::max(frame_.last_event_time, *event_time);
+    }
+  }
+  frame_.record_count++;
+
+  if ((options_.max_frame_records > 0 && frame_.record_count >= options_.max_frame_records) ||
+      (options_.max_frame_bytes > 0 &&
+       static_cast<size_t>(coded_output_->ByteCount() - frame_uncompressed_start_) >=
+           options_.max_frame_bytes)) {
+    return EndFrame();
+  }
+
+  return absl::OkStatus();
+}
+
+absl::Status SeekableStreamBatcher::EndFrame() {
+  if (frame_.record_count == 0) {
+    return absl::OkStatus();
+  }
+
+  // Hand all buffered records to the compressor before ending the frame
+  coded_output_->Trim();
+  if (coded_output_->HadError() || !compressed_output_->EndFrame()) {
+    return absl::InternalError("Failed to complete zstd frame");
+  }
+
+  int64_t compressed_end = raw_output_->ByteCount();
+  frame_.compressed_size = compressed_end - frame_.offset;
+  frame_.uncompressed_size = coded_output_->ByteCount() - frame_uncompressed_start_;
+  index_.push_back(frame_);
+
+  frame_ = FrameIndexEntry{.offset = static_cast<uint64_t>(compressed_end)};
+  frame_has_event_time_ = false;
+  frame_uncompressed_start_ = coded_output_->ByteCount();
+  return absl::OkStatus();
+}
+
+absl::StatusOr<size_t> SeekableStreamBatcher::CompleteBatch(int fd) {
+  absl::Status status = EndFrame();
+  int bytes_written = coded_output_->ByteCount();
+  coded_output_.reset();
+  compressed_output_.reset();
+
+  if (status.ok()) {
+    std::string index = EncodeFrameIndex(index_);
+    google::protobuf::io::CodedOutputStream index_output(raw_output_.get());
+    index_output.WriteRaw(index.data(), static_cast<int>(index.size()));
+    index_output.Trim();
+    if (index_output.HadError() || !raw_output_->Flush()) {
+      status = absl::InternalError("Failed to write frame index");
+    }
+  }
+
+  raw_output_.reset();
+  index_.clear();
+
+  if (!status.ok()) {
+    return status;
+  }
+  return bytes_written;
+}
+
+}  // namespace fsspool
@@ -22,6 +22,7 @@
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/gzip_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
@@ -51,7 +52,7 @@ class StreamBatcher {
 
   inline bool NeedToOpenFile() { return true; }
 
-  absl::Status Write(std::vector<uint8_t> bytes) {
+  absl::Status Write(absl::Span<const uint8_t> bytes) {
     if (bytes.size() > INT_MAX) {
       return absl::InternalError("Telemetry event size too large");
     }
@@ -111,7 +112,7 @@ class StreamBatcher<::santa::Unit> {
 
   inline bool NeedToOpenFile() { return true; }
 
-  absl::Status Write(std::vector<uint8_t> bytes) {
+  absl::Status Write(absl::Span<const uint8_t> bytes) {
     if (bytes.size() > INT_MAX) {
       return absl::InternalError("Telemetry event size too large");
     }
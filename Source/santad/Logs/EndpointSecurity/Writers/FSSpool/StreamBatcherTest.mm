@@ -15,15 +15,27 @@
 #import <Foundation/Foundation.h>
 #import <XCTest/XCTest.h>
 
+#include <algorithm>
 #include <cstring>
 #include <random>
+#include <string>
+#include <vector>
 
 #include <sys/stat.h>
 
 #import "Source/common/NSData+Zlib.h"
+#include "Source/common/santa_proto_include_wrapper.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/FrameIndex.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/SeekableStreamBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdDictionary.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdInputStream.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
 #include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "zdict.h"
 #include "zstd.h"
 
 @interface StreamBatcherTest : XCTestCase
@@ -176,4 +188,453 @@
   }
 }
 
+- (void)testZstdDictionary {
+  self.continueAfterFailure = NO;
+
+  // Messages share most of their content, as telemetry records do
+  auto makeMessage = [](int i) {
+    std::string msg = "/Applications/Example.app/Contents/MacOS/Example";
+    msg += " --flag=" + std::to_string(i % 7) + " signing_id=EXAMPLE:com.example.app";
+    msg += " pid=" + std::to_string(i);
+    return msg;
+  };
+
+  std::string samples;
+  std::vector<size_t> sampleSizes;
+  for (int i = 0; i < 2000; i++) {
+    std::string msg = makeMessage(i);
+    samples += msg;
+    sampleSizes.push_back(msg.size());
+  }
+
+  std::string dictBuf(16 * 1024, '\0');
+  size_t dictSize = ZDICT_trainFromBuffer(dictBuf.data(), dictBuf.size(), samples.data(),
+                                          sampleSizes.data(), (unsigned)sampleSizes.size());
+  XCTAssertFalse(ZDICT_isError(dictSize), "Training error: %s", ZDICT_getErrorName(dictSize));
+  dictBuf.resize(dictSize);
+
+  auto dictionary = ::fsspool::ZstdDictionary::Create(dictBuf);
+  XCTAssertTrue(dictionary.ok());
+  XCTAssertNotEqual((*dictionary)->ID(), 0);
+
+  // Content without a dictionary header has no ID and is rejected
+  XCTAssertFalse(::fsspool::ZstdDictionary::Create(samples.substr(0, 1024)).ok());
+
+  std::shared_ptr<const ::fsspool::ZstdDictionary> sharedDict = *dictionary;
+  ::fsspool::ZstdStreamBatcher plainStream(
+      ^(google::protobuf::io::ZeroCopyOutputStream *raw_stream) {
+        return ::fsspool::ZstdOutputStream::Create(raw_stream);
+      });
+  ::fsspool::ZstdStreamBatcher dictStream(
+      ^(google::protobuf::io::ZeroCopyOutputStream *raw_stream) {
+        return ::fsspool::ZstdOutputStream::Create(raw_stream, {.dictionary = sharedDict});
+      });
+
+  NSString *plainFile = [NSString stringWithFormat:@"%@/%@", self.testDir, @"plain.zst"];
+  NSString *dictFile = [NSString stringWithFormat:@"%@/%@", self.testDir, @"dict.zst"];
+  XCTAssertTrue([self.fileMgr createFileAtPath:plainFile contents:nil attributes:nil]);
+  XCTAssertTrue([self.fileMgr createFileAtPath:dictFile contents:nil attributes:nil]);
+  NSFileHandle *plainHandle = [NSFileHandle fileHandleForWritingAtPath:plainFile];
+  NSFileHandle *dictHandle = [NSFileHandle fileHandleForWritingAtPath:dictFile];
+
+  XCTAssertTrue(plainStream.InitializeBatch(plainHandle.fileDescriptor).ok());
+  XCTAssertTrue(dictStream.InitializeBatch(dictHandle.fileDescriptor).ok());
+
+  // A small batch, where a dictionary helps the most
+  for (int i = 0; i < 20; i++) {
+    std::string msg = makeMessage(i + 5000);
+    absl::Span<const uint8_t> bytes((const uint8_t *)msg.data(), msg.size());
+    XCTAssertTrue(plainStream.Write(bytes).ok());
+    XCTAssertTrue(dictStream.Write(bytes).ok());
+  }
+
+  absl::StatusOr<size_t> plainSize = plainStream.CompleteBatch(plainHandle.fileDescriptor);
+  absl::StatusOr<size_t> dictSizeWritten = dictStream.CompleteBatch(dictHandle.fileDescriptor);
+  XCTAssertTrue(plainSize.ok());
+  XCTAssertTrue(dictSizeWritten.ok());
+  XCTAssertEqual(*plainSize, *dictSizeWritten);
+  [plainHandle closeFile];
+  [dictHandle closeFile];
+
+  NSData *plainData = [NSData dataWithContentsOfFile:plainFile];
+  NSData *dictData = [NSData dataWithContentsOfFile:dictFile];
+  XCTAssertLessThan(dictData.length, plainData.length);
+
+  // The dictionary ID is recorded in the frame, and is required to decompress
+  XCTAssertEqual(ZSTD_getDictID_fromFrame(plainData.bytes, plainData.length), 0);
+  XCTAssertEqual(ZSTD_getDictID_fromFrame(dictData.bytes, dictData.length),
+                 (*dictionary)->ID());
+
+  std::vector<uint8_t> plainDecompressed(*plainSize);
+  std::vector<uint8_t> dictDecompressed(*plainSize);
+  size_t plainBytes = ZSTD_decompress(plainDecompressed.data(), plainDecompressed.size(),
+                                      plainData.bytes, plainData.length);
+  XCTAssertEqual(plainBytes, *plainSize);
+  XCTAssertTrue(ZSTD_isError(ZSTD_decompress(dictDecompressed.data(), dictDecompressed.size(),
+                                             dictData.bytes, dictData.length)));
+
+  ZSTD_DCtx *dctx = ZSTD_createDCtx();
+  size_t dictBytes =
+      ZSTD_decompress_usingDDict(dctx, dictDecompressed.data(), dictDecompressed.size(),
+                                 dictData.bytes, dictData.length, (*dictionary)->DDict());
+  ZSTD_freeDCtx(dctx);
+  XCTAssertEqual(dictBytes, *plainSize);
+  XCTAssertEqual(plainDecompressed, dictDecompressed);
+}
+
+- (void)testZstdDictionaryLevel {
+  auto makeMessage = [](int i) {
+    return "/Applications/Example" + std::to_string(i % 13) +
+           ".app/Contents/MacOS/Example --flag=" + std::to_string(i * 7919 % 1000) +
+           " signing_id=EXAMPLE:com.example.app pid=" + std::to_string(i) + "\n";
+  };
+
+  std::string samples;
+  std::vector<size_t> sampleSizes;
+  for (int i = 0; i < 2000; i++) {
+    std::string msg = makeMessage(i);
+    samples += msg;
+    sampleSizes.push_back(msg.size());
+  }
+  std::string dictBuf(16 * 1024, '\0');
+  size_t dictSize = ZDICT_trainFromBuffer(dictBuf.data(), dictBuf.size(), samples.data(),
+                                          sampleSizes.data(), (unsigned)sampleSizes.size());
+  XCTAssertFalse(ZDICT_isError(dictSize));
+  dictBuf.resize(dictSize);
+  auto dictionary = ::fsspool::ZstdDictionary::Create(dictBuf);
+  XCTAssertTrue(dictionary.ok());
+
+  std::string input;
+  for (int i = 5000; i < 25000; i++) {
+    input += makeMessage(i);
+  }
+
+  auto compress = [&](int level) {
+    std::string out;
+    google::protobuf::io::StringOutputStream raw_stream(&out);
+    auto stream = ::fsspool::ZstdOutputStream::Create(
+        &raw_stream, {.compression_level = level, .dictionary = *dictionary});
+    void *data;
+    int size;
+    XCTAssertTrue(stream->Next(&data, &size));
+    XCTAssertGreaterThanOrEqual(size, 0);
+    // Writes the whole input through the stream's buffer
+    for (size_t offset = 0;;) {
+      size_t n = std::min(static_cast<size_t>(size), input.size() - offset);
+      memcpy(data, input.data() + offset, n);
+      offset += n;
+      if (offset == input.size()) {
+        stream->BackUp(size - static_cast<int>(n));
+        break;
+      }
+      XCTAssertTrue(stream->Next(&data, &size));
+    }
+    XCTAssertTrue(stream->EndFrame());
+    stream.reset();
+    return out;
+  };
+
+  // The stream's level applies rather than the level the dictionary was
+  // digested at
+  std::string fast = compress(1);
+  std::string strong = compress(19);
+  XCTAssertLessThan(strong.size(), fast.size() * 9 / 10);
+
+  for (const std::string &compressed : {fast, strong}) {
+    XCTAssertEqual(ZSTD_getDictID_fromFrame(compressed.data(), compressed.size()),
+                   (*dictionary)->ID());
+    std::string decompressed(input.size(), '\0');
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    size_t bytes =
+        ZSTD_decompress_usingDDict(dctx, decompressed.data(), decompressed.size(),
+                                   compressed.data(), compressed.size(), (*dictionary)->DDict());
+    ZSTD_freeDCtx(dctx);
+    XCTAssertEqual(bytes, input.size());
+    XCTAssertTrue(decompressed == input);
+  }
+}
+
+- (void)testFrameIndex {
+  std::vector<::fsspool::FrameIndexEntry> entries = {
+      {
+          .offset = 0,
+          .compressed_size = 100,
+          .uncompressed_size = 400,
+          .record_count = 3,
+          .first_event_time = absl::FromUnixSeconds(1000),
+          .last_event_time = absl::FromUnixSeconds(1002),
+      },
+      {
+          .offset = 100,
+          .compressed_size = 50,
+          .uncompressed_size = 200,
+          .record_count = 1,
+          .first_event_time = absl::FromUnixNanos(1003000000123),
+          .last_event_time = absl::FromUnixNanos(1003000000123),
+      },
+  };
+
+  std::string encoded = ::fsspool::EncodeFrameIndex(entries);
+  XCTAssertEqual(encoded.size(), ::fsspool::kFrameIndexHeaderSize +
+                                     2 * ::fsspool::kFrameIndexEntrySize +
+                                     ::fsspool::kFrameIndexFooterSize);
+
+  absl::Span<const uint8_t> data((const uint8_t *)encoded.data(), encoded.size());
+  auto decoded = ::fsspool::DecodeFrameIndex(data);
+  XCTAssertTrue(decoded.ok());
+  XCTAssertTrue(*decoded == entries);
+
+  // An empty index is valid
+  std::string empty = ::fsspool::EncodeFrameIndex({});
+  decoded = ::fsspool::DecodeFrameIndex(
+      absl::Span<const uint8_t>((const uint8_t *)empty.data(), empty.size()));
+  XCTAssertTrue(decoded.ok());
+  XCTAssertTrue(decoded->empty());
+
+  // Data not ending in the footer has no index
+  XCTAssertTrue(
+      absl::IsNotFound(::fsspool::DecodeFrameIndex(data.subspan(0, data.size() - 1)).status()));
+
+  // Truncated entries are detected
+  XCTAssertTrue(absl::IsDataLoss(::fsspool::DecodeFrameIndex(data.subspan(1)).status()));
+
+  // Frames must be contiguous
+  entries[1].offset = 101;
+  encoded = ::fsspool::EncodeFrameIndex(entries);
+  XCTAssertTrue(absl::IsDataLoss(
+      ::fsspool::DecodeFrameIndex(
+          absl::Span<const uint8_t>((const uint8_t *)encoded.data(), encoded.size()))
+          .status()));
+}
+
+- (void)testSeekableStream {
+  self.continueAfterFailure = NO;
+
+  static constexpr int kNumRecords = 100;
+  static constexpr size_t kFrameRecords = 16;
+  static constexpr int64_t kBaseTime = 1700000000;
+
+  ::fsspool::ZstdStreamBatcher zstdStream(
+      ^(google::protobuf::io::ZeroCopyOutputStream *raw_stream) {
+        return ::fsspool::ZstdOutputStream::Create(raw_stream);
+      });
+  ::fsspool::SeekableStreamBatcher seekableStream(
+      ^(google::protobuf::io::ZeroCopyOutputStream *raw_stream) {
+        return ::fsspool::ZstdOutputStream::Create(raw_stream);
+      },
+      {.max_frame_records = kFrameRecords});
+
+  NSString *zstdFile = [NSString stringWithFormat:@"%@/%@", self.testDir, @"stream.zst"];
+  NSString *seekableFile = [NSString stringWithFormat:@"%@/%@", self.testDir, @"seekable.zst"];
+  XCTAssertTrue([self.fileMgr createFileAtPath:zstdFile contents:nil attributes:nil]);
+  XCTAssertTrue([self.fileMgr createFileAtPath:seekableFile contents:nil attributes:nil]);
+  NSFileHandle *zstdHandle = [NSFileHandle fileHandleForWritingAtPath:zstdFile];
+  NSFileHandle *seekableHandle = [NSFileHandle fileHandleForWritingAtPath:seekableFile];
+
+  XCTAssertTrue(zstdStream.InitializeBatch(zstdHandle.fileDescriptor).ok());
+  XCTAssertTrue(seekableStream.InitializeBatch(seekableHandle.fileDescriptor).ok());
+
+  for (int i = 0; i < kNumRecords; i++) {
+    ::santa::pb::v1::SantaMessage msg;
+    msg.mutable_event_time()->set_seconds(kBaseTime + i);
+    msg.mutable_event_time()->set_nanos(i);
+    msg.set_machine_id("machine");
+    msg.mutable_fork()->mutable_instigator()->mutable_executable()->set_path("/usr/bin/example");
+    std::string bytes = msg.SerializeAsString();
+
+    absl::Span<const uint8_t> span((const uint8_t *)bytes.data(), bytes.size());
+    XCTAssertEqual(::fsspool::SeekableStreamBatcher::EventTime(span),
+                   absl::FromUnixSeconds(kBaseTime + i) + absl::Nanoseconds(i));
+    XCTAssertTrue(zstdStream.Write(span).ok());
+    XCTAssertTrue(seekableStream.Write(span).ok());
+  }
+
+  absl::StatusOr<size_t> zstdSize = zstdStream.CompleteBatch(zstdHandle.fileDescriptor);
+  absl::StatusOr<size_t> seekableSize =
+      seekableStream.CompleteBatch(seekableHandle.fileDescriptor);
+  XCTAssertTrue(zstdSize.ok());
+  XCTAssertTrue(seekableSize.ok());
+  XCTAssertEqual(*zstdSize, *seekableSize);
+  [zstdHandle closeFile];
+  [seekableHandle closeFile];
+
+  // Plain streams have no index
+  NSFileHandle *readHandle = [NSFileHandle fileHandleForReadingAtPath:zstdFile];
+  XCTAssertTrue(absl::IsNotFound(::fsspool::ReadFrameIndex(readHandle.fileDescriptor).status()));
+  [readHandle closeFile];
+
+  readHandle = [NSFileHandle fileHandleForReadingAtPath:seekableFile];
+  auto index = ::fsspool::ReadFrameIndex(readHandle.fileDescriptor);
+  [readHandle closeFile];
+  XCTAssertTrue(index.ok(), "%s", index.status().ToString().c_str());
+  XCTAssertEqual(index->size(), (kNumRecords + kFrameRecords - 1) / kFrameRecords);
+
+  // Both files decompress to the same records, the index being skipped by decoders
+  NSData *zstdData = [NSData dataWithContentsOfFile:zstdFile];
+  NSData *seekableData = [NSData dataWithContentsOfFile:seekableFile];
+  std::vector<uint8_t> expected(*zstdSize);
+  std::vector<uint8_t> got(*zstdSize);
+  XCTAssertEqual(ZSTD_decompress(expected.data(), expected.size(), zstdData.bytes, zstdData.length),
+                 *zstdSize);
+  XCTAssertEqual(
+      ZSTD_decompress(got.data(), got.size(), seekableData.bytes, seekableData.length),
+      *zstdSize);
+  XCTAssertEqual(expected, got);
+
+  // Each frame decompresses on its own to the records it indexes
+  size_t uncompressedOffset = 0;
+  int record = 0;
+  for (const ::fsspool::FrameIndexEntry &entry : *index) {
+    uint64_t expectedRecords = std::min<uint64_t>(kFrameRecords, kNumRecords - record);
+    XCTAssertEqual(entry.record_count, expectedRecords);
+    XCTAssertEqual(entry.first_event_time,
+                   absl::FromUnixSeconds(kBaseTime + record) + absl::Nanoseconds(record));
+    XCTAssertEqual(entry.last_event_time,
+                   absl::FromUnixSeconds(kBaseTime + record + expectedRecords - 1) +
+                       absl::Nanoseconds(record + expectedRecords - 1));
+
+    std::vector<uint8_t> frame(entry.uncompressed_size);
+    size_t frameBytes =
+        ZSTD_decompress(frame.data(), frame.size(),
+                        (const uint8_t *)seekableData.bytes + entry.offset, entry.compressed_size);
+    XCTAssertEqual(frameBytes, entry.uncompressed_size);
+    XCTAssertEqual(0, memcmp(frame.data(), expected.data() + uncompressedOffset, frame.size()));
+
+    uint32_t magic;
+    memcpy(&magic, frame.data(), sizeof(magic));
+    XCTAssertEqual(magic, ::fsspool::kStreamBatcherMagic);
+
+    uncompressedOffset += frame.size();
+    record += expectedRecords;
+  }
+  XCTAssertEqual(uncompressedOffset, *zstdSize);
+  XCTAssertEqual(record, kNumRecords);
+}
+
+- (void)testSeekableStreamFrameSize {
+  self.continueAfterFailure = NO;
+
+  static constexpr size_t kFrameBytes = 4096;
+
+  ::fsspool::SeekableStreamBatcher seekableStream(
+      ^(google::protobuf::io::ZeroCopyOutputStream *raw_stream) {
+        return ::fsspool::ZstdOutputStream::Create(raw_stream);
+      },
+      {.max_frame_bytes = kFrameBytes});
+
+  NSString *seekableFile = [NSString stringWithFormat:@"%@/%@", self.testDir, @"seekable.zst"];
+  XCTAssertTrue([self.fileMgr createFileAtPath:seekableFile contents:nil attributes:nil]);
+  NSFileHandle *seekableHandle = [NSFileHandle fileHandleForWritingAtPath:seekableFile];
+  XCTAssertTrue(seekableStream.InitializeBatch(seekableHandle.fileDescriptor).ok());
+
+  // Records that aren't SantaMessages are indexed without event times
+  std::vector<uint8_t> buf(1000, 'A');
+  for (int i = 0; i < 20; i++) {
+    XCTAssertTrue(seekableStream.Write(buf).ok());
+  }
+
+  absl::StatusOr<size_t> size = seekableStream.CompleteBatch(seekableHandle.fileDescriptor);
+  XCTAssertTrue(size.ok());
+  [seekableHandle closeFile];
+
+  NSFileHandle *readHandle = [NSFileHandle fileHandleForReadingAtPath:seekableFile];
+  auto index = ::fsspool::ReadFrameIndex(readHandle.fileDescriptor);
+  [readHandle closeFile];
+  XCTAssertTrue(index.ok(), "%s", index.status().ToString().c_str());
+
+  // Each frame ends with the record that reached the limit
+  uint64_t records = 0;
+  uint64_t uncompressed = 0;
+  for (size_t i = 0; i < index->size(); i++) {
+    const ::fsspool::FrameIndexEntry &entry = (*index)[i];
+    if (i + 1 < index->size()) {
+      XCTAssertGreaterThanOrEqual(entry.uncompressed_size, kFrameBytes);
+      XCTAssertLessThan(entry.uncompressed_size, kFrameBytes + 1024);
+    }
+    XCTAssertEqual(entry.first_event_time, absl::UnixEpoch());
+    XCTAssertEqual(entry.last_event_time, absl::UnixEpoch());
+    records += entry.record_count;
+    uncompressed += entry.uncompressed_size;
+  }
+  XCTAssertEqual(index->size(), 4);
+  XCTAssertEqual(records, 20);
+  XCTAssertEqual(uncompressed, *size);
+}
+
+- (void)testZstdInputStream {
+  self.continueAfterFailure = NO;
+
+  ::fsspool::UncompressedStreamBatcher uncompressedStream;
+  ::fsspool::SeekableStreamBatcher seekableStream(
+      ^(google::protobuf::io::ZeroCopyOutputStream *raw_stream) {
+        return ::fsspool::ZstdOutputStream::Create(raw_stream);
+      },
+      {.max_frame_records = 7});
+
+  NSString *uncompressedFile =
+      [NSString stringWithFormat:@"%@/%@", self.testDir, @"uncompressed.bin"];
+  NSString *seekableFile = [NSString stringWithFormat:@"%@/%@", self.testDir, @"seekable.zst"];
+  XCTAssertTrue([self.fileMgr createFileAtPath:uncompressedFile contents:nil attributes:nil]);
+  XCTAssertTrue([self.fileMgr createFileAtPath:seekableFile contents:nil attributes:nil]);
+  NSFileHandle *uncompressedHandle = [NSFileHandle fileHandleForWritingAtPath:uncompressedFile];
+  NSFileHandle *seekableHandle = [NSFileHandle fileHandleForWritingAtPath:seekableFile];
+
+  XCTAssertTrue(uncompressedStream.InitializeBatch(uncompressedHandle.fileDescriptor).ok());
+  XCTAssertTrue(seekableStream.InitializeBatch(seekableHandle.fileDescriptor).ok());
+
+  for (int i = 0; i < 50; i++) {
+    std::vector<uint8_t> buf(500 + i * 10, 'A' + (i % 26));
+    XCTAssertTrue(uncompressedStream.Write(buf).ok());
+    XCTAssertTrue(seekableStream.Write(buf).ok());
+  }
+
+  XCTAssertTrue(uncompressedStream.CompleteBatch(uncompressedHandle.fileDescriptor).ok());
+  XCTAssertTrue(seekableStream.CompleteBatch(seekableHandle.fileDescriptor).ok());
+  [uncompressedHandle closeFile];
+  [seekableHandle closeFile];
+
+  NSData *uncompressedData = [NSData dataWithContentsOfFile:uncompressedFile];
+  NSData *seekableData = [NSData dataWithContentsOfFile:seekableFile];
+
+  // All frames are decoded in order through a buffer smaller than a frame, and
+  // the trailing frame index is skipped
+  google::protobuf::io::ArrayInputStream rawInput(seekableData.bytes, (int)seekableData.length,
+                                                  1000);
+  auto zstdInput = ::fsspool::ZstdInputStream::Create(&rawInput, {.buffer_size = 1024});
+  XCTAssertNotEqual(zstdInput, nullptr);
+
+  std::string decompressed;
+  const void *data;
+  int size;
+  while (zstdInput->Next(&data, &size)) {
+    XCTAssertLessThanOrEqual(size, 1024);
+    // Exercise backing up and re-reading part of the buffer
+    if (size > 1) {
+      zstdInput->BackUp(size / 2);
+      decompressed.append((const char *)data, size - size / 2);
+    } else {
+      decompressed.append((const char *)data, size);
+    }
+  }
+  XCTAssertTrue(zstdInput->status().ok(), "%s", zstdInput->status().ToString().c_str());
+  XCTAssertEqual(zstdInput->ByteCount(), (int64_t)uncompressedData.length);
+  XCTAssertEqual(decompressed, std::string((const char *)uncompressedData.bytes,
+                                           uncompressedData.length));
+
+  // Skipping lands at the same offset as reading
+  google::protobuf::io::ArrayInputStream skipInput(seekableData.bytes, (int)seekableData.length);
+  zstdInput = ::fsspool::ZstdInputStream::Create(&skipInput, {.buffer_size = 1024});
+  XCTAssertTrue(zstdInput->Skip(5000));
+  XCTAssertTrue(zstdInput->Next(&data, &size));
+  XCTAssertEqual(memcmp(data, (const uint8_t *)uncompressedData.bytes + 5000, 1), 0);
+
+  // Truncated streams are reported as such, rather than as the end of the data
+  google::protobuf::io::ArrayInputStream truncatedInput(seekableData.bytes,
+                                                        (int)seekableData.length / 2);
+  zstdInput = ::fsspool::ZstdInputStream::Create(&truncatedInput);
+  while (zstdInput->Next(&data, &size)) {
+  }
+  XCTAssertTrue(absl::IsDataLoss(zstdInput->status()));
+}
+
 @end
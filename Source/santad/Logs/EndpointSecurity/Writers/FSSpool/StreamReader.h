@@ -0,0 +1,52 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_STREAMREADER_H
+#define SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_STREAMREADER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdDictionary.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "google/protobuf/io/coded_stream.h"
+
+namespace fsspool {
+
+// Semi-arbitrary max size of a single stream record. Records are read into
+// memory one at a time, so this bounds memory use regardless of file size.
+inline constexpr uint32_t kMaxStreamRecordSize = 1024 * 1024 * 64;
+
+// Reads the next stream batcher record from the input into the buffer and
+// verifies its hash. Returns OutOfRangeError once the input is exhausted.
+absl::StatusOr<absl::Span<const uint8_t>> ReadStreamRecord(
+    google::protobuf::io::CodedInputStream &coded_input,
+    std::vector<uint8_t> &buf);
+
+// Rewrites a string table encoded stream spool file, read from the start of
+// in_fd, as a plain stream with the same compression written to out_fd, for
+// consumers that don't understand the encoding. Zstd output is written as a
+// single stream without a dictionary or frame index.
+//
+// Returns false, without writing anything, if the file isn't string table
+// encoded.
+absl::StatusOr<bool> DecodeStringTableFile(
+    int in_fd, int out_fd,
+    std::vector<std::shared_ptr<const ZstdDictionary>> dictionaries = {});
+
+}  // namespace fsspool
+
+#endif  // SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_STREAMREADER_H
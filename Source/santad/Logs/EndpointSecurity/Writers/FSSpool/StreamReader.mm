@@ -0,0 +1,233 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamReader.h"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include "Source/common/SNTXxhash.h"
+#include "Source/common/santa_proto_include_wrapper.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StringTable.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdInputStream.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "google/protobuf/io/gzip_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+
+namespace fsspool {
+
+namespace {
+
+static constexpr uint32_t kZstdFrameMagic = 0xFD2FB528;
+
+enum class Compression { kNone, kGzip, kZstd };
+
+absl::StatusOr<Compression> DetectCompression(int fd) {
+  uint32_t magic = 0;
+  ssize_t bytes_read = pread(fd, &magic, sizeof(magic), 0);
+  if (bytes_read < 0) {
+    return absl::ErrnoToStatus(errno, "Failed to read file");
+  } else if (bytes_read != sizeof(magic)) {
+    return absl::InvalidArgumentError("Not a stream spool file");
+  }
+
+  if (magic == kStreamBatcherMagic) {
+    return Compression::kNone;
+  } else if ((magic & 0xffff) == 0x8b1f) {
+    return Compression::kGzip;
+  } else if (magic == kZstdFrameMagic) {
+    return Compression::kZstd;
+  } else {
+    return absl::InvalidArgumentError("Not a stream spool file");
+  }
+}
+
+// Decodes the remaining records of the input into a new batch of the batcher.
+// Markers only reset the table, they are not written.
+template <typename B>
+absl::Status DecodeRecords(google::protobuf::io::ZeroCopyInputStream *input,
+                           B batcher, int out_fd) {
+  if (absl::Status status = batcher.InitializeBatch(out_fd); !status.ok()) {
+    return status;
+  }
+
+  StringTableDecoder decoder(::santa::pb::v1::SantaMessage::descriptor());
+  std::vector<uint8_t> buf;
+  std::string decoded;
+  while (true) {
+    // A CodedInputStream per record avoids its total bytes limit
+    google::protobuf::io::CodedInputStream coded_input(input);
+    absl::StatusOr<absl::Span<const uint8_t>> record =
+        ReadStreamRecord(coded_input, buf);
+    if (absl::IsOutOfRange(record.status())) {
+      break;
+    } else if (!record.ok()) {
+      return record.status();
+    }
+
+    if (IsStringTableMarker(*record)) {
+      decoder.Reset();
+      continue;
+    }
+
+    if (absl::Status status = decoder.Decode(*record, decoded); !status.ok()) {
+      return status;
+    }
+    absl::Status status = batcher.Write(absl::Span<const uint8_t>(
+        reinterpret_cast<const uint8_t *>(decoded.data()), decoded.size()));
+    if (!status.ok()) {
+      return status;
+    }
+  }
+
+  return batcher.CompleteBatch(out_fd).status();
+}
+
+}  // namespace
+
+absl::StatusOr<absl::Span<const uint8_t>> ReadStreamRecord(
+    google::protobuf::io::CodedInputStream &coded_input,
+    std::vector<uint8_t> &buf) {
+  // Failing to read the magic value indicates the end of the input
+  uint32_t magic;
+  if (!coded_input.ReadLittleEndian32(&magic)) {
+    return absl::OutOfRangeError("No more data");
+  }
+  if (magic != kStreamBatcherMagic) {
+    return absl::InternalError("Invalid magic value");
+  }
+
+  uint64_t expected_hash;
+  if (!coded_input.ReadRaw(&expected_hash, sizeof(expected_hash))) {
+    return absl::InternalError("Failed to parse hash data");
+  }
+
+  uint32_t length;
+  if (!coded_input.ReadVarint32(&length)) {
+    return absl::InternalError("Failed to parse message length");
+  }
+  if (length > kMaxStreamRecordSize) {
+    return absl::DataLossError("Record too large");
+  }
+
+  buf.resize(length);
+  if (!coded_input.ReadRaw(buf.data(), length)) {
+    return absl::InternalError("Failed to read message into buffer");
+  }
+
+  if (expected_hash != 0) {
+    santa::Xxhash64 xxhash;
+    xxhash.Update(buf.data(), buf.size());
+    uint64_t got_hash = 0;
+    xxhash.Digest([&](const uint8_t *digest, size_t size) {
+      memcpy(&got_hash, digest, sizeof(got_hash));
+    });
+
+    if (got_hash != expected_hash) {
+      return absl::InternalError("Message corruption detected");
+    }
+  }
+
+  return absl::Span<const uint8_t>(buf);
+}
+
+absl::StatusOr<bool> DecodeStringTableFile(
+    int in_fd, int out_fd,
+    std::vector<std::shared_ptr<const ZstdDictionary>> dictionaries) {
+  absl::StatusOr<Compression> compression = DetectCompression(in_fd);
+  if (!compression.ok()) {
+    return compression.status();
+  }
+
+  if (lseek(in_fd, 0, SEEK_SET) != 0) {
+    return absl::ErrnoToStatus(errno, "Failed to reset file position");
+  }
+
+  google::protobuf::io::FileInputStream file_input(in_fd);
+  std::unique_ptr<google::protobuf::io::GzipInputStream> gzip_input;
+  std::unique_ptr<ZstdInputStream> zstd_input;
+  google::protobuf::io::ZeroCopyInputStream *input = &file_input;
+  if (*compression == Compression::kGzip) {
+    gzip_input = std::make_unique<google::protobuf::io::GzipInputStream>(
+        &file_input, google::protobuf::io::GzipInputStream::GZIP);
+    input = gzip_input.get();
+  } else if (*compression == Compression::kZstd) {
+    zstd_input = ZstdInputStream::Create(
+        &file_input, {.dictionaries = std::move(dictionaries)});
+    if (!zstd_input) {
+      return absl::InternalError("Failed to create zstd decompression stream");
+    }
+    input = zstd_input.get();
+  }
+
+  // Encoded files always start with a marker
+  {
+    google::protobuf::io::CodedInputStream coded_input(input);
+    std::vector<uint8_t> buf;
+    absl::StatusOr<absl::Span<const uint8_t>> first =
+        ReadStreamRecord(coded_input, buf);
+    if (!first.ok() || !IsStringTableMarker(*first)) {
+      return false;
+    }
+  }
+
+  absl::Status status;
+  switch (*compression) {
+    case Compression::kNone:
+      status = DecodeRecords(input, UncompressedStreamBatcher(), out_fd);
+      break;
+    case Compression::kGzip:
+      status = DecodeRecords(
+          input,
+          GzipStreamBatcher(
+              [](google::protobuf::io::ZeroCopyOutputStream *raw_stream) {
+                return std::make_shared<google::protobuf::io::GzipOutputStream>(
+                    raw_stream);
+              }),
+          out_fd);
+      break;
+    case Compression::kZstd:
+      status = DecodeRecords(
+          input,
+          ZstdStreamBatcher(
+              [](google::protobuf::io::ZeroCopyOutputStream *raw_stream) {
+                return ZstdOutputStream::Create(raw_stream);
+              }),
+          out_fd);
+      break;
+  }
+  if (!status.ok()) {
+    return status;
+  }
+
+  // Distinguish the end of the file from read and decompression failures
+  if (file_input.GetErrno() != 0) {
+    return absl::ErrnoToStatus(file_input.GetErrno(), "Failed to read file");
+  } else if (gzip_input && gzip_input->ZlibErrorCode() < 0) {
+    return absl::DataLossError(absl::StrFormat(
+        "Failed to decompress gzip file: %d", gzip_input->ZlibErrorCode()));
+  } else if (zstd_input && !zstd_input->status().ok()) {
+    return zstd_input->status();
+  }
+
+  return true;
+}
+
+}  // namespace fsspool
@@ -0,0 +1,297 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StringTable.h"
+
+#include <cstring>
+
+#include "absl/hash/hash.h"
+#include "google/protobuf/wire_format_lite.h"
+
+using google::protobuf::Descriptor;
+using google::protobuf::FieldDescriptor;
+using google::protobuf::internal::WireFormatLite;
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
+
+namespace fsspool {
+
+namespace {
+
+// Matches the protobuf parser's default recursion limit
+constexpr int kMaxDepth = 100;
+
+constexpr size_t kMaxVarintBytes = 10;
+
+constexpr uint32_t kEntryTag = WireFormatLite::MakeTag(
+    kStringTableEntryField, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+
+void AppendVarint(std::string &out, uint64_t value) {
+  uint8_t buf[kMaxVarintBytes];
+  uint8_t *end = CodedOutputStream::WriteVarint64ToArray(value, buf);
+  out.append(reinterpret_cast<const char *>(buf), end - buf);
+}
+
+void AppendLengthDelimited(std::string &out, int field_number,
+                           const std::string &value) {
+  AppendVarint(out,
+               WireFormatLite::MakeTag(
+                   field_number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+  AppendVarint(out, value.size());
+  out.append(value);
+}
+
+bool IsStringField(const FieldDescriptor *field) {
+  return field->type() == FieldDescriptor::TYPE_STRING ||
+         field->type() == FieldDescriptor::TYPE_BYTES;
+}
+
+// Returns the buffer for re-encoding a nested message at the given depth. All
+// depths are allocated at once, since buffers for shallower depths are still
+// referenced while deeper ones are requested.
+std::string &Scratch(std::vector<std::string> &scratch, int depth) {
+  if (scratch.empty()) {
+    scratch.resize(kMaxDepth + 1);
+  }
+  scratch[depth].clear();
+  return scratch[depth];
+}
+
+}  // namespace
+
+const std::string &StringTableMarker() {
+  static const std::string *marker = [] {
+    auto *marker = new std::string();
+    AppendVarint(*marker,
+                 WireFormatLite::MakeTag(kStringTableMarkerField,
+                                         WireFormatLite::WIRETYPE_VARINT));
+    AppendVarint(*marker, kStringTableVersion);
+    return marker;
+  }();
+  return *marker;
+}
+
+bool IsStringTableMarker(absl::Span<const uint8_t> record) {
+  const std::string &marker = StringTableMarker();
+  return record.size() == marker.size() &&
+         memcmp(record.data(), marker.data(), marker.size()) == 0;
+}
+
+StringTableEncoder::StringTableEncoder(const Descriptor *descriptor,
+                                       StringTableOptions options)
+    : descriptor_(descriptor), options_(options) {}
+
+void StringTableEncoder::Reset() {
+  table_.clear();
+  table_bytes_ = 0;
+  seen_.clear();
+}
+
+absl::Status StringTableEncoder::Encode(absl::Span<const uint8_t> message,
+                                        std::string &out) {
+  out.clear();
+  new_entries_.clear();
+  data_ = message.data();
+
+  CodedInputStream input(message.data(), static_cast<int>(message.size()));
+  if (!EncodeMessage(descriptor_, input, out, 0)) {
+    // The decoder never sees entries added by a record that isn't written
+    for (const std::string &entry : new_entries_) {
+      table_.erase(entry);
+      table_bytes_ -= entry.size();
+    }
+    new_entries_.clear();
+    return absl::DataLossError("Failed to encode malformed message");
+  }
+
+  for (const std::string &entry : new_entries_) {
+    AppendLengthDelimited(out, kStringTableEntryField, entry);
+  }
+  return absl::OkStatus();
+}
+
+bool StringTableEncoder::EncodeMessage(const Descriptor *descriptor,
+                                       CodedInputStream &input,
+                                       std::string &out, int depth) {
+  if (depth > kMaxDepth) {
+    return false;
+  }
+
+  while (true) {
+    int field_start = input.CurrentPosition();
+    uint32_t tag = input.ReadTag();
+    if (tag == 0) {
+      return input.ConsumedEntireMessage();
+    }
+
+    const FieldDescriptor *field = descriptor->FindFieldByNumber(
+        WireFormatLite::GetTagFieldNumber(tag));
+    if (field && WireFormatLite::GetTagWireType(tag) ==
+                     WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+      if (IsStringField(field)) {
+        if (!WireFormatLite::ReadBytes(&input, &value_)) {
+          return false;
+        }
+        if (std::optional<uint32_t> index = Lookup(value_)) {
+          AppendVarint(out,
+                       WireFormatLite::MakeTag(
+                           field->number(), WireFormatLite::WIRETYPE_VARINT));
+          AppendVarint(out, *index);
+        } else {
+          out.append(reinterpret_cast<const char *>(data_) + field_start,
+                     input.CurrentPosition() - field_start);
+        }
+        continue;
+      } else if (field->type() == FieldDescriptor::TYPE_MESSAGE) {
+        uint32_t length;
+        if (!input.ReadVarint32(&length)) {
+          return false;
+        }
+        CodedInputStream::Limit limit =
+            input.PushLimit(static_cast<int>(length));
+        std::string &sub = Scratch(scratch_, depth);
+        if (!EncodeMessage(field->message_type(), input, sub, depth + 1)) {
+          return false;
+        }
+        input.PopLimit(limit);
+        AppendLengthDelimited(out, field->number(), sub);
+        continue;
+      }
+    }
+
+    // Everything else is copied as is
+    if (!WireFormatLite::SkipField(&input, tag)) {
+      return false;
+    }
+    out.append(reinterpret_cast<const char *>(data_) + field_start,
+               input.CurrentPosition() - field_start);
+  }
+}
+
+std::optional<uint32_t> StringTableEncoder::Lookup(const std::string &value) {
+  if (value.size() < options_.min_value_size) {
+    return std::nullopt;
+  }
+
+  if (auto it = table_.find(value); it != table_.end()) {
+    return it->second;
+  }
+
+  if (table_.size() >= options_.max_entries ||
+      table_bytes_ + value.size() > options_.max_table_bytes) {
+    return std::nullopt;
+  }
+
+  // Values enter the table when seen a second time. Hash collisions only cause
+  // a value to enter the table early.
+  if (seen_.size() < options_.max_entries * 4 &&
+      seen_.insert(absl::Hash<std::string>{}(value)).second) {
+    return std::nullopt;
+  }
+
+  uint32_t index = static_cast<uint32_t>(table_.size());
+  table_.emplace(value, index);
+  table_bytes_ += value.size();
+  new_entries_.push_back(value);
+  return index;
+}
+
+StringTableDecoder::StringTableDecoder(const Descriptor *descriptor)
+    : descriptor_(descriptor) {}
+
+void StringTableDecoder::Reset() { table_.clear(); }
+
+absl::Status StringTableDecoder::Decode(absl::Span<const uint8_t> record,
+                                        std::string &out) {
+  out.clear();
+  data_ = record.data();
+
+  // Entries follow the fields that reference them, so are read first
+  CodedInputStream scan(record.data(), static_cast<int>(record.size()));
+  while (uint32_t tag = scan.ReadTag()) {
+    if (tag == kEntryTag) {
+      table_.emplace_back();
+      if (!WireFormatLite::ReadBytes(&scan, &table_.back())) {
+        return absl::DataLossError("Malformed string table entry");
+      }
+    } else if (!WireFormatLite::SkipField(&scan, tag)) {
+      return absl::DataLossError("Malformed string table record");
+    }
+  }
+
+  CodedInputStream input(record.data(), static_cast<int>(record.size()));
+  if (!DecodeMessage(descriptor_, input, out, 0)) {
+    return absl::DataLossError("Malformed string table record");
+  }
+  return absl::OkStatus();
+}
+
+bool StringTableDecoder::DecodeMessage(const Descriptor *descriptor,
+                                       CodedInputStream &input,
+                                       std::string &out, int depth) {
+  if (depth > kMaxDepth) {
+    return false;
+  }
+
+  while (true) {
+    int field_start = input.CurrentPosition();
+    uint32_t tag = input.ReadTag();
+    if (tag == 0) {
+      return input.ConsumedEntireMessage();
+    }
+
+    if (depth == 0 && tag == kEntryTag) {
+      if (!WireFormatLite::SkipField(&input, tag)) {
+        return false;
+      }
+      continue;
+    }
+
+    const FieldDescriptor *field = descriptor->FindFieldByNumber(
+        WireFormatLite::GetTagFieldNumber(tag));
+    if (field && IsStringField(field) &&
+        WireFormatLite::GetTagWireType(tag) ==
+            WireFormatLite::WIRETYPE_VARINT) {
+      uint64_t index;
+      if (!input.ReadVarint64(&index) || index >= table_.size()) {
+        return false;
+      }
+      AppendLengthDelimited(out, field->number(), table_[index]);
+      continue;
+    } else if (field && field->type() == FieldDescriptor::TYPE_MESSAGE &&
+               WireFormatLite::GetTagWireType(tag) ==
+                   WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+      uint32_t length;
+      if (!input.ReadVarint32(&length)) {
+        return false;
+      }
+      CodedInputStream::Limit limit = input.PushLimit(static_cast<int>(length));
+      std::string &sub = Scratch(scratch_, depth);
+      if (!DecodeMessage(field->message_type(), input, sub, depth + 1)) {
+        return false;
+      }
+      input.PopLimit(limit);
+      AppendLengthDelimited(out, field->number(), sub);
+      continue;
+    }
+
+    if (!WireFormatLite::SkipField(&input, tag)) {
+      return false;
+    }
+    out.append(reinterpret_cast<const char *>(data_) + field_start,
+               input.CurrentPosition() - field_start);
+  }
+}
+
+}  // namespace fsspool
@@ -0,0 +1,125 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_STRINGTABLE_H
+#define SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_STRINGTABLE_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/types/span.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/io/coded_stream.h"
+
+// Per-batch string table encoding of serialized messages.
+//
+// Records are rewritten at the wire level, guided by the message descriptor,
+// without being parsed:
+//   - A string or bytes field whose value is in the table is written with the
+//     VARINT wire type, holding the value's index in the table, in place of
+//     the LENGTH_DELIMITED value.
+//   - Values added to the table by a record are appended to that record as
+//     top level kStringTableEntryField fields, which the decoder reads before
+//     resolving references.
+// All other fields are left as they are, so top level fields such as the
+// SantaMessage event_time can still be read from encoded records.
+//
+// Values only enter the table the second time they are seen in a batch, so
+// that strings unique to a single record aren't stored twice.
+
+namespace fsspool {
+
+// Field numbers at the top of the valid range, which messages don't use
+inline constexpr int kStringTableEntryField = 536870911;
+inline constexpr int kStringTableMarkerField = 536870910;
+inline constexpr uint64_t kStringTableVersion = 1;
+
+// The record that starts each string table encoded batch. Decoders reset their
+// table when they see it, so concatenated batches decode correctly.
+const std::string &StringTableMarker();
+bool IsStringTableMarker(absl::Span<const uint8_t> record);
+
+struct StringTableOptions {
+  // Shorter values cost less to write inline than as references
+  size_t min_value_size = 4;
+  // Once either limit is reached, new values are written inline
+  size_t max_entries = 64 * 1024;
+  size_t max_table_bytes = 16 * 1024 * 1024;
+};
+
+class StringTableEncoder {
+ public:
+  explicit StringTableEncoder(const google::protobuf::Descriptor *descriptor,
+                              StringTableOptions options = {});
+
+  // Clears the table at the start of a batch
+  void Reset();
+
+  // Encodes a serialized message, replacing the contents of out
+  absl::Status Encode(absl::Span<const uint8_t> message, std::string &out);
+
+ private:
+  bool EncodeMessage(const google::protobuf::Descriptor *descriptor,
+                     google::protobuf::io::CodedInputStream &input,
+                     std::string &out, int depth);
+  // Returns the table index for the value, if it should be written as a
+  // reference
+  std::optional<uint32_t> Lookup(const std::string &value);
+
+  const google::protobuf::Descriptor *descriptor_;
+  StringTableOptions options_;
+  absl::flat_hash_map<std::string, uint32_t> table_;
+  size_t table_bytes_ = 0;
+  // Hashes of values seen once, which are added to the table when seen again
+  absl::flat_hash_set<size_t> seen_;
+  // Values added to the table by the record being encoded
+  std::vector<std::string> new_entries_;
+
+  // The record being encoded, and buffers reused across records
+  const uint8_t *data_ = nullptr;
+  std::string value_;
+  std::vector<std::string> scratch_;
+};
+
+class StringTableDecoder {
+ public:
+  explicit StringTableDecoder(const google::protobuf::Descriptor *descriptor);
+
+  // Clears the table at the start of a batch
+  void Reset();
+
+  // Restores the original serialized message, replacing the contents of out
+  absl::Status Decode(absl::Span<const uint8_t> record, std::string &out);
+
+ private:
+  bool DecodeMessage(const google::protobuf::Descriptor *descriptor,
+                     google::protobuf::io::CodedInputStream &input,
+                     std::string &out, int depth);
+
+  const google::protobuf::Descriptor *descriptor_;
+  std::vector<std::string> table_;
+
+  // The record being decoded, and buffers reused across records
+  const uint8_t *data_ = nullptr;
+  std::vector<std::string> scratch_;
+};
+
+}  // namespace fsspool
+
+#endif  // SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_STRINGTABLE_H
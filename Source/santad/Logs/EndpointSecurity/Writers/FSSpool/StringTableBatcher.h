@@ -0,0 +1,83 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_STRINGTABLEBATCHER_H_
+#define SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_STRINGTABLEBATCHER_H_
+
+#include <concepts>
+#include <string>
+#include <utility>
+
+#include "Source/common/santa_proto_include_wrapper.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StringTable.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+
+namespace fsspool {
+
+// Wraps a stream batcher, string table encoding the SantaMessage records of
+// each batch. Every batch starts with the StringTableMarker record, and a
+// fresh table, so files can be decoded independently.
+//
+// Records are still framed by the wrapped batcher, so the file can be read
+// with the same decompression as before, but the records must be passed
+// through a StringTableDecoder before they can be parsed.
+template <typename B>
+class StringTableBatcher {
+ public:
+  template <typename... Args>
+    requires std::constructible_from<B, Args...>
+  StringTableBatcher(Args &&...args)
+      : inner_(std::forward<Args>(args)...),
+        encoder_(::santa::pb::v1::SantaMessage::descriptor()) {}
+
+  inline bool ShouldInitializeBeforeWrite() { return true; }
+
+  absl::Status InitializeBatch(int fd) {
+    encoder_.Reset();
+    absl::Status status = inner_.InitializeBatch(fd);
+    if (!status.ok()) {
+      return status;
+    }
+    const std::string &marker = StringTableMarker();
+    return inner_.Write(absl::Span<const uint8_t>(
+        reinterpret_cast<const uint8_t *>(marker.data()), marker.size()));
+  }
+
+  inline bool NeedToOpenFile() { return inner_.NeedToOpenFile(); }
+
+  absl::Status Write(absl::Span<const uint8_t> bytes) {
+    // A record that can't be encoded is written as is, which decodes to itself
+    if (!encoder_.Encode(bytes, buffer_).ok()) {
+      return inner_.Write(bytes);
+    }
+    return inner_.Write(absl::Span<const uint8_t>(
+        reinterpret_cast<const uint8_t *>(buffer_.data()), buffer_.size()));
+  }
+
+  absl::StatusOr<size_t> CompleteBatch(int fd) {
+    return inner_.CompleteBatch(fd);
+  }
+
+ private:
+  B inner_;
+  StringTableEncoder encoder_;
+  // Reused across records to avoid an allocation per write
+  std::string buffer_;
+};
+
+}  // namespace fsspool
+
+#endif  // SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_STRINGTABLEBATCHER_H_
@@ -0,0 +1,206 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "Source/common/santa_proto_include_wrapper.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamReader.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StringTable.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StringTableBatcher.h"
+#include "absl/status/statusor.h"
+
+using fsspool::StringTableDecoder;
+using fsspool::StringTableEncoder;
+namespace pbv1 = ::santa::pb::v1;
+
+namespace {
+
+absl::Span<const uint8_t> AsSpan(const std::string &s) {
+  return absl::Span<const uint8_t>(reinterpret_cast<const uint8_t *>(s.data()), s.size());
+}
+
+// Serialized executions that share most of their strings
+std::vector<std::string> MakeRecords(int count) {
+  std::vector<std::string> records;
+  for (int i = 0; i < count; i++) {
+    pbv1::SantaMessage msg;
+    msg.set_machine_id("my-machine-id");
+    msg.mutable_event_time()->set_seconds(1700000000 + i);
+    pbv1::Execution *exec = msg.mutable_execution();
+    exec->mutable_target()->mutable_id()->set_pid(100 + i);
+    exec->mutable_target()->mutable_executable()->set_path(
+        "/Applications/App" + std::to_string(i % 3) + ".app/Contents/MacOS/App");
+    exec->mutable_target()->mutable_code_signature()->set_team_id("EQHXZ8M8AV");
+    exec->mutable_instigator()->mutable_executable()->set_path("/bin/zsh");
+    exec->add_args("--unique-" + std::to_string(i));
+    exec->add_envs("PATH=/usr/bin:/bin:/usr/sbin:/sbin");
+    records.push_back(msg.SerializeAsString());
+  }
+  return records;
+}
+
+std::string ReadFile(int fd) {
+  std::string contents;
+  char buf[4096];
+  ssize_t n;
+  lseek(fd, 0, SEEK_SET);
+  while ((n = read(fd, buf, sizeof(buf))) > 0) {
+    contents.append(buf, n);
+  }
+  return contents;
+}
+
+}  // namespace
+
+@interface StringTableTest : XCTestCase
+@end
+
+@implementation StringTableTest
+
+- (void)testRoundTrip {
+  StringTableEncoder encoder(pbv1::SantaMessage::descriptor());
+  StringTableDecoder decoder(pbv1::SantaMessage::descriptor());
+  std::vector<std::string> records = MakeRecords(100);
+
+  size_t original_size = 0;
+  size_t encoded_size = 0;
+  std::string encoded;
+  std::string decoded;
+  for (size_t i = 0; i < records.size(); i++) {
+    XCTAssertTrue(encoder.Encode(AsSpan(records[i]), encoded).ok());
+    // Strings aren't added to the table until they are seen again
+    if (i == 0) {
+      XCTAssertTrue(encoded == records[i]);
+    }
+
+    XCTAssertTrue(decoder.Decode(AsSpan(encoded), decoded).ok());
+    XCTAssertTrue(decoded == records[i]);
+
+    // Encoded records still parse, with references as unknown fields
+    pbv1::SantaMessage msg;
+    XCTAssertTrue(msg.ParseFromString(encoded));
+    XCTAssertEqual(msg.event_time().seconds(), 1700000000 + (int64_t)i);
+
+    original_size += records[i].size();
+    encoded_size += encoded.size();
+  }
+
+  XCTAssertLessThan(encoded_size, original_size / 2);
+}
+
+- (void)testResetStartsNewTable {
+  StringTableEncoder encoder(pbv1::SantaMessage::descriptor());
+  std::vector<std::string> records = MakeRecords(4);
+  std::string encoded;
+
+  for (const std::string &record : records) {
+    XCTAssertTrue(encoder.Encode(AsSpan(record), encoded).ok());
+  }
+  XCTAssertTrue(encoded != records.back());
+
+  // After a reset, strings must be seen again before they are referenced
+  encoder.Reset();
+  XCTAssertTrue(encoder.Encode(AsSpan(records[0]), encoded).ok());
+  XCTAssertTrue(encoded == records[0]);
+
+  // A decoder that missed the records adding entries can't resolve references
+  XCTAssertTrue(encoder.Encode(AsSpan(records[1]), encoded).ok());
+  XCTAssertTrue(encoder.Encode(AsSpan(records[2]), encoded).ok());
+  StringTableDecoder decoder(pbv1::SantaMessage::descriptor());
+  std::string decoded;
+  XCTAssertFalse(decoder.Decode(AsSpan(encoded), decoded).ok());
+}
+
+- (void)testMalformed {
+  StringTableEncoder encoder(pbv1::SantaMessage::descriptor());
+  std::vector<std::string> records = MakeRecords(3);
+  std::string encoded;
+
+  std::string truncated = records[0].substr(0, records[0].size() - 3);
+  XCTAssertFalse(encoder.Encode(AsSpan(truncated), encoded).ok());
+
+  // A failed record doesn't leave entries in the table the decoder never sees
+  StringTableDecoder decoder(pbv1::SantaMessage::descriptor());
+  std::string decoded;
+  for (const std::string &record : records) {
+    XCTAssertTrue(encoder.Encode(AsSpan(record), encoded).ok());
+    XCTAssertTrue(decoder.Decode(AsSpan(encoded), decoded).ok());
+    XCTAssertTrue(decoded == record);
+  }
+}
+
+- (void)testMarker {
+  XCTAssertTrue(fsspool::IsStringTableMarker(AsSpan(fsspool::StringTableMarker())));
+  XCTAssertFalse(fsspool::IsStringTableMarker(AsSpan(MakeRecords(1)[0])));
+  XCTAssertFalse(fsspool::IsStringTableMarker({}));
+}
+
+- (void)testDecodeStringTableFile {
+  std::vector<std::string> records = MakeRecords(50);
+
+  NSString *dir = NSTemporaryDirectory();
+  std::string encodedPath = [dir stringByAppendingPathComponent:@"strtab_encoded"].UTF8String;
+  std::string plainPath = [dir stringByAppendingPathComponent:@"strtab_plain"].UTF8String;
+  std::string decodedPath = [dir stringByAppendingPathComponent:@"strtab_decoded"].UTF8String;
+  int encodedFd = open(encodedPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  int plainFd = open(plainPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  int decodedFd = open(decodedPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  unlink(encodedPath.c_str());
+  unlink(plainPath.c_str());
+  unlink(decodedPath.c_str());
+  XCTAssertGreaterThanOrEqual(encodedFd, 0);
+  XCTAssertGreaterThanOrEqual(plainFd, 0);
+  XCTAssertGreaterThanOrEqual(decodedFd, 0);
+
+  fsspool::StringTableBatcher<fsspool::UncompressedStreamBatcher> encodedBatcher;
+  fsspool::UncompressedStreamBatcher plainBatcher;
+  XCTAssertTrue(encodedBatcher.InitializeBatch(encodedFd).ok());
+  XCTAssertTrue(plainBatcher.InitializeBatch(plainFd).ok());
+  for (const std::string &record : records) {
+    XCTAssertTrue(encodedBatcher.Write(AsSpan(record)).ok());
+    XCTAssertTrue(plainBatcher.Write(AsSpan(record)).ok());
+  }
+  XCTAssertTrue(encodedBatcher.CompleteBatch(encodedFd).ok());
+  XCTAssertTrue(plainBatcher.CompleteBatch(plainFd).ok());
+
+  std::string plain = ReadFile(plainFd);
+  XCTAssertLessThan(ReadFile(encodedFd).size(), plain.size());
+
+  // Decoding produces exactly what the plain batcher wrote
+  absl::StatusOr<bool> decoded = fsspool::DecodeStringTableFile(encodedFd, decodedFd);
+  XCTAssertTrue(decoded.ok());
+  XCTAssertTrue(*decoded);
+  XCTAssertTrue(ReadFile(decodedFd) == plain);
+
+  // Files that aren't encoded are left alone
+  ftruncate(decodedFd, 0);
+  lseek(decodedFd, 0, SEEK_SET);
+  decoded = fsspool::DecodeStringTableFile(plainFd, decodedFd);
+  XCTAssertTrue(decoded.ok());
+  XCTAssertFalse(*decoded);
+  XCTAssertEqual(ReadFile(decodedFd).size(), 0);
+
+  close(encodedFd);
+  close(plainFd);
+  close(decodedFd);
+}
+
+@end
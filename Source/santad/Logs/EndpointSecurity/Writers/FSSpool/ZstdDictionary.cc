@@ -0,0 +1,92 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdDictionary.h"
+
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+
+#define ZSTD_STATIC_LINKING_ONLY
+#include "zstd.h"
+
+namespace fsspool {
+
+absl::StatusOr<std::shared_ptr<ZstdDictionary>> ZstdDictionary::Load(
+    const std::string& path, int compression_level) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f) {
+    return absl::NotFoundError(
+        absl::StrFormat("Unable to open zstd dictionary: %s", path));
+  }
+
+  std::string contents;
+  f.seekg(0, std::ios::end);
+  std::streamoff size = f.tellg();
+  if (size < 0 || static_cast<size_t>(size) > kMaxDictionarySize) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Invalid zstd dictionary size: %s", path));
+  }
+  f.seekg(0, std::ios::beg);
+  contents.resize(static_cast<size_t>(size));
+  if (!f.read(contents.data(), size)) {
+    return absl::InternalError(
+        absl::StrFormat("Unable to read zstd dictionary: %s", path));
+  }
+
+  return Create(std::move(contents), compression_level);
+}
+
+absl::StatusOr<std::shared_ptr<ZstdDictionary>> ZstdDictionary::Create(
+    std::string contents, int compression_level) {
+  // Raw content dictionaries have no ID to record in frames, which would
+  // leave readers unable to tell which dictionary a file requires.
+  uint32_t id = ZSTD_getDictID_fromDict(contents.data(), contents.size());
+  if (id == 0) {
+    return absl::InvalidArgumentError(
+        "Not a zstd dictionary, or the dictionary has no ID");
+  }
+
+  auto dictionary = std::make_shared<ZstdDictionary>(std::move(contents), id);
+
+  dictionary->cdict_ = ZSTD_createCDict(dictionary->contents_.data(),
+                                        dictionary->contents_.size(),
+                                        compression_level);
+  if (!dictionary->cdict_) {
+    return absl::InternalError("Failed to create zstd compression dictionary");
+  }
+
+  dictionary->ddict_ = ZSTD_createDDict_advanced(
+      dictionary->contents_.data(), dictionary->contents_.size(),
+      ZSTD_dlm_byRef, ZSTD_dct_fullDict, ZSTD_defaultCMem);
+  if (!dictionary->ddict_) {
+    return absl::InternalError(
+        "Failed to create zstd decompression dictionary");
+  }
+
+  return dictionary;
+}
+
+ZstdDictionary::ZstdDictionary(std::string contents, uint32_t id)
+    : contents_(std::move(contents)), id_(id) {}
+
+ZstdDictionary::~ZstdDictionary() {
+  ZSTD_freeDDict(ddict_);
+  ZSTD_freeCDict(cdict_);
+}
+
+}  // namespace fsspool
@@ -0,0 +1,72 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDDICTIONARY_H
+#define SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDDICTIONARY_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "absl/status/statusor.h"
+#include "zstd.h"
+
+namespace fsspool {
+
+// A zstd dictionary trained on spooled telemetry, digested for both
+// compression and decompression.
+//
+// The dictionary ID is embedded in the header of every frame compressed with
+// the dictionary, and serves as the dictionary's version. Readers use it to
+// select the matching dictionary when decoding a spool file.
+class ZstdDictionary {
+ public:
+  // Dictionaries larger than this are rejected when loading.
+  static constexpr size_t kMaxDictionarySize = 1024 * 1024;
+
+  static absl::StatusOr<std::shared_ptr<ZstdDictionary>> Load(
+      const std::string& path, int compression_level = ZSTD_CLEVEL_DEFAULT);
+
+  static absl::StatusOr<std::shared_ptr<ZstdDictionary>> Create(
+      std::string contents, int compression_level = ZSTD_CLEVEL_DEFAULT);
+
+  ZstdDictionary(std::string contents, uint32_t id);
+  ~ZstdDictionary();
+
+  // Not copyable
+  ZstdDictionary(const ZstdDictionary&) = delete;
+  ZstdDictionary& operator=(const ZstdDictionary&) = delete;
+
+  uint32_t ID() const { return id_; }
+  size_t Size() const { return contents_.size(); }
+  std::string_view Contents() const { return contents_; }
+  // Digested at the level given when creating the dictionary, which zstd uses
+  // for every frame compressed with it. Streams compressing at their own level
+  // load Contents() instead.
+  const ZSTD_CDict* CDict() const { return cdict_; }
+  const ZSTD_DDict* DDict() const { return ddict_; }
+
+ private:
+  // The DDict and compression streams reference this buffer rather than
+  // holding a copy.
+  std::string contents_;
+  uint32_t id_;
+  ZSTD_CDict* cdict_ = nullptr;
+  ZSTD_DDict* ddict_ = nullptr;
+};
+
+}  // namespace fsspool
+
+#endif  // SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDDICTIONARY_H
@@ -0,0 +1,91 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDINPUTSTREAM_H
+#define SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDINPUTSTREAM_H
+
+#include <memory>
+#include <vector>
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdDictionary.h"
+#include "absl/status/status.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "zstd.h"
+
+namespace fsspool {
+
+struct ZstdInputStreamOptions {
+  // Matches the ZstdOutputStream default buffer size
+  static constexpr size_t kDefaultBufferSize = 64 * 1024;
+
+  size_t buffer_size = kDefaultBufferSize;
+  // Dictionaries available to decompress frames. The dictionary used for each
+  // frame is selected by the ID recorded in its header.
+  std::vector<std::shared_ptr<const ZstdDictionary>> dictionaries;
+};
+
+// Decompresses a stream of zstd frames as it is read. Memory use is bounded by
+// the buffer size and the zstd window size, regardless of the stream length.
+// Skippable frames, such as the FrameIndex of seekable spool files, are
+// passed over.
+class ZstdInputStream : public google::protobuf::io::ZeroCopyInputStream {
+ public:
+  static std::unique_ptr<ZstdInputStream> Create(
+      google::protobuf::io::ZeroCopyInputStream* input,
+      ZstdInputStreamOptions options = {});
+
+  ZstdInputStream(google::protobuf::io::ZeroCopyInputStream* input,
+                  ZSTD_DStream* dstream, ZstdInputStreamOptions options);
+
+  ~ZstdInputStream();
+
+  // ZeroCopyInputStream interface
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+
+  // Once Next returns false, distinguishes the end of the stream from
+  // decompression failures and truncated frames.
+  absl::Status status() const { return status_; }
+
+ private:
+  bool Decompress();
+
+  google::protobuf::io::ZeroCopyInputStream* input_;
+  ZSTD_DStream* dstream_;
+  // Held so the digested dictionaries outlive the stream referencing them.
+  std::vector<std::shared_ptr<const ZstdDictionary>> dictionaries_;
+
+  // Compressed data most recently provided by the underlying stream
+  const void* input_data_;
+  int input_size_;
+  int input_position_;
+  // Whether zstd may hold decompressed data that didn't fit in the buffer
+  bool flush_pending_;
+  // Whether the last frame seen has not been completely decoded
+  bool frame_pending_;
+
+  // Output buffer for decompressed data
+  std::vector<uint8_t> output_buffer_;
+  size_t output_position_;
+  size_t output_available_;
+
+  int64_t byte_count_;
+  absl::Status status_;
+};
+
+}  // namespace fsspool
+
+#endif  // SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDINPUTSTREAM_H
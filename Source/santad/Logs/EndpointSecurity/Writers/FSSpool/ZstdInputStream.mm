@@ -0,0 +1,179 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdInputStream.h"
+
+#include "absl/strings/str_format.h"
+
+#define ZSTD_STATIC_LINKING_ONLY
+#include "zstd.h"
+
+namespace fsspool {
+
+std::unique_ptr<ZstdInputStream> ZstdInputStream::Create(
+    google::protobuf::io::ZeroCopyInputStream *input, ZstdInputStreamOptions options) {
+  ZSTD_DStream *dstream = ZSTD_createDStream();
+  if (!dstream) {
+    return nullptr;
+  }
+
+  size_t result = ZSTD_initDStream(dstream);
+  if (ZSTD_isError(result)) {
+    ZSTD_freeDStream(dstream);
+    return nullptr;
+  }
+
+  if (!options.dictionaries.empty()) {
+    // Select the referenced dictionary matching each frame's dictionary ID,
+    // rather than only using the most recently referenced one.
+    result = ZSTD_DCtx_setParameter(dstream, ZSTD_d_refMultipleDDicts, ZSTD_rmd_refMultipleDDicts);
+    for (const auto &dictionary : options.dictionaries) {
+      if (ZSTD_isError(result)) {
+        break;
+      }
+      result = ZSTD_DCtx_refDDict(dstream, dictionary->DDict());
+    }
+    if (ZSTD_isError(result)) {
+      ZSTD_freeDStream(dstream);
+      return nullptr;
+    }
+  }
+
+  return std::make_unique<ZstdInputStream>(input, dstream, std::move(options));
+}
+
+ZstdInputStream::ZstdInputStream(google::protobuf::io::ZeroCopyInputStream *input,
+                                 ZSTD_DStream *dstream, ZstdInputStreamOptions options)
+    : input_(input),
+      dstream_(dstream),
+      dictionaries_(std::move(options.dictionaries)),
+      input_data_(nullptr),
+      input_size_(0),
+      input_position_(0),
+      flush_pending_(false),
+      frame_pending_(false),
+      output_buffer_(options.buffer_size),
+      output_position_(0),
+      output_available_(0),
+      byte_count_(0) {}
+
+ZstdInputStream::~ZstdInputStream() {
+  // Return any compressed data that wasn't consumed to the underlying stream
+  if (input_position_ < input_size_) {
+    input_->BackUp(input_size_ - input_position_);
+  }
+  ZSTD_freeDStream(dstream_);
+}
+
+bool ZstdInputStream::Next(const void **data, int *size) {
+  if (output_position_ == output_available_ && !Decompress()) {
+    return false;
+  }
+
+  *data = output_buffer_.data() + output_position_;
+  *size = static_cast<int>(output_available_ - output_position_);
+
+  byte_count_ += *size;
+  output_position_ = output_available_;
+
+  return true;
+}
+
+void ZstdInputStream::BackUp(int count) {
+  if (count < 0 || static_cast<size_t>(count) > output_position_) {
+    return;
+  }
+
+  output_position_ -= count;
+  byte_count_ -= count;
+}
+
+bool ZstdInputStream::Skip(int count) {
+  const void *data;
+  int size;
+  while (count > 0) {
+    if (!Next(&data, &size)) {
+      return false;
+    }
+    if (size > count) {
+      BackUp(size - count);
+      return true;
+    }
+    count -= size;
+  }
+  return true;
+}
+
+int64_t ZstdInputStream::ByteCount() const {
+  return byte_count_;
+}
+
+bool ZstdInputStream::Decompress() {
+  output_position_ = 0;
+  output_available_ = 0;
+
+  if (!status_.ok()) {
+    return false;
+  }
+
+  // Zstd doesn't always produce output for the input it consumes, e.g. while
+  // reading frame headers or skippable frames, so keep going until it does.
+  while (output_available_ == 0) {
+    // Data left in zstd's internal buffers must be drained before asking for
+    // more input, which may no longer be available.
+    if (input_position_ == input_size_ && !flush_pending_) {
+      if (!input_->Next(&input_data_, &input_size_)) {
+        input_size_ = 0;
+        input_position_ = 0;
+        if (frame_pending_) {
+          status_ = absl::DataLossError("Truncated zstd stream");
+        }
+        return false;
+      }
+      input_position_ = 0;
+    }
+
+    ZSTD_inBuffer input = {
+        .src = input_data_,
+        .size = static_cast<size_t>(input_size_),
+        .pos = static_cast<size_t>(input_position_),
+    };
+    ZSTD_outBuffer output = {
+        .dst = output_buffer_.data(),
+        .size = output_buffer_.size(),
+        .pos = 0,
+    };
+
+    size_t result = ZSTD_decompressStream(dstream_, &output, &input);
+    if (ZSTD_isError(result)) {
+      if (ZSTD_getErrorCode(result) == ZSTD_error_dictionary_wrong) {
+        status_ = absl::FailedPreconditionError("Missing zstd dictionary");
+      } else {
+        status_ = absl::DataLossError(absl::StrFormat(
+            "Failed to decompress zstd stream: %d: %s", ZSTD_getErrorCode(result),
+            ZSTD_getErrorName(result)));
+      }
+      return false;
+    }
+
+    input_position_ = static_cast<int>(input.pos);
+    flush_pending_ = output.pos == output.size;
+    frame_pending_ = result != 0;
+    output_available_ = output.pos;
+  }
+
+  return true;
+}
+
+}  // namespace fsspool
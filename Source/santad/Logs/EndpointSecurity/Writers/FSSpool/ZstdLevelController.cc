@@ -0,0 +1,67 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdLevelController.h"
+
+#include <algorithm>
+
+namespace fsspool {
+
+ZstdLevelController::ZstdLevelController(int max_level, bool adaptive,
+                                         int min_level)
+    : max_level_(max_level),
+      min_level_(std::min(min_level, max_level)),
+      adaptive_(adaptive),
+      level_(max_level) {}
+
+void ZstdLevelController::ObserveBacklog(size_t depth, size_t capacity,
+                                         absl::Time now) {
+  if (!adaptive_ || capacity == 0) {
+    return;
+  }
+
+  double backlog = static_cast<double>(depth) / capacity;
+
+  absl::MutexLock lock(&adjust_mu_);
+  int level = Level();
+  if (backlog >= kHighBacklog && level > min_level_ &&
+      now - last_adjustment_ >= kLowerInterval) {
+    level_.store(level - 1, std::memory_order_relaxed);
+    last_adjustment_ = now;
+  } else if (backlog <= kLowBacklog && level < max_level_ &&
+             now - last_adjustment_ >= kRaiseInterval) {
+    level_.store(level + 1, std::memory_order_relaxed);
+    last_adjustment_ = now;
+  }
+}
+
+void ZstdLevelController::RecordCompression(size_t bytes_in, size_t bytes_out,
+                                            absl::Duration elapsed) {
+  bytes_in_.fetch_add(bytes_in, std::memory_order_relaxed);
+  bytes_out_.fetch_add(bytes_out, std::memory_order_relaxed);
+  compression_time_ns_.fetch_add(absl::ToInt64Nanoseconds(elapsed),
+                                 std::memory_order_relaxed);
+}
+
+ZstdLevelController::Stats ZstdLevelController::GetStats() const {
+  return Stats{
+      .level = Level(),
+      .bytes_in = bytes_in_.load(std::memory_order_relaxed),
+      .bytes_out = bytes_out_.load(std::memory_order_relaxed),
+      .compression_time = absl::Nanoseconds(
+          compression_time_ns_.load(std::memory_order_relaxed)),
+  };
+}
+
+}  // namespace fsspool
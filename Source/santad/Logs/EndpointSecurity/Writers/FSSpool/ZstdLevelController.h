@@ -0,0 +1,87 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDLEVELCONTROLLER_H
+#define SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDLEVELCONTROLLER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace fsspool {
+
+// Chooses the zstd compression level for spooled telemetry and accumulates
+// compression statistics across spool files.
+//
+// In adaptive mode, the level is lowered while records back up in front of the
+// compressor, trading ratio for throughput so that events aren't dropped, and
+// is raised back towards the configured level once the backlog clears. Levels
+// are lowered quickly and raised slowly to avoid oscillating.
+class ZstdLevelController {
+ public:
+  struct Stats {
+    int level;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    absl::Duration compression_time;
+  };
+
+  static constexpr int kDefaultMinLevel = 1;
+  // Backlog, as a fraction of the queue capacity, above which the level is
+  // lowered and below which it is raised.
+  static constexpr double kHighBacklog = 0.25;
+  static constexpr double kLowBacklog = 0.01;
+  static constexpr absl::Duration kLowerInterval = absl::Milliseconds(100);
+  static constexpr absl::Duration kRaiseInterval = absl::Seconds(5);
+
+  ZstdLevelController(int max_level, bool adaptive,
+                      int min_level = kDefaultMinLevel);
+
+  // The level that new compression work should use.
+  int Level() const { return level_.load(std::memory_order_relaxed); }
+
+  // Report the number of records waiting to be compressed. No-op unless the
+  // controller is adaptive.
+  void ObserveBacklog(size_t depth, size_t capacity,
+                      absl::Time now = absl::Now());
+
+  // Accumulate compression statistics. `elapsed` is zero when the time spent
+  // compressing isn't known, e.g. when zstd compresses on worker threads.
+  void RecordCompression(size_t bytes_in, size_t bytes_out,
+                         absl::Duration elapsed);
+
+  Stats GetStats() const;
+
+ private:
+  const int max_level_;
+  const int min_level_;
+  const bool adaptive_;
+
+  std::atomic<int> level_;
+  std::atomic<uint64_t> bytes_in_ = 0;
+  std::atomic<uint64_t> bytes_out_ = 0;
+  std::atomic<int64_t> compression_time_ns_ = 0;
+
+  absl::Mutex adjust_mu_;
+  absl::Time last_adjustment_ ABSL_GUARDED_BY(adjust_mu_) =
+      absl::InfinitePast();
+};
+
+}  // namespace fsspool
+
+#endif  // SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDLEVELCONTROLLER_H
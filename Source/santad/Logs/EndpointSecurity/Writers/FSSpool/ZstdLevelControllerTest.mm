@@ -0,0 +1,90 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdLevelController.h"
+#include "absl/time/time.h"
+
+using fsspool::ZstdLevelController;
+
+@interface ZstdLevelControllerTest : XCTestCase
+@end
+
+@implementation ZstdLevelControllerTest
+
+- (void)testFixedLevel {
+  ZstdLevelController controller(5, false);
+  absl::Time now = absl::Now();
+
+  controller.ObserveBacklog(1000, 1000, now);
+  controller.ObserveBacklog(1000, 1000, now + absl::Seconds(1));
+  XCTAssertEqual(controller.Level(), 5);
+}
+
+- (void)testAdaptiveLevel {
+  ZstdLevelController controller(4, true, 2);
+  absl::Time now = absl::Now();
+
+  // A high backlog lowers the level, at most once per interval
+  controller.ObserveBacklog(500, 1000, now);
+  XCTAssertEqual(controller.Level(), 3);
+  controller.ObserveBacklog(500, 1000, now);
+  XCTAssertEqual(controller.Level(), 3);
+
+  now += ZstdLevelController::kLowerInterval;
+  controller.ObserveBacklog(500, 1000, now);
+  XCTAssertEqual(controller.Level(), 2);
+
+  // Never below the minimum
+  now += ZstdLevelController::kLowerInterval;
+  controller.ObserveBacklog(1000, 1000, now);
+  XCTAssertEqual(controller.Level(), 2);
+
+  // A moderate backlog holds the level
+  now += ZstdLevelController::kRaiseInterval;
+  controller.ObserveBacklog(100, 1000, now);
+  XCTAssertEqual(controller.Level(), 2);
+
+  // An idle queue raises the level, more slowly than it is lowered
+  controller.ObserveBacklog(0, 1000, now);
+  XCTAssertEqual(controller.Level(), 3);
+  now += ZstdLevelController::kLowerInterval;
+  controller.ObserveBacklog(0, 1000, now);
+  XCTAssertEqual(controller.Level(), 3);
+
+  now += ZstdLevelController::kRaiseInterval;
+  controller.ObserveBacklog(0, 1000, now);
+  XCTAssertEqual(controller.Level(), 4);
+
+  // Never above the configured level
+  now += ZstdLevelController::kRaiseInterval;
+  controller.ObserveBacklog(0, 1000, now);
+  XCTAssertEqual(controller.Level(), 4);
+}
+
+- (void)testStats {
+  ZstdLevelController controller(3, false);
+
+  controller.RecordCompression(1000, 100, absl::Milliseconds(2));
+  controller.RecordCompression(500, 50, absl::Milliseconds(1));
+
+  ZstdLevelController::Stats stats = controller.GetStats();
+  XCTAssertEqual(stats.level, 3);
+  XCTAssertEqual(stats.bytes_in, 1500);
+  XCTAssertEqual(stats.bytes_out, 150);
+  XCTAssertTrue(stats.compression_time == absl::Milliseconds(3));
+}
+
+@end
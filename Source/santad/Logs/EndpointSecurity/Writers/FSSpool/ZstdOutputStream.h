@@ -15,25 +15,43 @@
 #ifndef SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDOUTPUTSTREAM_H
 #define SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_ZSTDOUTPUTSTREAM_H
 
+#include <memory>
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdDictionary.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdLevelController.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/stubs/common.h"
 #include "zstd.h"
 
 namespace fsspool {
 
-class ZstdOutputStream : public google::protobuf::io::ZeroCopyOutputStream {
- public:
+struct ZstdOutputStreamOptions {
   // Matches the Gzip default buffer size
   static constexpr size_t kDefaultBufferSize = 64 * 1024;
 
+  int compression_level = ZSTD_CLEVEL_DEFAULT;
+  size_t buffer_size = kDefaultBufferSize;
+  // Number of zstd worker threads compressing in the background. With 0,
+  // compression happens on the writing thread. Ignored if zstd was built
+  // without multithreading support.
+  int workers = 0;
+  // When given, the dictionary's ID is recorded in the frame header so that
+  // readers can select the matching dictionary.
+  std::shared_ptr<const ZstdDictionary> dictionary;
+  // When given, the controller's level takes precedence over
+  // compression_level, and compression statistics are reported to it. Time
+  // spent compressing is only reported when there are no workers.
+  std::shared_ptr<ZstdLevelController> level_controller;
+};
+
+class ZstdOutputStream : public google::protobuf::io::ZeroCopyOutputStream {
+ public:
   static std::unique_ptr<ZstdOutputStream> Create(
       google::protobuf::io::ZeroCopyOutputStream* output,
-      int compression_level = ZSTD_CLEVEL_DEFAULT,
-      size_t buffer_size = kDefaultBufferSize);
+      ZstdOutputStreamOptions options = {});
 
   ZstdOutputStream(google::protobuf::io::ZeroCopyOutputStream* output,
-                   ZSTD_CStream* cstream,
-                   size_t buffer_size = kDefaultBufferSize);
+                   ZSTD_CStream* cstream, ZstdOutputStreamOptions options);
 
   ~ZstdOutputStream();
 
@@ -42,12 +60,24 @@ class ZstdOutputStream : public google::protobuf::io::ZeroCopyOutputStream {
   void BackUp(int count) override;
   int64_t ByteCount() const override;
 
+  // Compresses all buffered data and ends the current frame, so that data
+  // written afterwards starts a new, independently decompressible frame.
+  bool EndFrame();
+
  private:
   bool CompressAndFlush(ZSTD_EndDirective end_directive);
   bool FlushOutput(size_t bytes_to_write);
+  void UpdateLevel();
 
   google::protobuf::io::ZeroCopyOutputStream* output_;
   ZSTD_CStream* cstream_;
+  // Held so the dictionary contents outlive the stream referencing them.
+  std::shared_ptr<const ZstdDictionary> dictionary_;
+  std::shared_ptr<ZstdLevelController> level_controller_;
+  bool multithreaded_;
+  int level_;
+  // Whether data has been provided since the last frame was ended
+  bool frame_pending_;
 
   // Input buffer for uncompressed data
   std::vector<uint8_t> input_buffer_;
@@ -14,40 +14,81 @@
 
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdOutputStream.h"
 
+#include <chrono>
 #include <climits>
 #include <cstdint>
 #include <iostream>
+#include <string_view>
+
+#define ZSTD_STATIC_LINKING_ONLY
+#include "zstd.h"
 
 namespace fsspool {
 
 std::unique_ptr<ZstdOutputStream> ZstdOutputStream::Create(
-    google::protobuf::io::ZeroCopyOutputStream *output, int compression_level, size_t buffer_size) {
+    google::protobuf::io::ZeroCopyOutputStream *output, ZstdOutputStreamOptions options) {
   ZSTD_CStream *cstream = ZSTD_createCStream();
   if (!cstream) {
     return nullptr;
   }
 
-  size_t result = ZSTD_initCStream(cstream, compression_level);
+  if (options.level_controller) {
+    options.compression_level = options.level_controller->Level();
+  }
+
+  size_t result = ZSTD_initCStream(cstream, options.compression_level);
   if (ZSTD_isError(result)) {
     ZSTD_freeCStream(cstream);
     return nullptr;
   }
 
-  return std::make_unique<ZstdOutputStream>(output, cstream, buffer_size);
+  if (options.dictionary) {
+    // A referenced CDict would impose the level it was digested at on every
+    // frame. Instead the dictionary is loaded into each frame at the stream's
+    // current level, so both the configured level and adaptive changes apply.
+    std::string_view contents = options.dictionary->Contents();
+    result = ZSTD_CCtx_loadDictionary_advanced(cstream, contents.data(), contents.size(),
+                                               ZSTD_dlm_byRef, ZSTD_dct_fullDict);
+    if (!ZSTD_isError(result)) {
+      result = ZSTD_CCtx_setParameter(cstream, ZSTD_c_forceAttachDict, ZSTD_dictForceLoad);
+    }
+    if (ZSTD_isError(result)) {
+      ZSTD_freeCStream(cstream);
+      return nullptr;
+    }
+  }
+
+  if (options.workers > 0) {
+    // Fails when zstd was built without multithreading, in which case
+    // compression continues on the writing thread.
+    result = ZSTD_CCtx_setParameter(cstream, ZSTD_c_nbWorkers, options.workers);
+    if (ZSTD_isError(result)) {
+      options.workers = 0;
+    }
+  }
+
+  return std::make_unique<ZstdOutputStream>(output, cstream, std::move(options));
 }
 
 ZstdOutputStream::ZstdOutputStream(google::protobuf::io::ZeroCopyOutputStream *output,
-                                   ZSTD_CStream *cstream, size_t buffer_size)
+                                   ZSTD_CStream *cstream, ZstdOutputStreamOptions options)
     : output_(output),
       cstream_(cstream),
-      input_buffer_(buffer_size),
+      dictionary_(std::move(options.dictionary)),
+      level_controller_(std::move(options.level_controller)),
+      multithreaded_(options.workers > 0),
+      level_(options.compression_level),
+      frame_pending_(false),
+      input_buffer_(options.buffer_size),
       input_position_(0),
       input_available_(0),
-      output_buffer_(buffer_size),
+      output_buffer_(options.buffer_size),
       byte_count_(0) {}
 
 ZstdOutputStream::~ZstdOutputStream() {
-  CompressAndFlush(ZSTD_e_end);
+  if (frame_pending_) {
+    CompressAndFlush(ZSTD_e_end);
+  }
   ZSTD_freeCStream(cstream_);
 }
 
@@ -66,6 +107,7 @@ bool ZstdOutputStream::Next(void **data, int *size) {
   input_position_ = 0;
   input_available_ = input_buffer_.size();
   byte_count_ += input_buffer_.size();
+  frame_pending_ = true;
 
   return true;
 }
@@ -83,7 +125,39 @@ int64_t ZstdOutputStream::ByteCount() const {
   return byte_count_;
 }
 
+bool ZstdOutputStream::EndFrame() {
+  if (!frame_pending_) {
+    return true;
+  }
+
+  if (!CompressAndFlush(ZSTD_e_end)) {
+    return false;
+  }
+
+  frame_pending_ = false;
+  UpdateLevel();
+  return true;
+}
+
+void ZstdOutputStream::UpdateLevel() {
+  // Zstd only applies a new level within a frame when compressing with
+  // workers. Otherwise the controller's level is picked up by the next frame.
+  if (!level_controller_ || (frame_pending_ && !multithreaded_)) {
+    return;
+  }
+
+  int level = level_controller_->Level();
+  if (level != level_ &&
+      !ZSTD_isError(ZSTD_CCtx_setParameter(cstream_, ZSTD_c_compressionLevel, level))) {
+    level_ = level;
+  }
+}
+
 bool ZstdOutputStream::CompressAndFlush(ZSTD_EndDirective end_directive) {
+  UpdateLevel();
+  auto start = std::chrono::steady_clock::now();
+  size_t bytes_out = 0;
+
   ZSTD_inBuffer input = {
       .src = input_buffer_.data(),
       .size = input_available_,
@@ -108,9 +182,20 @@ bool ZstdOutputStream::CompressAndFlush(ZSTD_EndDirective end_directive) {
       if (!FlushOutput(output.pos)) {
         return false;
       }
+      bytes_out += output.pos;
     }
   } while ((end_directive == ZSTD_e_end) ? (remaining != 0) : (input.pos < input.size));
 
+  if (level_controller_) {
+    // With workers, this call only waits for the workers to accept input and
+    // return whatever output is ready, so its duration isn't compression time
+    // and isn't recorded.
+    level_controller_->RecordCompression(
+        input.size, bytes_out,
+        multithreaded_ ? absl::ZeroDuration()
+                       : absl::FromChrono(std::chrono::steady_clock::now() - start));
+  }
+
   // Reset input buffer
   input_available_ = 0;
   input_position_ = 0;
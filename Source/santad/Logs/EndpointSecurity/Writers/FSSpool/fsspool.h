@@ -22,20 +22,29 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 
+#include <memory>
+#include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/fsspool_platform_specific.h"
+#include "absl/container/btree_set.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/random/random.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/match.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
 #include "absl/strings/substitute.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 
 // Forward declarations
 namespace fsspool {
@@ -49,7 +58,7 @@ template <typename T>
 concept BatcherInterface =
     (std::default_initializable<T> || requires {
       T{std::declval<std::function<void()>>()};
-    }) && requires(T batcher, int fd, std::vector<uint8_t> bytes) {
+    }) && requires(T batcher, int fd, absl::Span<const uint8_t> bytes) {
       { batcher.ShouldInitializeBeforeWrite() } -> std::same_as<bool>;
       { batcher.InitializeBatch(fd) } -> std::same_as<absl::Status>;
       { batcher.NeedToOpenFile() } -> std::same_as<bool>;
@@ -98,6 +107,30 @@ class FsSpoolWriter {
   ~FsSpoolWriter() { (void)Flush(); };
 
   absl::Status SpaceAvailable() {
+    if (SpoolSizeLedger* ledger = LedgerIfAvailable(); ledger) {
+      if (ledger->Size() <= max_spool_size_) {
+        return absl::OkStatus();
+      }
+
+      // Files removed without going through a reader aren't reflected in the
+      // ledger. Occasionally resync from the spool directory while full so
+      // that the spool can't remain stuck at capacity.
+      absl::Time now = absl::Now();
+      if (now - last_ledger_resync_ >= kSpoolSizeLedgerResyncInterval) {
+        last_ledger_resync_ = now;
+        if (absl::StatusOr<size_t> size = EstimateDirSize(spool_dir_);
+            size.ok()) {
+          ledger->Reset(*size);
+        }
+      }
+
+      if (ledger->Size() > max_spool_size_) {
+        return absl::ResourceExhaustedError(
+            "Spool size greater than max allowed");
+      }
+      return absl::OkStatus();
+    }
+
     if (spool_size_estimate_ > max_spool_size_) {
       absl::StatusOr<size_t> estimate = EstimateSpoolDirSize();
       if (!estimate.ok()) {
@@ -158,6 +191,15 @@ class FsSpoolWriter {
 
     absl::StatusOr<size_t> size_estimate =
         batcher_.CompleteBatch(current_spool_state_.tmp_fd);
+    // The ledger is charged for what the file actually occupies on disk so
+    // that it matches what readers discharge when deleting the file.
+    struct stat stats;
+    size_t disk_size = 0;
+    if (size_estimate.ok()) {
+      disk_size = fstat(current_spool_state_.tmp_fd, &stats) == 0
+                      ? EstimateDiskOccupation(stats.st_size)
+                      : EstimateDiskOccupation(*size_estimate);
+    }
     ::fsspool::Close(current_spool_state_.tmp_fd);
     current_spool_state_.tmp_fd = -1;
 
@@ -175,6 +217,10 @@ class FsSpoolWriter {
       return status;
     }
 
+    if (ledger_) {
+      ledger_->Add(disk_size);
+    }
+
     return absl::OkStatus();
   }
 
@@ -183,7 +229,10 @@ class FsSpoolWriter {
   // Returns DataLossError if writes weren't attempted due to a previous
   // space check failure
   // Otherwise returns OK or an appropriate failure status
-  absl::Status Write(std::vector<uint8_t> bytes) {
+  //
+  // The bytes are consumed before returning, so the caller may reuse the
+  // underlying buffer.
+  absl::Status Write(absl::Span<const uint8_t> bytes) {
     // Initializer the batcher before write if required
     if (batcher_.ShouldInitializeBeforeWrite()) {
       // Don't attempt initialization if a previous initialization check
@@ -201,7 +250,7 @@ class FsSpoolWriter {
       }
     }
 
-    return batcher_.Write(std::move(bytes));
+    return batcher_.Write(bytes);
   }
 
   absl::Status Flush() {
@@ -246,6 +295,31 @@ class FsSpoolWriter {
     return absl::OkStatus();
   }
 
+  // Opens the shared spool size ledger on first use and seeds it from the
+  // contents of the spool directory. This is only attempted once; if the
+  // ledger is unavailable the writer falls back to estimating the spool size
+  // from the directory itself.
+  SpoolSizeLedger* LedgerIfAvailable() {
+    if (ledger_open_attempted_) {
+      return ledger_.get();
+    }
+    ledger_open_attempted_ = true;
+
+    absl::StatusOr<size_t> size = EstimateDirSize(spool_dir_);
+    if (!size.ok()) {
+      return nullptr;
+    }
+    absl::StatusOr<std::unique_ptr<SpoolSizeLedger>> ledger =
+        SpoolSizeLedger::Open(SpoolSizeLedgerPath(base_dir_));
+    if (!ledger.ok()) {
+      return nullptr;
+    }
+    ledger_ = *std::move(ledger);
+    ledger_->Reset(*size);
+    last_ledger_resync_ = absl::Now();
+    return ledger_.get();
+  }
+
   // Generates a unique filename by combining the random ID of
   // this writer with a sequence number.
   std::string UniqueFilename() {
@@ -326,35 +400,98 @@ class FsSpoolWriter {
   // approximate disk space occupied by each message written (in multiples of
   // 4KiB, i.e. a typical disk cluster size).
   size_t spool_size_estimate_;
+
+  // Shared with other writers and readers of the spool. When available it
+  // replaces `spool_size_estimate_`, and is kept up to date incrementally:
+  // writers add each file they spool and readers subtract each file they
+  // delete.
+  std::unique_ptr<SpoolSizeLedger> ledger_;
+  bool ledger_open_attempted_ = false;
+  absl::Time last_ledger_resync_;
+  static constexpr absl::Duration kSpoolSizeLedgerResyncInterval =
+      absl::Minutes(1);
 };
 
 // This class is thread-unsafe.
+//
+// The reader keeps an ordered in-memory index of the spooled files so that
+// handing out messages does not require scanning and stat'ing the entire spool
+// directory on every call. The index is refreshed only when the modification
+// time of the spool directory changes, and only files not already known to
+// the reader are stat'd during a refresh.
 class FsSpoolReader {
  public:
   explicit FsSpoolReader(absl::string_view base_directory)
       : base_dir_(base_directory),
         spool_dir_(SpoolNewDirectory(base_directory)) {}
+
   absl::Status AckMessage(const std::string& message_path, bool delete_file) {
-    if (delete_file) {
-      int remove_status = remove(message_path.c_str());
-      if ((remove_status != 0) && (errno != ENOENT)) {
-        return absl::ErrnoToStatus(
-            errno,
-            absl::Substitute("Failed to remove $0: $1", message_path, errno));
+    return AckMessages({{message_path, delete_file}});
+  }
+
+  // Acknowledges a set of messages, mapping each message path to whether or
+  // not its file should be deleted. Deletions are batched together. Messages
+  // acked without being deleted become eligible to be handed out again.
+  absl::Status AckMessages(
+      const absl::flat_hash_map<std::string, bool>& messages) {
+    std::vector<std::string> delete_names;
+    absl::flat_hash_map<std::string, size_t> delete_sizes;
+    absl::Status status = absl::OkStatus();
+    for (const auto& [message_path, delete_file] : messages) {
+      std::optional<std::string> file_name = SpoolFileName(message_path);
+      if (!file_name.has_value()) {
+        // Not a path handed out by this reader, but honor the request anyway.
+        if (delete_file && remove(message_path.c_str()) != 0 &&
+            errno != ENOENT && status.ok()) {
+          status = absl::ErrnoToStatus(
+              errno, absl::Substitute("Failed to remove $0: $1", message_path,
+                                      errno));
+        }
+        continue;
+      }
+
+      auto it = unacked_messages_.find(*file_name);
+      if (delete_file) {
+        if (it != unacked_messages_.end()) {
+          delete_sizes[*file_name] = it->second.disk_size;
+          unacked_messages_.erase(it);
+        } else if (auto pending = pending_.find(*file_name);
+                   pending != pending_.end()) {
+          delete_sizes[*file_name] = pending->second.disk_size;
+          RemoveFromIndex(*file_name);
+        }
+        delete_names.push_back(*std::move(file_name));
+      } else if (it != unacked_messages_.end()) {
+        AddToIndex(it->first, it->second);
+        unacked_messages_.erase(it);
       }
     }
-    unacked_messages_.erase(message_path);
-    return absl::OkStatus();
+
+    SpoolSizeLedger* ledger =
+        delete_names.empty() ? nullptr : LedgerIfAvailable();
+    absl::Status unlink_status = UnlinkFiles(
+        spool_dir_, delete_names,
+        [ledger, &delete_sizes](const std::string& file_name) {
+          if (auto it = delete_sizes.find(file_name);
+              ledger && it != delete_sizes.end()) {
+            ledger->Subtract(it->second);
+          }
+        });
+    if (!unlink_status.ok() && status.ok()) {
+      status = unlink_status;
+    }
+    return status;
   }
 
   // Returns absl::NotFoundError in case the FsSpool is empty.
   absl::StatusOr<std::string> NextMessagePath() {
-    absl::StatusOr<std::string> file_path = OldestSpooledFile();
-    if (!file_path.ok()) {
-      return file_path;
+    if (absl::Status status = RefreshIndex(); !status.ok()) {
+      return status;
     }
-    unacked_messages_.insert(*file_path);
-    return file_path;
+    if (index_.empty()) {
+      return absl::NotFoundError("Empty FsSpool directory.");
+    }
+    return TakeOldest();
   }
 
   absl::StatusOr<absl::flat_hash_set<std::string>> BatchMessagePaths(
@@ -363,75 +500,169 @@ class FsSpoolReader {
     if (count == 0) {
       return batch;
     }
-    absl::Status status = IterateDirectory(
-        spool_dir_,
-        [this, count, &batch](const std::string& file_name, bool* stop) {
-          if (file_name == "." || file_name == "..") {
-            return;
-          }
-
-          std::string file_path =
-              absl::StrCat(spool_dir_, PathSeparator(), file_name);
-
-          if (unacked_messages_.contains(file_path)) {
-            return;
-          }
-
-          batch.insert(file_path);
-          unacked_messages_.insert(file_path);
-
-          if (batch.size() >= count) {
-            *stop = true;
-          }
-        });
+    if (absl::Status status = RefreshIndex(); !status.ok()) {
+      if (absl::IsNotFound(status)) {
+        // Nothing has been spooled yet.
+        return batch;
+      }
+      return status;
+    }
+    while (batch.size() < count && !index_.empty()) {
+      batch.insert(TakeOldest());
+    }
     return batch;
   }
 
   size_t NumberOfUnackedMessages() const { return unacked_messages_.size(); }
 
  private:
-  const std::string base_dir_;
-  const std::string spool_dir_;
-  absl::flat_hash_set<std::string> unacked_messages_;
+  // Spooled files are ordered by modification time, with ties broken by file
+  // name. Writers name files with their ID followed by a zero padded sequence
+  // number, so files from the same writer sort in the order they were written.
+  using IndexKey = std::pair<absl::Time, std::string>;
+
+  struct IndexEntry {
+    absl::Time mtime;
+    // Disk occupation charged to the spool size ledger by the writer.
+    size_t disk_size;
+    // Refresh generation in which the file was last seen in the spool
+    // directory. Used to drop entries for files removed by someone else.
+    uint64_t generation;
+  };
 
-  absl::StatusOr<std::string> OldestSpooledFile() {
-    if (!IsDirectory(spool_dir_)) {
+  absl::Status RefreshIndex() {
+    // Stat the directory before iterating it so that any change made during
+    // the iteration results in another refresh next time.
+    struct stat stats;
+    if (stat(spool_dir_.c_str(), &stats) < 0 || !StatIsDir(stats.st_mode)) {
       return absl::NotFoundError(
           "Spool directory is not a directory or it doesn't exist.");
     }
-    absl::Time oldest_file_mtime;
-    std::string oldest_file_path;
+
+    if (index_valid_ &&
+        stats.st_mtimespec.tv_sec == spool_dir_last_mtime_.tv_sec &&
+        stats.st_mtimespec.tv_nsec == spool_dir_last_mtime_.tv_nsec) {
+      return absl::OkStatus();
+    }
+
+    uint64_t generation = ++generation_;
     absl::Status status = IterateDirectory(
-        spool_dir_, [this, &oldest_file_path, &oldest_file_mtime](
-                        const std::string& file_name, bool* stop) {
-          std::string file_path =
-              absl::StrCat(spool_dir_, PathSeparator(), file_name);
-          struct stat stats;
-          if (stat(file_path.c_str(), &stats) < 0) {
+        spool_dir_,
+        [this, generation](const std::string& file_name, bool* stop) {
+          if (file_name == "." || file_name == "..") {
             return;
           }
-          if (!StatIsReg(stats.st_mode)) {
+          if (unacked_messages_.contains(file_name)) {
             return;
           }
-          if (unacked_messages_.contains(file_path)) {
+          if (auto it = pending_.find(file_name); it != pending_.end()) {
+            it->second.generation = generation;
             return;
           }
-          absl::Time file_mtime = absl::FromTimeT(stats.st_mtime);
-          if (!oldest_file_path.empty() && oldest_file_mtime < file_mtime) {
+
+          std::string file_path =
+              absl::StrCat(spool_dir_, PathSeparator(), file_name);
+          struct stat file_stats;
+          if (stat(file_path.c_str(), &file_stats) < 0) {
+            return;
+          }
+          if (!StatIsReg(file_stats.st_mode)) {
             return;
           }
-          oldest_file_path = file_path;
-          oldest_file_mtime = file_mtime;
+          absl::Time mtime = absl::TimeFromTimespec(file_stats.st_mtimespec);
+          pending_.emplace(
+              file_name,
+              IndexEntry{mtime, EstimateDiskOccupation(file_stats.st_size),
+                         generation});
+          index_.emplace(mtime, file_name);
         });
     if (!status.ok()) {
       return status;
     }
 
-    if (oldest_file_path.empty()) {
-      return absl::NotFoundError("Empty FsSpool directory.");
+    for (auto it = pending_.begin(); it != pending_.end();) {
+      if (it->second.generation != generation) {
+        index_.erase(IndexKey(it->second.mtime, it->first));
+        pending_.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+
+    spool_dir_last_mtime_ = stats.st_mtimespec;
+    index_valid_ = true;
+    return absl::OkStatus();
+  }
+
+  // Moves the oldest indexed file to the unacked set and returns its path.
+  std::string TakeOldest() {
+    auto node = index_.extract(index_.begin());
+    auto pending = pending_.find(node.value().second);
+    IndexEntry entry = pending->second;
+    pending_.erase(pending);
+    std::string file_path =
+        absl::StrCat(spool_dir_, PathSeparator(), node.value().second);
+    unacked_messages_.emplace(std::move(node.value().second), entry);
+    return file_path;
+  }
+
+  void AddToIndex(const std::string& file_name, IndexEntry entry) {
+    entry.generation = generation_;
+    pending_.emplace(file_name, entry);
+    index_.emplace(entry.mtime, file_name);
+  }
+
+  SpoolSizeLedger* LedgerIfAvailable() {
+    if (!ledger_open_attempted_) {
+      ledger_open_attempted_ = true;
+      absl::StatusOr<std::unique_ptr<SpoolSizeLedger>> ledger =
+          SpoolSizeLedger::Open(SpoolSizeLedgerPath(base_dir_));
+      if (ledger.ok()) {
+        ledger_ = *std::move(ledger);
+      }
+    }
+    return ledger_.get();
+  }
+
+  void RemoveFromIndex(const std::string& file_name) {
+    if (auto it = pending_.find(file_name); it != pending_.end()) {
+      index_.erase(IndexKey(it->second.mtime, it->first));
+      pending_.erase(it);
     }
-    return oldest_file_path;
   }
+
+  // Returns the name of the file within the spool directory for paths handed
+  // out by this reader.
+  std::optional<std::string> SpoolFileName(
+      absl::string_view message_path) const {
+    if (!absl::ConsumePrefix(&message_path, spool_dir_) ||
+        !absl::ConsumePrefix(&message_path, PathSeparator()) ||
+        message_path.empty() ||
+        absl::StrContains(message_path, PathSeparator())) {
+      return std::nullopt;
+    }
+    return std::string(message_path);
+  }
+
+  const std::string base_dir_;
+  const std::string spool_dir_;
+
+  // Files in the spool directory that have not yet been handed out, ordered
+  // oldest first, along with a lookup from file name to index entry.
+  absl::btree_set<IndexKey> index_;
+  absl::flat_hash_map<std::string, IndexEntry> pending_;
+
+  // Files that have been handed out but not yet acknowledged, along with
+  // their index entry so they can be re-indexed if acked without deletion.
+  absl::flat_hash_map<std::string, IndexEntry> unacked_messages_;
+
+  bool index_valid_ = false;
+  uint64_t generation_ = 0;
+  struct timespec spool_dir_last_mtime_;
+
+  // Discharged for every file this reader deletes.
+  std::unique_ptr<SpoolSizeLedger> ledger_;
+  bool ledger_open_attempted_ = false;
 };
 
 }  // namespace fsspool
@@ -15,11 +15,16 @@
 
 #include <dirent.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/fsspool_platform_specific.h"
 #include "absl/strings/match.h"
@@ -30,6 +35,7 @@ namespace fsspool {
 
 constexpr absl::string_view kSpoolDirName = "new";
 constexpr absl::string_view kTmpDirName = "tmp";
+constexpr absl::string_view kSizeLedgerName = "spool_size";
 
 absl::string_view PathSeparator() { return "/"; }
 
@@ -41,6 +47,10 @@ std::string SpoolTempDirectory(absl::string_view base_dir) {
   return absl::StrCat(base_dir, PathSeparator(), kTmpDirName);
 }
 
+std::string SpoolSizeLedgerPath(absl::string_view base_dir) {
+  return absl::StrCat(base_dir, PathSeparator(), kSizeLedgerName);
+}
+
 bool IsDirectory(const std::string& d) {
   struct stat stats;
   if (stat(d.c_str(), &stats) < 0) {
@@ -70,6 +80,29 @@ absl::Status WriteBuffer(int fd, absl::string_view msg) {
 
 int Unlink(const char* pathname) { return unlink(pathname); }
 
+absl::Status UnlinkFiles(const std::string& dir,
+                         const std::vector<std::string>& file_names,
+                         std::function<void(const std::string&)> removed) {
+  if (file_names.empty()) {
+    return absl::OkStatus();
+  }
+  int dir_fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (dir_fd < 0) {
+    return absl::ErrnoToStatus(errno, absl::StrCat("failed to open ", dir));
+  }
+  absl::Status status = absl::OkStatus();
+  for (const std::string& file_name : file_names) {
+    if (unlinkat(dir_fd, file_name.c_str(), 0) == 0) {
+      removed(file_name);
+    } else if (errno != ENOENT && status.ok()) {
+      status = absl::ErrnoToStatus(
+          errno, absl::StrCat("failed to remove ", file_name));
+    }
+  }
+  close(dir_fd);
+  return status;
+}
+
 int MkDir(const char* path, mode_t mode) { return mkdir(path, mode); }
 
 absl::Status MkDir(const std::string& path) {
@@ -161,4 +194,63 @@ absl::StatusOr<size_t> EstimateDirSize(const std::string& dir) {
   return status;
 }
 
+// The ledger is shared between processes through the mapping, which is only
+// safe if the counter is updated without a lock.
+static_assert(std::atomic_ref<uint64_t>::is_always_lock_free);
+
+absl::StatusOr<std::unique_ptr<SpoolSizeLedger>> SpoolSizeLedger::Open(
+    const std::string& path) {
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return absl::ErrnoToStatus(errno, absl::StrCat("failed to open ", path));
+  }
+
+  // Concurrent openers may both extend the file, which is harmless since the
+  // new bytes are zero filled.
+  struct stat stats;
+  if (fstat(fd, &stats) < 0 ||
+      (stats.st_size < static_cast<off_t>(sizeof(uint64_t)) &&
+       ftruncate(fd, sizeof(uint64_t)) < 0)) {
+    int err = errno;
+    close(fd);
+    return absl::ErrnoToStatus(err, absl::StrCat("failed to size ", path));
+  }
+
+  void* mapping = mmap(nullptr, sizeof(uint64_t), PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+  int err = errno;
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return absl::ErrnoToStatus(err, absl::StrCat("failed to map ", path));
+  }
+
+  return std::unique_ptr<SpoolSizeLedger>(
+      new SpoolSizeLedger(static_cast<uint64_t*>(mapping)));
+}
+
+SpoolSizeLedger::~SpoolSizeLedger() { munmap(counter_, sizeof(uint64_t)); }
+
+size_t SpoolSizeLedger::Size() const {
+  return std::atomic_ref<uint64_t>(*counter_).load(std::memory_order_relaxed);
+}
+
+void SpoolSizeLedger::Add(size_t bytes) {
+  std::atomic_ref<uint64_t>(*counter_).fetch_add(bytes,
+                                                 std::memory_order_relaxed);
+}
+
+void SpoolSizeLedger::Subtract(size_t bytes) {
+  std::atomic_ref<uint64_t> counter(*counter_);
+  uint64_t current = counter.load(std::memory_order_relaxed);
+  uint64_t desired;
+  do {
+    desired = current > bytes ? current - bytes : 0;
+  } while (!counter.compare_exchange_weak(current, desired,
+                                          std::memory_order_relaxed));
+}
+
+void SpoolSizeLedger::Reset(size_t bytes) {
+  std::atomic_ref<uint64_t>(*counter_).store(bytes, std::memory_order_relaxed);
+}
+
 }  // namespace fsspool
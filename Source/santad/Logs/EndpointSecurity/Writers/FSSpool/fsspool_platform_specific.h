@@ -16,9 +16,12 @@
 #ifndef SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_FSSPOOLPLATFORMSPECIFIC_H
 #define SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_FSSPOOLPLATFORMSPECIFIC_H
 
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -29,6 +32,7 @@ namespace fsspool {
 absl::string_view PathSeparator();
 std::string SpoolNewDirectory(absl::string_view base_dir);
 std::string SpoolTempDirectory(absl::string_view base_dir);
+std::string SpoolSizeLedgerPath(absl::string_view base_dir);
 bool IsAbsolutePath(absl::string_view path);
 bool IsDirectory(const std::string& d);
 int Close(int fd);
@@ -41,6 +45,14 @@ int MkDir(const char* path, mode_t mode);
 bool StatIsDir(mode_t mode);
 bool StatIsReg(mode_t mode);
 int Unlink(const char* pathname);
+// Removes each of the named files from `dir`. The directory is opened once and
+// entries are removed relative to it instead of resolving every full path.
+// The callback is invoked for each file that was removed. Files that no longer
+// exist are not an error. All removals are attempted and the first failure, if
+// any, is returned.
+absl::Status UnlinkFiles(const std::string& dir,
+                         const std::vector<std::string>& file_names,
+                         std::function<void(const std::string&)> removed);
 int Write(int fd, absl::string_view buf);
 // Writes a buffer to the given file descriptor.
 // Calls to write can result in a partially written file. Very rare cases in
@@ -54,8 +66,39 @@ absl::Status IterateDirectory(
     const std::string& dir,
     std::function<void(const std::string&, bool*)> callback);
 
+// Rounds a file size up to the disk space it is expected to occupy.
+size_t EstimateDiskOccupation(size_t fileSize);
+
 absl::StatusOr<size_t> EstimateDirSize(const std::string& dir);
 
+// Tracks the estimated disk occupation of a spool directory in a small file
+// shared by every writer and reader of the spool. The counter is memory mapped
+// and updated atomically so that checking the spool size doesn't require
+// walking the spool directory.
+class SpoolSizeLedger {
+ public:
+  // Opens the ledger at the given path, creating it with a size of zero if it
+  // doesn't exist.
+  static absl::StatusOr<std::unique_ptr<SpoolSizeLedger>> Open(
+      const std::string& path);
+
+  ~SpoolSizeLedger();
+
+  SpoolSizeLedger(const SpoolSizeLedger&) = delete;
+  SpoolSizeLedger& operator=(const SpoolSizeLedger&) = delete;
+
+  size_t Size() const;
+  void Add(size_t bytes);
+  // Saturates at zero.
+  void Subtract(size_t bytes);
+  void Reset(size_t bytes);
+
+ private:
+  explicit SpoolSizeLedger(uint64_t* counter) : counter_(counter) {}
+
+  uint64_t* counter_;
+};
+
 }  // namespace fsspool
 
 #endif  // SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_FSSPOOL_FSSPOOLPLATFORMSPECIFIC_H
@@ -18,7 +18,10 @@
 #import <XCTest/XCTest.h>
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "Source/common/TestUtils.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
@@ -480,4 +483,149 @@ google::protobuf::Any TestAnyTimestamp(int64_t s, int32_t n) {
   XCTAssertNil(err);
 }
 
+- (void)testReaderOrderAndAck {
+  static const int kNumberOfFiles = 5;
+  auto writer = std::make_unique<FsSpoolWriterPeer<fsspool::AnyBatcher>>(
+      fsspool::AnyBatcher(), [self.baseDir UTF8String], kSpoolSize);
+  fsspool::FsSpoolReader reader([self.baseDir UTF8String]);
+
+  // Nothing has been spooled yet
+  XCTAssertTrue(absl::IsNotFound(reader.NextMessagePath().status()));
+  absl::StatusOr<absl::flat_hash_set<std::string>> batch = reader.BatchMessagePaths(1);
+  XCTAssertStatusOk(batch);
+  XCTAssertEqual(batch->size(), 0);
+
+  for (int i = 0; i < kNumberOfFiles; i++) {
+    XCTAssertStatusOk(writer->Write({123}));
+    XCTAssertStatusOk(writer->Flush());
+  }
+
+  // Files from a single writer are handed out in the order they were written
+  std::vector<std::string> paths;
+  for (int i = 0; i < kNumberOfFiles; i++) {
+    absl::StatusOr<std::string> path = reader.NextMessagePath();
+    XCTAssertStatusOk(path);
+    paths.push_back(*path);
+  }
+  XCTAssertTrue(std::is_sorted(paths.begin(), paths.end()));
+  XCTAssertTrue(absl::IsNotFound(reader.NextMessagePath().status()));
+  XCTAssertEqual(reader.NumberOfUnackedMessages(), kNumberOfFiles);
+
+  // Delete all but the first file, which should then be handed out again
+  absl::flat_hash_map<std::string, bool> acks;
+  for (int i = 0; i < kNumberOfFiles; i++) {
+    acks[paths[i]] = (i != 0);
+  }
+  XCTAssertStatusOk(reader.AckMessages(acks));
+  XCTAssertEqual(reader.NumberOfUnackedMessages(), 0);
+
+  NSError *err = nil;
+  XCTAssertEqual([[self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:&err] count], 1);
+  XCTAssertNil(err);
+
+  batch = reader.BatchMessagePaths(kNumberOfFiles);
+  XCTAssertStatusOk(batch);
+  XCTAssertEqual(batch->size(), 1);
+  XCTAssertTrue(batch->contains(paths[0]));
+}
+
+- (void)testReaderRefresh {
+  auto writer = std::make_unique<FsSpoolWriterPeer<fsspool::AnyBatcher>>(
+      fsspool::AnyBatcher(), [self.baseDir UTF8String], kSpoolSize);
+  fsspool::FsSpoolReader reader([self.baseDir UTF8String]);
+
+  XCTAssertStatusOk(writer->Write({123}));
+  XCTAssertStatusOk(writer->Flush());
+
+  absl::StatusOr<std::string> first = reader.NextMessagePath();
+  XCTAssertStatusOk(first);
+
+  // Files written after the index was built are picked up
+  XCTAssertStatusOk(writer->Write({123}));
+  XCTAssertStatusOk(writer->Flush());
+  XCTAssertStatusOk(writer->Write({123}));
+  XCTAssertStatusOk(writer->Flush());
+
+  absl::StatusOr<std::string> second = reader.NextMessagePath();
+  XCTAssertStatusOk(second);
+  XCTAssertNotEqual(*first, *second);
+
+  // Files removed out from under the reader are dropped from the index
+  NSError *err = nil;
+  for (NSString *file in [self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:&err]) {
+    NSString *path = [NSString stringWithFormat:@"%@/%@", self.spoolDir, file];
+    if (path.UTF8String != *first && path.UTF8String != *second) {
+      XCTAssertTrue([self.fileMgr removeItemAtPath:path error:nil]);
+    }
+  }
+  XCTAssertNil(err);
+  XCTAssertTrue(absl::IsNotFound(reader.NextMessagePath().status()));
+
+  XCTAssertStatusOk(reader.AckMessage(*first, true));
+  XCTAssertStatusOk(reader.AckMessage(*second, true));
+  XCTAssertEqual(reader.NumberOfUnackedMessages(), 0);
+  XCTAssertEqual([[self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:&err] count], 0);
+  XCTAssertNil(err);
+}
+
+- (void)testSpoolSizeLedger {
+  XCTAssertTrue([self.fileMgr createDirectoryAtPath:self.baseDir
+                        withIntermediateDirectories:YES
+                                         attributes:nil
+                                              error:nil]);
+  std::string path = fsspool::SpoolSizeLedgerPath([self.baseDir UTF8String]);
+
+  auto ledger1 = fsspool::SpoolSizeLedger::Open(path);
+  auto ledger2 = fsspool::SpoolSizeLedger::Open(path);
+  XCTAssertStatusOk(ledger1);
+  XCTAssertStatusOk(ledger2);
+
+  // Updates through one ledger are visible through the other
+  XCTAssertEqual((*ledger1)->Size(), 0);
+  (*ledger1)->Add(100);
+  XCTAssertEqual((*ledger2)->Size(), 100);
+
+  // Subtraction saturates at zero
+  (*ledger2)->Subtract(300);
+  XCTAssertEqual((*ledger1)->Size(), 0);
+
+  (*ledger2)->Reset(42);
+  XCTAssertEqual((*ledger1)->Size(), 42);
+}
+
+- (void)testSpoolSizeLedgerTracksWritesAndAcks {
+  static const size_t kFileDiskSize = 4096;
+  auto writer = std::make_unique<FsSpoolWriterPeer<fsspool::AnyBatcher>>(
+      fsspool::AnyBatcher(), [self.baseDir UTF8String], 2 * kFileDiskSize);
+  fsspool::FsSpoolReader reader([self.baseDir UTF8String]);
+
+  for (int i = 0; i < 3; i++) {
+    XCTAssertStatusOk(writer->Write({123}));
+    XCTAssertStatusOk(writer->Flush());
+  }
+
+  auto ledger = fsspool::SpoolSizeLedger::Open(
+      fsspool::SpoolSizeLedgerPath([self.baseDir UTF8String]));
+  XCTAssertStatusOk(ledger);
+  XCTAssertEqual((*ledger)->Size(), 3 * kFileDiskSize);
+
+  // The spool is full
+  XCTAssertStatusOk(writer->Write({123}));
+  XCTAssertStatusNotOk(writer->Flush());
+
+  // Deleting files through the reader frees up space
+  absl::StatusOr<absl::flat_hash_set<std::string>> batch = reader.BatchMessagePaths(2);
+  XCTAssertStatusOk(batch);
+  absl::flat_hash_map<std::string, bool> acks;
+  for (const std::string &path : *batch) {
+    acks[path] = true;
+  }
+  XCTAssertStatusOk(reader.AckMessages(acks));
+  XCTAssertEqual((*ledger)->Size(), kFileDiskSize);
+
+  XCTAssertStatusOk(writer->Write({123}));
+  XCTAssertStatusOk(writer->Flush());
+  XCTAssertEqual((*ledger)->Size(), 2 * kFileDiskSize);
+}
+
 @end
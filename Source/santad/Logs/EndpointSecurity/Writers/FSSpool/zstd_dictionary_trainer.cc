@@ -0,0 +1,550 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+// Trains a zstd dictionary from existing protobuf stream spool files and
+// benchmarks it against dictionary-less compression.
+//
+// Spool files may be uncompressed or zstd compressed streams. Zstd files that
+// were compressed with a previous dictionary are decoded when that dictionary
+// is given with --dictionary. Each framed record in the stream is used as a
+// training sample, since that is the unit repeated throughout a spool file.
+//
+// A fraction of the input files is held out of training and used to report
+// the compression ratio and CPU time with and without the new dictionary, and
+// with string table encoding instead of a dictionary.
+//
+// Usage: zstd_dictionary_trainer --output=PATH [--dict_id=N] [--max_size=N]
+//                                [--level=N] [--holdout=F] [--seed=N]
+//                                [--dictionary=PATH] SPOOL_PATH...
+//
+// Dictionary IDs identify the dictionary version in every spool file that
+// uses it, and should be unique per trained dictionary.
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Source/common/SNTXxhash.h"
+#include "Source/common/santa_proto_include_wrapper.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StringTable.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdDictionary.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "google/protobuf/io/coded_stream.h"
+
+#define ZDICT_STATIC_LINKING_ONLY
+#include "zdict.h"
+#include "zstd.h"
+
+namespace fsspool {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Zstd reserves IDs below this value for dictionaries registered with the
+// project, and IDs at or above 2^31.
+static constexpr uint32_t kMinDictionaryID = 32768;
+static constexpr uint32_t kMaxDictionaryID = (1u << 31) - 1;
+
+// Zstd recommends training on roughly 100x the target dictionary size.
+static constexpr size_t kSampleBytesPerDictionaryByte = 100;
+
+static constexpr uint32_t kZstdFrameMagic = 0xFD2FB528;
+
+struct Options {
+  std::string output_path;
+  std::string dictionary_path;
+  std::vector<std::string> inputs;
+  uint32_t dict_id = 0;
+  size_t max_size = 112640;  // The zstd CLI default
+  int level = ZSTD_CLEVEL_DEFAULT;
+  double holdout = 0.1;
+  uint64_t seed = 42;
+};
+
+bool ParseOptions(int argc, char **argv, Options &opts) {
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg(argv[i]);
+    if (arg.substr(0, 2) != "--") {
+      opts.inputs.emplace_back(arg);
+      continue;
+    }
+
+    size_t eq = arg.find('=');
+    if (eq == std::string_view::npos) {
+      return false;
+    }
+    std::string_view key = arg.substr(2, eq - 2);
+    std::string value(arg.substr(eq + 1));
+
+    if (key == "output") {
+      opts.output_path = value;
+    } else if (key == "dictionary") {
+      opts.dictionary_path = value;
+    } else if (key == "dict_id") {
+      opts.dict_id = static_cast<uint32_t>(std::stoul(value));
+    } else if (key == "max_size") {
+      opts.max_size = std::max<size_t>(std::stoull(value), 1024);
+    } else if (key == "level") {
+      opts.level = std::stoi(value);
+    } else if (key == "holdout") {
+      opts.holdout = std::clamp(std::stod(value), 0.0, 0.9);
+    } else if (key == "seed") {
+      opts.seed = std::stoull(value);
+    } else {
+      return false;
+    }
+  }
+
+  if (opts.dict_id != 0 &&
+      (opts.dict_id < kMinDictionaryID || opts.dict_id > kMaxDictionaryID)) {
+    fprintf(stderr, "--dict_id must be in [%u, %u]\n", kMinDictionaryID,
+            kMaxDictionaryID);
+    return false;
+  }
+
+  return !opts.output_path.empty() && !opts.inputs.empty();
+}
+
+std::vector<std::string> CollectFiles(const std::vector<std::string> &inputs) {
+  std::vector<std::string> files;
+  for (const std::string &input : inputs) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(input, ec)) {
+      files.push_back(input);
+      continue;
+    }
+    for (const auto &entry :
+         std::filesystem::recursive_directory_iterator(input, ec)) {
+      if (entry.is_regular_file()) {
+        files.push_back(entry.path().string());
+      }
+    }
+  }
+  // Directory iteration order is unspecified, sort so that runs with the same
+  // seed select the same holdout files.
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+absl::StatusOr<std::string> ReadFile(const std::string &path) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f) {
+    return absl::NotFoundError("Unable to open file");
+  }
+  return std::string(std::istreambuf_iterator<char>(f),
+                     std::istreambuf_iterator<char>());
+}
+
+absl::StatusOr<std::string> Decompress(const std::string &compressed,
+                                       const ZstdDictionary *dictionary) {
+  uint32_t dict_id =
+      ZSTD_getDictID_fromFrame(compressed.data(), compressed.size());
+  if (dict_id != 0 && (!dictionary || dictionary->ID() != dict_id)) {
+    return absl::FailedPreconditionError(
+        absl::StrFormat("Requires zstd dictionary %u", dict_id));
+  }
+
+  std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> dctx(ZSTD_createDCtx(),
+                                                            ZSTD_freeDCtx);
+  if (dict_id != 0) {
+    ZSTD_DCtx_refDDict(dctx.get(), dictionary->DDict());
+  }
+
+  // Spool files are written as a stream, so frames don't record their
+  // decompressed size. Seekable spool files hold multiple frames followed by a
+  // skippable index frame, which the decoder passes over.
+  std::string out;
+  std::vector<char> buf(ZSTD_DStreamOutSize());
+  ZSTD_inBuffer input = {compressed.data(), compressed.size(), 0};
+  while (true) {
+    ZSTD_outBuffer output = {buf.data(), buf.size(), 0};
+    size_t ret = ZSTD_decompressStream(dctx.get(), &output, &input);
+    if (ZSTD_isError(ret)) {
+      return absl::InternalError(ZSTD_getErrorName(ret));
+    }
+    out.append(buf.data(), output.pos);
+    // Output remaining below capacity means everything decodable was flushed
+    if (input.pos == input.size && output.pos < output.size) {
+      break;
+    }
+  }
+  return out;
+}
+
+// Returns the uncompressed stream batcher contents of a spool file.
+absl::StatusOr<std::string> DecodeSpoolFile(const std::string &path,
+                                            const ZstdDictionary *dictionary) {
+  absl::StatusOr<std::string> contents = ReadFile(path);
+  if (!contents.ok()) {
+    return contents.status();
+  }
+
+  uint32_t magic = 0;
+  if (contents->size() < sizeof(magic)) {
+    return absl::InvalidArgumentError("File too small");
+  }
+  memcpy(&magic, contents->data(), sizeof(magic));
+
+  if (magic == kStreamBatcherMagic) {
+    return contents;
+  } else if (magic == kZstdFrameMagic) {
+    return Decompress(*contents, dictionary);
+  } else {
+    return absl::InvalidArgumentError("Not a stream or zstd spool file");
+  }
+}
+
+// Appends the framed records of a stream to the samples. Each record consists
+// of the stream magic, hash, length and serialized message.
+absl::Status AppendSamples(const std::string &stream, std::string &samples,
+                           std::vector<size_t> &sample_sizes) {
+  google::protobuf::io::CodedInputStream input(
+      reinterpret_cast<const uint8_t *>(stream.data()),
+      static_cast<int>(stream.size()));
+
+  while (true) {
+    int start = input.CurrentPosition();
+    uint32_t magic;
+    if (!input.ReadLittleEndian32(&magic)) {
+      return absl::OkStatus();
+    }
+
+    uint32_t length;
+    if (magic != kStreamBatcherMagic || !input.Skip(sizeof(uint64_t)) ||
+        !input.ReadVarint32(&length) || !input.Skip(length)) {
+      return absl::DataLossError("Malformed record");
+    }
+
+    int end = input.CurrentPosition();
+    samples.append(stream, start, end - start);
+    sample_sizes.push_back(end - start);
+  }
+}
+
+struct BenchResult {
+  size_t input_bytes = 0;
+  size_t compressed_bytes = 0;
+  double compress_secs = 0;
+  double decompress_secs = 0;
+};
+
+// Compresses and decompresses each stream as a whole, as it would be spooled.
+BenchResult Bench(const std::vector<std::string> &streams, int level,
+                  const ZstdDictionary *dictionary) {
+  BenchResult result;
+  std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> cctx(ZSTD_createCCtx(),
+                                                            ZSTD_freeCCtx);
+  std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> dctx(ZSTD_createDCtx(),
+                                                            ZSTD_freeDCtx);
+  std::vector<char> compressed;
+  std::vector<char> decompressed;
+
+  for (const std::string &stream : streams) {
+    compressed.resize(ZSTD_compressBound(stream.size()));
+    decompressed.resize(stream.size());
+
+    Clock::time_point start = Clock::now();
+    size_t size =
+        dictionary
+            ? ZSTD_compress_usingCDict(cctx.get(), compressed.data(),
+                                       compressed.size(), stream.data(),
+                                       stream.size(), dictionary->CDict())
+            : ZSTD_compressCCtx(cctx.get(), compressed.data(),
+                                compressed.size(), stream.data(),
+                                stream.size(), level);
+    Clock::time_point mid = Clock::now();
+    size_t decompressed_size =
+        dictionary ? ZSTD_decompress_usingDDict(
+                         dctx.get(), decompressed.data(), decompressed.size(),
+                         compressed.data(), size, dictionary->DDict())
+                   : ZSTD_decompressDCtx(dctx.get(), decompressed.data(),
+                                         decompressed.size(), compressed.data(),
+                                         size);
+    Clock::time_point end = Clock::now();
+
+    if (ZSTD_isError(size) || ZSTD_isError(decompressed_size) ||
+        decompressed_size != stream.size()) {
+      fprintf(stderr, "Benchmark round trip failed\n");
+      exit(EXIT_FAILURE);
+    }
+
+    result.input_bytes += stream.size();
+    result.compressed_bytes += size;
+    result.compress_secs += std::chrono::duration<double>(mid - start).count();
+    result.decompress_secs += std::chrono::duration<double>(end - mid).count();
+  }
+  return result;
+}
+
+// Calls the function with the serialized message of each record of a stream.
+template <typename F>
+absl::Status ForEachRecord(const std::string &stream, F &&f) {
+  google::protobuf::io::CodedInputStream input(
+      reinterpret_cast<const uint8_t *>(stream.data()),
+      static_cast<int>(stream.size()));
+
+  while (true) {
+    uint32_t magic;
+    if (!input.ReadLittleEndian32(&magic)) {
+      return absl::OkStatus();
+    }
+
+    uint32_t length;
+    if (magic != kStreamBatcherMagic || !input.Skip(sizeof(uint64_t)) ||
+        !input.ReadVarint32(&length)) {
+      return absl::DataLossError("Malformed record");
+    }
+
+    int start = input.CurrentPosition();
+    if (!input.Skip(length)) {
+      return absl::DataLossError("Malformed record");
+    }
+    f(absl::Span<const uint8_t>(
+        reinterpret_cast<const uint8_t *>(stream.data()) + start, length));
+  }
+}
+
+// Appends a record framed the same way as the stream batcher.
+void AppendRecord(absl::Span<const uint8_t> bytes, std::string &stream) {
+  uint32_t magic = kStreamBatcherMagic;
+  stream.append(reinterpret_cast<const char *>(&magic), sizeof(magic));
+
+  santa::Xxhash64 hash;
+  hash.Update(bytes.data(), bytes.size());
+  hash.Digest([&](const uint8_t *buf, size_t length) {
+    stream.append(reinterpret_cast<const char *>(buf), length);
+  });
+
+  uint8_t length[5];
+  uint8_t *end = google::protobuf::io::CodedOutputStream::WriteVarint32ToArray(
+      static_cast<uint32_t>(bytes.size()), length);
+  stream.append(reinterpret_cast<const char *>(length), end - length);
+  stream.append(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+}
+
+// Like Bench, but string table encodes each stream before compressing it, as
+// the StringTableBatcher would, and decodes it again after decompressing it.
+BenchResult BenchStringTable(const std::vector<std::string> &streams,
+                             int level) {
+  StringTableEncoder encoder(::santa::pb::v1::SantaMessage::descriptor());
+  StringTableDecoder decoder(::santa::pb::v1::SantaMessage::descriptor());
+  std::vector<std::string> encoded_streams;
+  std::string buf;
+  double encode_secs = 0;
+  double decode_secs = 0;
+
+  for (const std::string &stream : streams) {
+    Clock::time_point start = Clock::now();
+    encoder.Reset();
+    std::string &encoded = encoded_streams.emplace_back();
+    const std::string &marker = StringTableMarker();
+    AppendRecord(absl::Span<const uint8_t>(
+                     reinterpret_cast<const uint8_t *>(marker.data()),
+                     marker.size()),
+                 encoded);
+    absl::Status status = ForEachRecord(stream, [&](auto record) {
+      if (encoder.Encode(record, buf).ok()) {
+        record = absl::Span<const uint8_t>(
+            reinterpret_cast<const uint8_t *>(buf.data()), buf.size());
+      }
+      AppendRecord(record, encoded);
+    });
+    encode_secs += std::chrono::duration<double>(Clock::now() - start).count();
+    if (!status.ok()) {
+      fprintf(stderr, "Benchmark encoding failed: %s\n",
+              status.ToString().c_str());
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  BenchResult result = Bench(encoded_streams, level, nullptr);
+
+  for (const std::string &stream : encoded_streams) {
+    Clock::time_point start = Clock::now();
+    absl::Status status = ForEachRecord(stream, [&](auto record) {
+      if (IsStringTableMarker(record)) {
+        decoder.Reset();
+      } else if (!decoder.Decode(record, buf).ok()) {
+        fprintf(stderr, "Benchmark decoding failed\n");
+        exit(EXIT_FAILURE);
+      }
+    });
+    decode_secs += std::chrono::duration<double>(Clock::now() - start).count();
+    if (!status.ok()) {
+      fprintf(stderr, "Benchmark decoding failed: %s\n",
+              status.ToString().c_str());
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // Report against the size of the original streams
+  result.input_bytes = 0;
+  for (const std::string &stream : streams) {
+    result.input_bytes += stream.size();
+  }
+  result.compress_secs += encode_secs;
+  result.decompress_secs += decode_secs;
+  return result;
+}
+
+void PrintBenchResult(const char *name, const BenchResult &result) {
+  double mb = result.input_bytes / (1024.0 * 1024.0);
+  printf("%-14s ratio=%.2f compress=%.1fMB/s decompress=%.1fMB/s\n", name,
+         result.compressed_bytes
+             ? static_cast<double>(result.input_bytes) / result.compressed_bytes
+             : 0.0,
+         result.compress_secs > 0 ? mb / result.compress_secs : 0.0,
+         result.decompress_secs > 0 ? mb / result.decompress_secs : 0.0);
+}
+
+}  // namespace
+}  // namespace fsspool
+
+int main(int argc, char **argv) {
+  using namespace fsspool;
+
+  Options opts;
+  if (!ParseOptions(argc, argv, opts)) {
+    fprintf(stderr,
+            "Usage: %s --output=PATH [--dict_id=N] [--max_size=N] [--level=N] "
+            "[--holdout=F] [--seed=N] [--dictionary=PATH] SPOOL_PATH...\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::shared_ptr<ZstdDictionary> previous;
+  if (!opts.dictionary_path.empty()) {
+    auto loaded = ZstdDictionary::Load(opts.dictionary_path, opts.level);
+    if (!loaded.ok()) {
+      fprintf(stderr, "%s\n", loaded.status().ToString().c_str());
+      return EXIT_FAILURE;
+    }
+    previous = *std::move(loaded);
+  }
+
+  std::vector<std::string> files = CollectFiles(opts.inputs);
+  std::mt19937_64 rng(opts.seed);
+  std::shuffle(files.begin(), files.end(), rng);
+
+  // Hold out files rather than records so that the benchmark sees complete
+  // spool files, compressed as a single stream.
+  size_t holdout_count =
+      files.size() > 1 ? static_cast<size_t>(files.size() * opts.holdout) : 0;
+  size_t max_sample_bytes = opts.max_size * kSampleBytesPerDictionaryByte;
+
+  std::string samples;
+  std::vector<size_t> sample_sizes;
+  std::vector<std::string> holdout_streams;
+  size_t skipped = 0;
+
+  for (size_t i = 0; i < files.size(); i++) {
+    bool is_holdout = i < holdout_count;
+    if (!is_holdout && samples.size() >= max_sample_bytes) {
+      continue;
+    }
+
+    absl::StatusOr<std::string> stream =
+        DecodeSpoolFile(files[i], previous.get());
+    if (!stream.ok()) {
+      fprintf(stderr, "Skipping %s: %s\n", files[i].c_str(),
+              stream.status().ToString().c_str());
+      skipped++;
+      continue;
+    }
+
+    if (is_holdout) {
+      holdout_streams.push_back(*std::move(stream));
+    } else if (absl::Status s = AppendSamples(*stream, samples, sample_sizes);
+               !s.ok()) {
+      fprintf(stderr, "Truncated samples from %s: %s\n", files[i].c_str(),
+              s.ToString().c_str());
+    }
+  }
+
+  printf("files: %zu (%zu held out, %zu skipped)\n", files.size(),
+         holdout_streams.size(), skipped);
+  printf("samples: %zu records, %zu bytes\n", sample_sizes.size(),
+         samples.size());
+
+  if (sample_sizes.empty()) {
+    fprintf(stderr, "No samples to train on\n");
+    return EXIT_FAILURE;
+  }
+
+  ZDICT_fastCover_params_t params = {};
+  params.d = 8;
+  params.steps = 4;
+  params.zParams.compressionLevel = opts.level;
+  params.zParams.dictID = opts.dict_id;
+
+  std::string dict(opts.max_size, '\0');
+  Clock::time_point train_start = Clock::now();
+  size_t dict_size = ZDICT_optimizeTrainFromBuffer_fastCover(
+      dict.data(), dict.size(), samples.data(), sample_sizes.data(),
+      static_cast<unsigned>(sample_sizes.size()), &params);
+  if (ZDICT_isError(dict_size)) {
+    fprintf(stderr, "Training failed: %s\n", ZDICT_getErrorName(dict_size));
+    return EXIT_FAILURE;
+  }
+  dict.resize(dict_size);
+  double train_secs =
+      std::chrono::duration<double>(Clock::now() - train_start).count();
+
+  auto dictionary = ZstdDictionary::Create(dict, opts.level);
+  if (!dictionary.ok()) {
+    fprintf(stderr, "%s\n", dictionary.status().ToString().c_str());
+    return EXIT_FAILURE;
+  }
+
+  std::ofstream out(opts.output_path, std::ios::binary);
+  if (!out.write(dict.data(), dict.size())) {
+    fprintf(stderr, "Failed to write dictionary: %s\n",
+            opts.output_path.c_str());
+    return EXIT_FAILURE;
+  }
+  out.close();
+
+  printf("dictionary: id=%u size=%zu trained in %.3fs -> %s\n",
+         (*dictionary)->ID(), dict.size(), train_secs,
+         opts.output_path.c_str());
+
+  if (holdout_streams.empty()) {
+    printf("No held out files, skipping benchmark\n");
+    return EXIT_SUCCESS;
+  }
+
+  PrintBenchResult("no dictionary:", Bench(holdout_streams, opts.level,
+                                           nullptr));
+  PrintBenchResult("dictionary:", Bench(holdout_streams, opts.level,
+                                        dictionary->get()));
+  PrintBenchResult("string table:",
+                   BenchStringTable(holdout_streams, opts.level));
+
+  return EXIT_SUCCESS;
+}
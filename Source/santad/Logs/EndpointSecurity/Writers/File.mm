@@ -15,8 +15,10 @@
 #include "Source/santad/Logs/EndpointSecurity/Writers/File.h"
 
 #include <memory>
+#include <utility>
 
 #include "Source/common/BranchPrediction.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/RecordBufferPool.h"
 
 namespace santa {
 
@@ -102,6 +104,7 @@ void File::Write(std::vector<uint8_t> &&bytes) {
     std::vector<uint8_t> moved_bytes = std::move(temp_bytes);
 
     shared_this->CopyDataSerialized(moved_bytes);
+    RecordBufferPool::Shared().Release(std::move(moved_bytes));
 
     if (shared_this->ShouldFlush()) {
       shared_this->FlushSerialized();
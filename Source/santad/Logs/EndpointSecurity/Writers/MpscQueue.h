@@ -0,0 +1,127 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_MPSCQUEUE_H
+#define SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_MPSCQUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace santa {
+
+// A bounded, lock-free, multi-producer single-consumer queue. Producers claim
+// a slot with a single CAS on the enqueue position, and each slot carries a
+// sequence number that tells the consumer when the slot has been published.
+//
+// Any number of threads may call TryPush concurrently. TryPop must only be
+// called from one thread at a time.
+template <typename T>
+class MpscQueue {
+ public:
+  // The capacity is rounded up to a power of two.
+  explicit MpscQueue(size_t capacity)
+      : capacity_(std::bit_ceil(std::max<size_t>(capacity, 2))),
+        mask_(capacity_ - 1),
+        cells_(std::make_unique<Cell[]>(capacity_)) {
+    for (size_t i = 0; i < capacity_; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpscQueue(const MpscQueue &) = delete;
+  MpscQueue &operator=(const MpscQueue &) = delete;
+
+  // Enqueues the value unless the queue already holds `limit` or more
+  // elements, in which case the value is left untouched and false is
+  // returned. The limit is checked against an approximate size, so it is a
+  // soft limit below capacity; the capacity itself is always a hard limit.
+  bool TryPush(T &&value, size_t limit) {
+    if (limit < capacity_ && SizeApprox() >= limit) {
+      return false;
+    }
+
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // The consumer hasn't yet freed this slot from the previous lap.
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->value = std::move(value);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPush(T &&value) { return TryPush(std::move(value), capacity_); }
+
+  bool TryPop(T &value) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell &cell = cells_[pos & mask_];
+    size_t seq = cell.sequence.load(std::memory_order_acquire);
+    if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1) < 0) {
+      return false;
+    }
+
+    value = std::move(cell.value);
+    cell.sequence.store(pos + capacity_, std::memory_order_release);
+    dequeue_pos_.store(pos + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Number of elements claimed by producers and not yet popped. This may
+  // momentarily include elements still being published.
+  size_t SizeApprox() const {
+    size_t enqueued = enqueue_pos_.load(std::memory_order_relaxed);
+    size_t dequeued = dequeue_pos_.load(std::memory_order_relaxed);
+    return enqueued > dequeued ? enqueued - dequeued : 0;
+  }
+
+  size_t Capacity() const { return capacity_; }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+
+  // Producers and the consumer update these from different threads, keep them
+  // on separate cache lines.
+  alignas(64) std::atomic<size_t> enqueue_pos_{0};
+  alignas(64) std::atomic<size_t> dequeue_pos_{0};
+};
+
+}  // namespace santa
+
+#endif
@@ -0,0 +1,120 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import <XCTest/XCTest.h>
+#include <dispatch/dispatch.h>
+
+#include <atomic>
+#include <vector>
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/MpscQueue.h"
+
+using santa::MpscQueue;
+
+@interface MpscQueueTest : XCTestCase
+@end
+
+@implementation MpscQueueTest
+
+- (void)testCapacity {
+  XCTAssertEqual(MpscQueue<int>(1).Capacity(), 2);
+  XCTAssertEqual(MpscQueue<int>(5).Capacity(), 8);
+  XCTAssertEqual(MpscQueue<int>(8).Capacity(), 8);
+}
+
+- (void)testPushPop {
+  MpscQueue<int> queue(4);
+  int value;
+
+  XCTAssertFalse(queue.TryPop(value));
+
+  for (int i = 0; i < 4; i++) {
+    XCTAssertTrue(queue.TryPush(int(i)));
+  }
+  XCTAssertEqual(queue.SizeApprox(), 4);
+
+  // The queue is full
+  XCTAssertFalse(queue.TryPush(100));
+
+  // Elements come out in order and slots are reused once freed
+  for (int lap = 0; lap < 3; lap++) {
+    for (int i = 0; i < 4; i++) {
+      XCTAssertTrue(queue.TryPop(value));
+      XCTAssertEqual(value, lap * 4 + i);
+      XCTAssertTrue(queue.TryPush((lap + 1) * 4 + i));
+    }
+  }
+  XCTAssertEqual(queue.SizeApprox(), 4);
+}
+
+- (void)testPushLimit {
+  MpscQueue<int> queue(8);
+
+  for (int i = 0; i < 6; i++) {
+    XCTAssertTrue(queue.TryPush(int(i), 6));
+  }
+
+  // Pushes honoring the lower limit fail, while others still succeed
+  XCTAssertFalse(queue.TryPush(6, 6));
+  XCTAssertTrue(queue.TryPush(6));
+  XCTAssertTrue(queue.TryPush(7));
+  XCTAssertFalse(queue.TryPush(8));
+}
+
+- (void)testConcurrentProducers {
+  static constexpr int kProducers = 8;
+  static constexpr int kPerProducer = 10000;
+  MpscQueue<int> queue(1024);
+  MpscQueue<int> *queuePtr = &queue;
+
+  std::atomic<bool> producersDone = false;
+  std::atomic<bool> *producersDonePtr = &producersDone;
+  std::vector<int> seen(kProducers * kPerProducer, 0);
+  std::vector<int> *seenPtr = &seen;
+
+  dispatch_semaphore_t consumerDone = dispatch_semaphore_create(0);
+  dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+    int value;
+    while (true) {
+      if (queuePtr->TryPop(value)) {
+        (*seenPtr)[value]++;
+      } else if (producersDonePtr->load()) {
+        // Pick up anything published after the last failed pop
+        while (queuePtr->TryPop(value)) {
+          (*seenPtr)[value]++;
+        }
+        break;
+      }
+    }
+    dispatch_semaphore_signal(consumerDone);
+  });
+
+  dispatch_apply(kProducers, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t p) {
+    for (int i = 0; i < kPerProducer; i++) {
+      while (!queuePtr->TryPush(int(p) * kPerProducer + i)) {
+      }
+    }
+  });
+  producersDone.store(true);
+
+  XCTAssertEqual(0, dispatch_semaphore_wait(consumerDone,
+                                            dispatch_time(DISPATCH_TIME_NOW, 30 * NSEC_PER_SEC)));
+
+  // Every element was received exactly once
+  for (int count : seen) {
+    XCTAssertEqual(count, 1);
+  }
+}
+
+@end
@@ -14,6 +14,10 @@
 
 #include "Source/santad/Logs/EndpointSecurity/Writers/Null.h"
 
+#include <utility>
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/RecordBufferPool.h"
+
 namespace santa {
 
 std::shared_ptr<Null> Null::Create() {
@@ -21,7 +25,8 @@ std::shared_ptr<Null> Null::Create() {
 }
 
 void Null::Write(std::vector<uint8_t> &&bytes) {
-  // Intentionally do nothing
+  // Intentionally do nothing other than recycle the buffer
+  RecordBufferPool::Shared().Release(std::move(bytes));
 }
 
 void Null::Flush() {
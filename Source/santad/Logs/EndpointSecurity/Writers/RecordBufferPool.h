@@ -0,0 +1,72 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#ifndef SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_RECORDBUFFERPOOL_H
+#define SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_RECORDBUFFERPOOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa {
+
+// A free list of serialized record buffers. Serializers acquire a buffer for
+// each record and writers release it back once the record has been consumed,
+// so that steady state logging reuses buffers instead of allocating one per
+// event.
+class RecordBufferPool {
+ public:
+  static constexpr size_t kDefaultMaxBuffers = 256;
+  // Buffers grown beyond this capacity by unusually large records are freed
+  // instead of being retained by the pool.
+  static constexpr size_t kDefaultMaxBufferCapacity = 64 * 1024;
+
+  // The pool shared by the serializers and writers.
+  static RecordBufferPool &Shared();
+
+  RecordBufferPool(size_t max_buffers = kDefaultMaxBuffers,
+                   size_t max_buffer_capacity = kDefaultMaxBufferCapacity);
+
+  RecordBufferPool(const RecordBufferPool &) = delete;
+  RecordBufferPool &operator=(const RecordBufferPool &) = delete;
+
+  // Returns a buffer containing `size` bytes.
+  std::vector<uint8_t> Acquire(size_t size);
+  void Release(std::vector<uint8_t> buffer);
+
+  struct Stats {
+    // Number of Acquire calls satisfied without allocating.
+    uint64_t reused;
+    // Number of Acquire calls that allocated a new buffer.
+    uint64_t allocated;
+  };
+  Stats GetStats() const;
+
+ private:
+  const size_t max_buffers_;
+  const size_t max_buffer_capacity_;
+
+  absl::Mutex mtx_;
+  std::vector<std::vector<uint8_t>> free_ ABSL_GUARDED_BY(mtx_);
+
+  std::atomic<uint64_t> reused_{0};
+  std::atomic<uint64_t> allocated_{0};
+};
+
+}  // namespace santa
+
+#endif
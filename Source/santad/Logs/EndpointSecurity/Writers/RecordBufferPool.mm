@@ -0,0 +1,70 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/RecordBufferPool.h"
+
+#include <utility>
+
+namespace santa {
+
+RecordBufferPool &RecordBufferPool::Shared() {
+  static auto *pool = new RecordBufferPool();
+  return *pool;
+}
+
+RecordBufferPool::RecordBufferPool(size_t max_buffers, size_t max_buffer_capacity)
+    : max_buffers_(max_buffers), max_buffer_capacity_(max_buffer_capacity) {
+  free_.reserve(max_buffers_);
+}
+
+std::vector<uint8_t> RecordBufferPool::Acquire(size_t size) {
+  std::vector<uint8_t> buffer;
+  {
+    absl::MutexLock lock(&mtx_);
+    if (!free_.empty()) {
+      buffer = std::move(free_.back());
+      free_.pop_back();
+    }
+  }
+
+  if (buffer.capacity() >= size) {
+    reused_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    allocated_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  buffer.resize(size);
+  return buffer;
+}
+
+void RecordBufferPool::Release(std::vector<uint8_t> buffer) {
+  if (buffer.capacity() == 0 || buffer.capacity() > max_buffer_capacity_) {
+    return;
+  }
+  buffer.clear();
+
+  absl::MutexLock lock(&mtx_);
+  if (free_.size() < max_buffers_) {
+    free_.push_back(std::move(buffer));
+  }
+}
+
+RecordBufferPool::Stats RecordBufferPool::GetStats() const {
+  return Stats{
+      .reused = reused_.load(std::memory_order_relaxed),
+      .allocated = allocated_.load(std::memory_order_relaxed),
+  };
+}
+
+}  // namespace santa
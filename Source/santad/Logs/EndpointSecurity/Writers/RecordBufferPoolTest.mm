@@ -0,0 +1,86 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/RecordBufferPool.h"
+
+using santa::RecordBufferPool;
+
+@interface RecordBufferPoolTest : XCTestCase
+@end
+
+@implementation RecordBufferPoolTest
+
+- (void)testAcquireReusesReleasedBuffers {
+  static constexpr int kNumRecords = 1000;
+  RecordBufferPool pool;
+
+  // Simulate the serialize -> write -> release cycle of the logging path with
+  // records no larger than the first and ensure only the first allocates.
+  for (int i = 0; i < kNumRecords; i++) {
+    std::vector<uint8_t> buffer = pool.Acquire(200 - (i % 100));
+    XCTAssertEqual(buffer.size(), 200 - (i % 100));
+    pool.Release(std::move(buffer));
+  }
+
+  RecordBufferPool::Stats stats = pool.GetStats();
+  XCTAssertEqual(stats.allocated, 1);
+  XCTAssertEqual(stats.reused, kNumRecords - 1);
+}
+
+- (void)testAcquireReturnsBufferOfRequestedSize {
+  RecordBufferPool pool;
+
+  std::vector<uint8_t> buffer = pool.Acquire(16);
+  std::fill(buffer.begin(), buffer.end(), 'A');
+  const uint8_t *data = buffer.data();
+  pool.Release(std::move(buffer));
+
+  buffer = pool.Acquire(8);
+  XCTAssertEqual(buffer.size(), 8);
+  XCTAssertEqual(buffer.data(), data);
+
+  // Growing beyond the capacity of the pooled buffer counts as an allocation
+  pool.Release(std::move(buffer));
+  buffer = pool.Acquire(1024);
+  XCTAssertEqual(buffer.size(), 1024);
+  XCTAssertEqual(pool.GetStats().allocated, 2);
+}
+
+- (void)testReleaseLimits {
+  RecordBufferPool pool(2, 64);
+
+  // Oversized buffers are not retained
+  pool.Release(std::vector<uint8_t>(128));
+  std::vector<uint8_t> buffer = pool.Acquire(1);
+  XCTAssertEqual(pool.GetStats().allocated, 1);
+
+  // At most max_buffers are retained
+  pool.Release(std::vector<uint8_t>(8));
+  pool.Release(std::vector<uint8_t>(8));
+  pool.Release(std::vector<uint8_t>(8));
+  for (int i = 0; i < 3; i++) {
+    buffer = pool.Acquire(8);
+  }
+  RecordBufferPool::Stats stats = pool.GetStats();
+  XCTAssertEqual(stats.reused, 2);
+  XCTAssertEqual(stats.allocated, 2);
+}
+
+@end
@@ -18,7 +18,13 @@
 
 #import <Foundation/Foundation.h>
 #include <dispatch/dispatch.h>
+#include <unistd.h>
 
+#include <array>
+#include <atomic>
+#include <bit>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
@@ -26,8 +32,11 @@
 #include <vector>
 
 #import "Source/common/SNTLogging.h"
+#include "Source/common/TelemetryEventMap.h"
 #include "Source/common/santa_proto_include_wrapper.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/fsspool.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/MpscQueue.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/RecordBufferPool.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/Writer.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
@@ -42,21 +51,75 @@ class SpoolPeer;
 
 namespace santa {
 
+// What a producer does when the spool's record queue is full.
+enum class QueueFullPolicy {
+  // Drop the new record.
+  kDrop,
+  // Wait for the queue to drain.
+  kBlock,
+  // Shed records in priority order under pressure. Each priority has a share
+  // of the queue beyond which its records are dropped, with high priority
+  // records dropped only when the queue is completely full. Likewise, when
+  // spool files can't be completed, or the spool is out of space, lower
+  // priority records are dropped first.
+  kDropLowPriority,
+};
+
+// Under pressure, records are shed starting with the lowest priority.
+enum class RecordPriority {
+  kLow,
+  kNormal,
+  kHigh,
+};
+
+inline constexpr size_t kRecordPriorityCount = 3;
+
+// Process lifecycle events are the most voluminous and of the least value on
+// their own, while executions and policy and security verdicts are kept for as
+// long as possible.
+inline RecordPriority TelemetryEventDropPriority(TelemetryEvent event) {
+  switch (event) {
+    case TelemetryEvent::kFork:
+    case TelemetryEvent::kExit:
+    case TelemetryEvent::kClose: return RecordPriority::kLow;
+    case TelemetryEvent::kExecution:
+    case TelemetryEvent::kFileAccess:
+    case TelemetryEvent::kCodesigningInvalidated:
+    case TelemetryEvent::kGatekeeperOverride:
+    case TelemetryEvent::kLaunchItem:
+    case TelemetryEvent::kTCCModification:
+    case TelemetryEvent::kXProtect: return RecordPriority::kHigh;
+    default: return RecordPriority::kNormal;
+  }
+}
+
+struct SpoolQueueOptions {
+  static constexpr size_t kDefaultCapacity = 65536;
+
+  size_t capacity = kDefaultCapacity;
+  QueueFullPolicy full_policy = QueueFullPolicy::kDrop;
+  // Called on the spool's queue with the number of records waiting to be
+  // written, once per batch of records written.
+  std::function<void(size_t depth, size_t capacity)> backlog_observer;
+};
+
 template <::fsspool::BatcherInterface T>
 class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
  public:
   // Factory
   static std::shared_ptr<Spool<T>> Create(T batcher, std::string_view base_dir,
                                           size_t max_spool_disk_size, size_t max_spool_batch_size,
-                                          uint64_t flush_timeout_ms) {
+                                          uint64_t flush_timeout_ms,
+                                          SpoolQueueOptions queue_options = {}) {
     dispatch_queue_t q = dispatch_queue_create("com.northpolesec.santa.daemon.file_base_q",
                                                DISPATCH_QUEUE_SERIAL_WITH_AUTORELEASE_POOL);
     dispatch_source_t timer_source = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, q);
     dispatch_source_set_timer(timer_source, dispatch_time(DISPATCH_TIME_NOW, 0),
                               NSEC_PER_MSEC * flush_timeout_ms, 0);
 
-    auto spool_writer = std::make_shared<Spool<T>>(q, timer_source, std::move(batcher), base_dir,
-                                                   max_spool_disk_size, max_spool_batch_size);
+    auto spool_writer =
+        std::make_shared<Spool<T>>(q, timer_source, std::move(batcher), base_dir,
+                                   max_spool_disk_size, max_spool_batch_size, queue_options);
 
     spool_writer->BeginFlushTask();
 
@@ -65,7 +128,8 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
 
   Spool(dispatch_queue_t q, dispatch_source_t timer_source, T batcher, std::string_view base_dir,
         size_t max_spool_disk_size, size_t max_spool_file_size,
-        void (^write_complete_f)(void) = nullptr, void (^flush_task_complete_f)(void) = nullptr)
+        SpoolQueueOptions queue_options = {}, void (^write_complete_f)(void) = nullptr,
+        void (^flush_task_complete_f)(void) = nullptr)
       : q_(q),
         timer_source_(timer_source),
         spool_reader_(absl::string_view(base_dir.data(), base_dir.length())),
@@ -75,7 +139,17 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
         spool_file_size_threshold_leniency_(spool_file_size_threshold_ *
                                             spool_file_size_threshold_leniency_factor_),
         write_complete_f_(write_complete_f),
-        flush_task_complete_f_(flush_task_complete_f) {}
+        flush_task_complete_f_(flush_task_complete_f),
+        queue_(queue_options.capacity),
+        queue_full_policy_(queue_options.full_policy),
+        queue_limits_(QueueLimits(queue_.Capacity(), queue_full_policy_)),
+        spool_file_limits_({
+            spool_file_size_threshold_,
+            (spool_file_size_threshold_ + spool_file_size_threshold_leniency_) / 2,
+            spool_file_size_threshold_leniency_,
+        }),
+        deferred_budgets_({0, spool_file_size_threshold_ / 8, spool_file_size_threshold_ / 2}),
+        backlog_observer_(std::move(queue_options.backlog_observer)) {}
 
   ~Spool() {
     // Note: `log_batch_writer_` is automatically flushed when destroyed
@@ -89,49 +163,50 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
   }
 
   void Write(std::vector<uint8_t> &&bytes) override {
-    auto shared_this = this->shared_from_this();
-
-    // Workaround to move `bytes` into the block without a copy
-    __block std::vector<uint8_t> temp_bytes = std::move(bytes);
-
-    dispatch_async(q_, ^{
-      std::vector<uint8_t> moved_bytes = std::move(temp_bytes);
-
-      if (shared_this->accumulated_bytes_ >= shared_this->spool_file_size_threshold_) {
-        shared_this->FlushSerialized();
-      }
+    WriteEvent(std::move(bytes), TelemetryEvent::kNone);
+  }
 
-      // Only write the new message if we have room left.
-      // This will account for Flush failing above.
-      // Use the more lenient threshold here in case the Flush failures are transitory.
-      if (shared_this->accumulated_bytes_ < shared_this->spool_file_size_threshold_leniency_) {
-        size_t bytes_written = moved_bytes.size();
-        auto status = shared_this->spool_writer_.Write(std::move(moved_bytes));
-        if (!status.ok()) {
-          if (absl::IsDataLoss(status)) {
-            // Nop for now. We haven't historically logged on drops as that would
-            // spam the console when the spool is filled and that isn't very useful.
-            // There will be periodic messages that the spool is full.
-          } else {
-            LOGE(@"Failed to log event: %s", status.ToString().c_str());
-          }
-        } else {
-          shared_this->accumulated_bytes_ += bytes_written;
-        }
+  // Records are queued and written to the spool in batches on the spool's
+  // serial queue. A drain is only scheduled when one isn't already pending, so
+  // producers don't pay for a dispatch per record.
+  void WriteEvent(std::vector<uint8_t> &&bytes, TelemetryEvent event) override {
+    Record record{std::move(bytes), event, TelemetryEventDropPriority(event)};
+    size_t limit = queue_limits_[static_cast<size_t>(record.priority)];
+
+    while (!queue_.TryPush(std::move(record), limit)) {
+      if (queue_full_policy_ != QueueFullPolicy::kBlock) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        DropRecord(record);
+        return;
       }
+      ScheduleDrain();
+      usleep(kBlockedWriteBackoffUsec);
+    }
 
-      if (shared_this->write_complete_f_) {
-        shared_this->write_complete_f_();
-      }
-    });
+    ScheduleDrain();
   }
 
   void Flush() override {
     dispatch_sync(q_, ^{
+      DrainSerialized();
       FlushSerialized();
     });
   }
 
+  std::optional<Writer::Stats> GetStats() override {
+    Writer::Stats stats{
+        .queue_depth = queue_.SizeApprox(),
+        .dropped = dropped_.load(std::memory_order_relaxed),
+    };
+    for (size_t i = 0; i < dropped_by_event_.size(); i++) {
+      if (uint64_t dropped = dropped_by_event_[i].load(std::memory_order_relaxed); dropped > 0) {
+        stats.dropped_by_event[i < 64 ? static_cast<TelemetryEvent>(1ULL << i)
+                                      : TelemetryEvent::kNone] = dropped;
+      }
+    }
+    return stats;
+  }
+
   std::optional<absl::flat_hash_set<std::string>> GetFilesToExport(size_t max_count) override {
     __block absl::StatusOr<absl::flat_hash_set<std::string>> paths;
     dispatch_sync(q_, ^{
@@ -152,10 +227,8 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
 
   void FilesExported(absl::flat_hash_map<std::string, bool> files_exported) override {
     dispatch_async(q_, ^{
-      for (const auto &file_exported : files_exported) {
-        if (!spool_reader_.AckMessage(file_exported.first, file_exported.second).ok()) {
-          LOGW(@"Unable to delete exported file.");
-        }
+      if (!spool_reader_.AckMessages(files_exported).ok()) {
+        LOGW(@"Unable to delete exported files.");
       }
     });
   }
@@ -172,6 +245,7 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
         return;
       }
 
+      shared_writer->DrainSerialized();
       if (!shared_writer->FlushSerialized()) {
         LOGE(@"Spool writer: periodic flush failed.");
       }
@@ -189,6 +263,162 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
   friend class santa::SpoolPeer<T>;
 
  private:
+  struct Record {
+    std::vector<uint8_t> bytes;
+    TelemetryEvent event;
+    RecordPriority priority;
+  };
+
+  static std::array<size_t, kRecordPriorityCount> QueueLimits(size_t capacity,
+                                                              QueueFullPolicy policy) {
+    if (policy != QueueFullPolicy::kDropLowPriority) {
+      return {capacity, capacity, capacity};
+    }
+    return {capacity - capacity / 4, capacity - capacity / 8, capacity};
+  }
+
+  // Counts the record as dropped and hands its buffer back to the serializer.
+  void DropRecord(Record &record) {
+    uint64_t event = static_cast<uint64_t>(record.event);
+    size_t slot = std::has_single_bit(event) ? std::countr_zero(event) : 64;
+    dropped_by_event_[slot].fetch_add(1, std::memory_order_relaxed);
+    RecordBufferPool::Shared().Release(std::move(record.bytes));
+  }
+
+  bool ShedsByPriority() const {
+    return queue_full_policy_ == QueueFullPolicy::kDropLowPriority;
+  }
+
+  void ScheduleDrain() {
+    // The exchange pairs with the one in DrainSerialized so that a record
+    // pushed while a drain is in progress is either seen by that drain or
+    // results in a new one being scheduled.
+    if (drain_scheduled_.exchange(true, std::memory_order_acq_rel)) {
+      return;
+    }
+    auto shared_this = this->shared_from_this();
+    dispatch_async(q_, ^{
+      shared_this->DrainSerialized();
+    });
+  }
+
+  // IMPORTANT: Not thread safe, must be called on q_.
+  void DrainSerialized() {
+    drain_scheduled_.exchange(false, std::memory_order_acq_rel);
+
+    Record record;
+    size_t batch_count;
+    size_t batches = 0;
+    do {
+      // Only check whether the current spool file should be completed once
+      // per batch of records.
+      if (accumulated_bytes_ >= spool_file_size_threshold_) {
+        FlushSerialized();
+      }
+
+      if (backlog_observer_) {
+        backlog_observer_(queue_.SizeApprox(), queue_.Capacity());
+      }
+
+      // The current spool file couldn't be completed, so lower priority records
+      // are given less of the leniency margin.
+      bool under_pressure = ShedsByPriority() && accumulated_bytes_ >= spool_file_size_threshold_;
+
+      WriteDeferredSerialized();
+
+      for (batch_count = 0; batch_count < kMaxDrainBatchSize && queue_.TryPop(record);
+           batch_count++) {
+        // Only write the new record if we have room left.
+        // This will account for Flush failing above.
+        // Use the more lenient threshold here in case the Flush failures are transitory.
+        size_t limit = under_pressure ? spool_file_limits_[static_cast<size_t>(record.priority)]
+                                      : spool_file_size_threshold_leniency_;
+        if (accumulated_bytes_ < limit) {
+          size_t bytes_written = record.bytes.size();
+          auto status = spool_writer_.Write(record.bytes);
+          if (!status.ok()) {
+            if (absl::IsDataLoss(status)) {
+              // Nop for now. We haven't historically logged on drops as that would
+              // spam the console when the spool is filled and that isn't very useful.
+              // There will be periodic messages that the spool is full.
+            } else {
+              LOGE(@"Failed to log event: %s", status.ToString().c_str());
+            }
+
+            if (!DeferSerialized(record, status)) {
+              DropRecord(record);
+            }
+          } else {
+            accumulated_bytes_ += bytes_written;
+
+            // The batcher has consumed the record, hand the buffer back to be reused
+            // by the serializer.
+            RecordBufferPool::Shared().Release(std::move(record.bytes));
+          }
+        } else {
+          DropRecord(record);
+        }
+
+        if (write_complete_f_) {
+          write_complete_f_();
+        }
+      }
+    } while (batch_count == kMaxDrainBatchSize && ++batches < kMaxDrainBatchesPerBlock);
+
+    // Records may remain. Rather than holding q_ for as long as producers keep
+    // up, continue in a new block so that Flush and export, which wait on q_,
+    // get a turn in between.
+    if (batch_count == kMaxDrainBatchSize) {
+      ScheduleDrain();
+    }
+  }
+
+  // Holds on to higher priority records that couldn't be written because the
+  // spool is out of space, up to each priority's budget, so they can be
+  // written once exported files free up space. Returns false if the record
+  // should be dropped instead.
+  //
+  // IMPORTANT: Not thread safe, must be called on q_.
+  bool DeferSerialized(Record &record, const absl::Status &status) {
+    if (!ShedsByPriority() || !(absl::IsResourceExhausted(status) || absl::IsDataLoss(status))) {
+      return false;
+    }
+
+    size_t priority = static_cast<size_t>(record.priority);
+    if (deferred_bytes_[priority] + record.bytes.size() > deferred_budgets_[priority]) {
+      return false;
+    }
+
+    deferred_bytes_[priority] += record.bytes.size();
+    deferred_.push_back(std::move(record));
+    return true;
+  }
+
+  // Retries deferred records, oldest first, stopping while the spool is still
+  // out of space.
+  //
+  // IMPORTANT: Not thread safe, must be called on q_.
+  void WriteDeferredSerialized() {
+    while (!deferred_.empty() && accumulated_bytes_ < spool_file_size_threshold_leniency_) {
+      Record &record = deferred_.front();
+      size_t bytes_written = record.bytes.size();
+      absl::Status status = spool_writer_.Write(record.bytes);
+      if (absl::IsResourceExhausted(status) || absl::IsDataLoss(status)) {
+        return;
+      }
+
+      deferred_bytes_[static_cast<size_t>(record.priority)] -= bytes_written;
+      if (status.ok()) {
+        accumulated_bytes_ += bytes_written;
+        RecordBufferPool::Shared().Release(std::move(record.bytes));
+      } else {
+        LOGE(@"Failed to log event: %s", status.ToString().c_str());
+        DropRecord(record);
+      }
+      deferred_.pop_front();
+    }
+  }
+
   bool FlushSerialized() {
     if (spool_writer_.Flush().ok()) {
       accumulated_bytes_ = 0;
@@ -212,6 +442,28 @@ class Spool : public Writer, public std::enable_shared_from_this<Spool<T>> {
   void (^flush_task_complete_f_)(void);
 
   size_t accumulated_bytes_ = 0;
+
+  static constexpr size_t kMaxDrainBatchSize = 256;
+  static constexpr size_t kMaxDrainBatchesPerBlock = 16;
+  static constexpr useconds_t kBlockedWriteBackoffUsec = 100;
+
+  MpscQueue<Record> queue_;
+  const QueueFullPolicy queue_full_policy_;
+  // Queue depth beyond which records of each priority are dropped.
+  const std::array<size_t, kRecordPriorityCount> queue_limits_;
+  // Size of the current spool file beyond which records of each priority are
+  // dropped while it can't be completed, when shedding by priority.
+  const std::array<size_t, kRecordPriorityCount> spool_file_limits_;
+  // Bytes of records of each priority held while the spool is out of space.
+  const std::array<size_t, kRecordPriorityCount> deferred_budgets_;
+  std::array<size_t, kRecordPriorityCount> deferred_bytes_ = {};
+  std::deque<Record> deferred_;
+  std::function<void(size_t, size_t)> backlog_observer_;
+  std::atomic<bool> drain_scheduled_ = false;
+  std::atomic<uint64_t> dropped_ = 0;
+  // Drops by the bit index of the record's telemetry event, with a final slot
+  // for records without a single event.
+  std::array<std::atomic<uint64_t>, 65> dropped_by_event_ = {};
 };
 
 }  // namespace santa
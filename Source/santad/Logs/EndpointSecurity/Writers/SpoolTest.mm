@@ -18,7 +18,10 @@
 #include <dispatch/dispatch.h>
 #include <unistd.h>
 #include <memory>
+#include <optional>
+#include <vector>
 
+#include "Source/common/TelemetryEventMap.h"
 #include "Source/common/TestUtils.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/AnyBatcher.h"
 #include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/StreamBatcher.h"
@@ -31,12 +34,16 @@ template <typename T>
 class SpoolPeer : public Spool<T> {
  public:
   using Spool<T>::FlushSerialized;
+  using Spool<T>::kMaxDrainBatchSize;
+  using Spool<T>::kMaxDrainBatchesPerBlock;
   using Spool<T>::Spool;
 };
 
 }  // namespace santa
 
+using santa::QueueFullPolicy;
 using santa::SpoolPeer;
+using santa::TelemetryEvent;
 
 @interface SpoolTest : XCTestCase
 @property dispatch_queue_t q;
@@ -91,7 +98,7 @@ using santa::SpoolPeer;
   __block int flushCount = 0;
 
   auto spool = std::make_shared<SpoolPeer<::fsspool::AnyBatcher>>(
-      self.q, self.timer, ::fsspool::AnyBatcher(), [self.baseDir UTF8String], 10240, 1024,
+      self.q, self.timer, ::fsspool::AnyBatcher(), [self.baseDir UTF8String], 10240, 1024, {},
       ^{
         dispatch_semaphore_signal(semaWrite);
       },
@@ -155,7 +162,7 @@ using santa::SpoolPeer;
 
   auto spool = std::make_shared<SpoolPeer<::fsspool::UncompressedStreamBatcher>>(
       self.q, self.timer, ::fsspool::UncompressedStreamBatcher(), [self.baseDir UTF8String], 10240,
-      1024,
+      1024, {},
       ^{
         dispatch_semaphore_signal(semaWrite);
       },
@@ -208,4 +215,189 @@ using santa::SpoolPeer;
   XCTAssertEqual([[self.fileMgr contentsOfDirectoryAtPath:self.spoolDir error:&err] count], 2);
 }
 
+- (void)testDropQueueFull {
+  __block int writes = 0;
+  auto spool = std::make_shared<SpoolPeer<::fsspool::UncompressedStreamBatcher>>(
+      self.q, self.timer, ::fsspool::UncompressedStreamBatcher(), [self.baseDir UTF8String], 10240,
+      1024, santa::SpoolQueueOptions{.capacity = 4, .full_policy = QueueFullPolicy::kDrop}, ^{
+        writes++;
+      });
+
+  // Keep the queue from draining while it is filled
+  dispatch_suspend(self.q);
+
+  // Records beyond the capacity are dropped, whatever their priority
+  for (int i = 0; i < 5; i++) {
+    spool->WriteEvent(std::vector<uint8_t>(50, 'A'), TelemetryEvent::kFork);
+  }
+  spool->WriteEvent(std::vector<uint8_t>(50, 'B'), TelemetryEvent::kExecution);
+
+  std::optional<santa::Writer::Stats> stats = spool->GetStats();
+  XCTAssertTrue(stats.has_value());
+  XCTAssertEqual(stats->queue_depth, 4);
+  XCTAssertEqual(stats->dropped, 2);
+  XCTAssertEqual(stats->dropped_by_event.size(), 2);
+  XCTAssertEqual(stats->dropped_by_event[TelemetryEvent::kFork], 1);
+  XCTAssertEqual(stats->dropped_by_event[TelemetryEvent::kExecution], 1);
+
+  dispatch_resume(self.q);
+  spool->Flush();
+  XCTAssertEqual(writes, 4);
+  XCTAssertEqual(spool->GetStats()->queue_depth, 0);
+  XCTAssertEqual(spool->GetStats()->dropped, 2);
+}
+
+- (void)testBlockQueueFull {
+  __block int writes = 0;
+  auto spool = std::make_shared<SpoolPeer<::fsspool::UncompressedStreamBatcher>>(
+      self.q, self.timer, ::fsspool::UncompressedStreamBatcher(), [self.baseDir UTF8String], 10240,
+      1024, santa::SpoolQueueOptions{.capacity = 2, .full_policy = QueueFullPolicy::kBlock}, ^{
+        writes++;
+      });
+
+  // Keep the queue from draining while it is filled
+  dispatch_suspend(self.q);
+
+  spool->Write(std::vector<uint8_t>(50, 'A'));
+  spool->Write(std::vector<uint8_t>(50, 'A'));
+
+  // A write to the full queue waits for room rather than dropping the record
+  dispatch_semaphore_t sema = dispatch_semaphore_create(0);
+  dispatch_async(dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+    spool->Write(std::vector<uint8_t>(50, 'B'));
+    dispatch_semaphore_signal(sema);
+  });
+  XCTAssertSemaFalseTimeout(sema, 1, "Write to a full queue should have blocked");
+  XCTAssertEqual(spool->GetStats()->queue_depth, 2);
+  XCTAssertEqual(spool->GetStats()->dropped, 0);
+
+  // Once the queue drains, the blocked write completes
+  dispatch_resume(self.q);
+  XCTAssertSemaTrue(sema, 5, "Blocked write didn't complete once the queue drained");
+
+  spool->Flush();
+  XCTAssertEqual(writes, 3);
+  XCTAssertEqual(spool->GetStats()->queue_depth, 0);
+  XCTAssertEqual(spool->GetStats()->dropped, 0);
+}
+
+- (void)testDrainCoalescing {
+  std::vector<size_t> depths;
+  auto spool = std::make_shared<SpoolPeer<::fsspool::UncompressedStreamBatcher>>(
+      self.q, self.timer, ::fsspool::UncompressedStreamBatcher(), [self.baseDir UTF8String], 10240,
+      1024, santa::SpoolQueueOptions{.backlog_observer = [&depths](size_t depth, size_t capacity) {
+                                       depths.push_back(depth);
+                                     }});
+
+  dispatch_suspend(self.q);
+  for (int i = 0; i < 10; i++) {
+    spool->Write(std::vector<uint8_t>(50, 'A'));
+  }
+  dispatch_resume(self.q);
+  dispatch_sync(self.q, ^{});
+
+  // Records written while a drain is pending are picked up by that drain,
+  // which observes the backlog once per batch
+  XCTAssertEqual(depths.size(), 1);
+  XCTAssertEqual(depths[0], 10);
+}
+
+- (void)testDrainYieldsQueue {
+  using Peer = SpoolPeer<::fsspool::UncompressedStreamBatcher>;
+  const size_t perBlock = Peer::kMaxDrainBatchSize * Peer::kMaxDrainBatchesPerBlock;
+  const size_t total = perBlock + Peer::kMaxDrainBatchSize / 2;
+
+  __block size_t writes = 0;
+  auto spool = std::make_shared<Peer>(self.q, self.timer, ::fsspool::UncompressedStreamBatcher(),
+                                      [self.baseDir UTF8String], 1024 * 1024, 64 * 1024,
+                                      santa::SpoolQueueOptions{}, ^{
+                                        writes++;
+                                      });
+
+  dispatch_suspend(self.q);
+  for (size_t i = 0; i < total; i++) {
+    spool->Write(std::vector<uint8_t>(1, 'A'));
+  }
+
+  // Work queued behind the pending drain runs once a bounded number of batches
+  // are written, before the drain continues.
+  __block size_t writesBeforeYield = 0;
+  dispatch_async(self.q, ^{
+    writesBeforeYield = writes;
+  });
+  dispatch_resume(self.q);
+
+  spool->Flush();
+  XCTAssertEqual(writesBeforeYield, perBlock);
+  XCTAssertEqual(writes, total);
+}
+
+- (void)testDropLowPriorityQueue {
+  auto spool = std::make_shared<SpoolPeer<::fsspool::UncompressedStreamBatcher>>(
+      self.q, self.timer, ::fsspool::UncompressedStreamBatcher(), [self.baseDir UTF8String], 10240,
+      1024,
+      santa::SpoolQueueOptions{.capacity = 8, .full_policy = QueueFullPolicy::kDropLowPriority});
+
+  // Keep the queue from draining while it is filled
+  dispatch_suspend(self.q);
+
+  // Low priority records get 6 of the 8 slots, normal priority records 7
+  for (int i = 0; i < 8; i++) {
+    spool->WriteEvent(std::vector<uint8_t>(50, 'A'), TelemetryEvent::kFork);
+  }
+  spool->WriteEvent(std::vector<uint8_t>(50, 'B'), TelemetryEvent::kRename);
+  spool->WriteEvent(std::vector<uint8_t>(50, 'B'), TelemetryEvent::kRename);
+  spool->WriteEvent(std::vector<uint8_t>(50, 'C'), TelemetryEvent::kExecution);
+  spool->WriteEvent(std::vector<uint8_t>(50, 'C'), TelemetryEvent::kExecution);
+
+  std::optional<santa::Writer::Stats> stats = spool->GetStats();
+  XCTAssertTrue(stats.has_value());
+  XCTAssertEqual(stats->queue_depth, 8);
+  XCTAssertEqual(stats->dropped, 4);
+  XCTAssertEqual(stats->dropped_by_event.size(), 3);
+  XCTAssertEqual(stats->dropped_by_event[TelemetryEvent::kFork], 2);
+  XCTAssertEqual(stats->dropped_by_event[TelemetryEvent::kRename], 1);
+  XCTAssertEqual(stats->dropped_by_event[TelemetryEvent::kExecution], 1);
+
+  dispatch_resume(self.q);
+  spool->Flush();
+  XCTAssertEqual(spool->GetStats()->queue_depth, 0);
+}
+
+- (void)testDropLowPrioritySpoolFull {
+  // Fill the spool beyond its max size
+  XCTAssertTrue([self.fileMgr createDirectoryAtPath:self.spoolDir
+                        withIntermediateDirectories:YES
+                                         attributes:nil
+                                              error:nil]);
+  XCTAssertTrue([self.fileMgr
+      createFileAtPath:[self.spoolDir stringByAppendingPathComponent:@"full"]
+              contents:[NSMutableData dataWithLength:64 * 1024]
+            attributes:nil]);
+
+  auto spool = std::make_shared<SpoolPeer<::fsspool::UncompressedStreamBatcher>>(
+      self.q, self.timer, ::fsspool::UncompressedStreamBatcher(), [self.baseDir UTF8String], 10240,
+      1024, santa::SpoolQueueOptions{.full_policy = QueueFullPolicy::kDropLowPriority});
+
+  // Execution records are held while the spool is full, others are dropped
+  spool->WriteEvent(std::vector<uint8_t>(50, 'A'), TelemetryEvent::kFork);
+  spool->WriteEvent(std::vector<uint8_t>(50, 'B'), TelemetryEvent::kExecution);
+  spool->WriteEvent(std::vector<uint8_t>(50, 'C'), TelemetryEvent::kClose);
+  spool->Flush();
+
+  std::optional<santa::Writer::Stats> stats = spool->GetStats();
+  XCTAssertTrue(stats.has_value());
+  XCTAssertEqual(stats->dropped, 0);
+  XCTAssertEqual(stats->dropped_by_event.size(), 2);
+  XCTAssertEqual(stats->dropped_by_event[TelemetryEvent::kFork], 1);
+  XCTAssertEqual(stats->dropped_by_event[TelemetryEvent::kClose], 1);
+
+  // Records beyond the high priority budget are dropped
+  for (int i = 0; i < 20; i++) {
+    spool->WriteEvent(std::vector<uint8_t>(50, 'D'), TelemetryEvent::kExecution);
+  }
+  spool->Flush();
+  XCTAssertEqual(spool->GetStats()->dropped_by_event[TelemetryEvent::kExecution], 11);
+}
+
 @end
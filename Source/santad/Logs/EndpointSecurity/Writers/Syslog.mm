@@ -16,6 +16,10 @@
 
 #include <os/log.h>
 
+#include <utility>
+
+#include "Source/santad/Logs/EndpointSecurity/Writers/RecordBufferPool.h"
+
 namespace santa {
 
 // Max length of data that should be displayed in a single line.
@@ -29,6 +33,7 @@ std::shared_ptr<Syslog> Syslog::Create() {
 
 void Syslog::Write(std::vector<uint8_t> &&bytes) {
   os_log(OS_LOG_DEFAULT, "%{public}.*s", (int)std::min(kMaxLineLength, bytes.size()), bytes.data());
+  RecordBufferPool::Shared().Release(std::move(bytes));
 }
 
 void Syslog::Flush() {
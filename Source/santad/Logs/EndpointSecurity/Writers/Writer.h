@@ -16,10 +16,12 @@
 #ifndef SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_WRITER_H
 #define SANTA__SANTAD__LOGS_ENDPOINTSECURITY_WRITERS_WRITER_H
 
+#include <cstdint>
 #include <optional>
 #include <utility>
 #include <vector>
 
+#include "Source/common/TelemetryEventMap.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 
@@ -32,6 +34,12 @@ class Writer {
   virtual void Write(std::vector<uint8_t> &&bytes) = 0;
   virtual void Flush() = 0;
 
+  // Writes a record of the given telemetry event. Writers that shed load use
+  // the event to decide which records are dropped first.
+  virtual void WriteEvent(std::vector<uint8_t> &&bytes, TelemetryEvent event) {
+    Write(std::move(bytes));
+  }
+
   virtual std::optional<absl::flat_hash_set<std::string>> GetFilesToExport(
       size_t max_count) {
     return std::nullopt;
@@ -43,6 +51,20 @@ class Writer {
       absl::flat_hash_map<std::string, bool> files_exported) {
     // no-op
   }
+
+  struct Stats {
+    // Number of records accepted but not yet written.
+    uint64_t queue_depth;
+    // Number of records dropped because the writer couldn't keep up.
+    uint64_t dropped;
+    // Number of records dropped by telemetry event, including records that
+    // were queued but dropped because the spool was full or couldn't be
+    // flushed.
+    absl::flat_hash_map<TelemetryEvent, uint64_t> dropped_by_event;
+  };
+
+  // Writers that buffer records asynchronously report their queue state.
+  virtual std::optional<Stats> GetStats() { return std::nullopt; }
 };
 
 }  // namespace santa
@@ -14,6 +14,7 @@
 #ifndef SANTA__SANTAD_PROCESSTREE_ANNOTATIONS_BASE_H
 #define SANTA__SANTAD_PROCESSTREE_ANNOTATIONS_BASE_H
 
+#include <memory>
 #include <optional>
 
 #include "Source/santad/ProcessTree/process_tree.pb.h"
@@ -33,6 +34,13 @@ class Annotator {
                             const Process &new_process) = 0;
   virtual std::optional<::santa::pb::v1::process_tree::Annotations> Proto()
       const = 0;
+  // Reconstruct an annotation previously exported by Proto(), e.g. from a
+  // tree snapshot. Returns nullptr if the proto holds no annotation of this
+  // annotator's type.
+  virtual std::shared_ptr<const Annotator> FromProto(
+      const ::santa::pb::v1::process_tree::Annotations &proto) const {
+    return nullptr;
+  }
 };
 
 }  // namespace santa::santad::process_tree
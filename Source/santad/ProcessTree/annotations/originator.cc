@@ -64,4 +64,13 @@ std::optional<ptpb::Annotations> OriginatorAnnotator::Proto() const {
   return annotation;
 }
 
+std::shared_ptr<const Annotator> OriginatorAnnotator::FromProto(
+    const ptpb::Annotations &proto) const {
+  if (proto.originator() ==
+      ptpb::Annotations::Originator::Annotations_Originator_UNSPECIFIED) {
+    return nullptr;
+  }
+  return std::make_shared<OriginatorAnnotator>(proto.originator());
+}
+
 }  // namespace santa::santad::process_tree
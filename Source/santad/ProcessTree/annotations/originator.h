@@ -14,6 +14,7 @@
 #ifndef SANTA__SANTAD_PROCESSTREE_ANNOTATIONS_ORIGINATOR_H
 #define SANTA__SANTAD_PROCESSTREE_ANNOTATIONS_ORIGINATOR_H
 
+#include <memory>
 #include <optional>
 
 #include "Source/santad/ProcessTree/annotations/annotator.h"
@@ -41,6 +42,8 @@ class OriginatorAnnotator : public Annotator {
 
   std::optional<::santa::pb::v1::process_tree::Annotations> Proto()
       const override;
+  std::shared_ptr<const Annotator> FromProto(
+      const ::santa::pb::v1::process_tree::Annotations &proto) const override;
 
  private:
   ::santa::pb::v1::process_tree::Annotations::Originator originator_;
@@ -75,4 +75,17 @@ namespace ptpb = ::santa::pb::v1::process_tree;
   XCTAssertEqual(*descendant_annotation_opt, *annotation_opt);
 }
 
+- (void)testFromProto {
+  OriginatorAnnotator annotator;
+
+  ptpb::Annotations proto;
+  XCTAssertEqual(annotator.FromProto(proto), nullptr);
+
+  proto.set_originator(ptpb::Annotations::Originator::Annotations_Originator_CRON);
+  auto restored = annotator.FromProto(proto);
+  XCTAssertNotEqual(restored, nullptr);
+  XCTAssertEqual(restored->Proto()->originator(),
+                 ptpb::Annotations::Originator::Annotations_Originator_CRON);
+}
+
 @end
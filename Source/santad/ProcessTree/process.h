@@ -16,14 +16,17 @@
 
 #include <sys/types.h>
 
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <memory>
 #include <string>
-#include <typeindex>
+#include <utility>
 #include <vector>
 
 #include "Source/santad/ProcessTree/annotations/annotator.h"
-#include "absl/container/flat_hash_map.h"
 
 namespace santa::santad::process_tree {
 
@@ -68,8 +71,13 @@ struct Program {
   }
 };
 
+// Maximum number of annotators registered with a single tree. Each tree assigns
+// its annotators dense slots, indexing into per-process annotation storage.
+static constexpr size_t kMaxAnnotators = 4;
+
 // Fwd decls
 class ProcessTree;
+class AncestryView;
 
 class Process {
  public:
@@ -81,11 +89,28 @@ class Process {
         program_(program),
         annotations_(),
         parent_(parent),
+        depth_(parent ? parent->depth_ + 1 : 0),
         refcnt_(0),
         tombstoned_(false) {}
-  Process(const Process &) = default;
+  Process(const Process &other)
+      : pid_(other.pid_),
+        effective_cred_(other.effective_cred_),
+        program_(other.program_),
+        annotations_(other.annotations_),
+        parent_(other.parent_),
+        depth_(other.depth_),
+        refcnt_(other.refcnt_.load()),
+        tombstoned_(other.tombstoned_.load()) {}
   Process &operator=(const Process &) = delete;
-  Process(Process &&) = default;
+  Process(Process &&other)
+      : pid_(other.pid_),
+        effective_cred_(other.effective_cred_),
+        program_(other.program_),
+        annotations_(std::move(other.annotations_)),
+        parent_(std::move(other.parent_)),
+        depth_(other.depth_),
+        refcnt_(other.refcnt_.load()),
+        tombstoned_(other.tombstoned_.load()) {}
   Process &operator=(Process &&) = delete;
 
   // Const "attributes" are public
@@ -99,14 +124,72 @@ class Process {
   // annotation storage and the parent relation in memory on the process right
   // now.
   friend class ProcessTree;
-  absl::flat_hash_map<std::type_index, std::shared_ptr<const Annotator>>
-      annotations_;
+  friend class AncestryView;
+  std::array<std::shared_ptr<const Annotator>, kMaxAnnotators> annotations_;
+  // The parent chain is immutable once a process is created, so it forms a
+  // persistent list shared by all descendants.
   std::shared_ptr<const Process> parent_;
-  // TODO(nickmg): atomic here breaks the build.
-  int refcnt_;
+  // Number of ancestors.
+  size_t depth_;
+  // refcnt_ is modified under a shared lock of the tree map shard holding
+  // this process; removal from the map requires the exclusive lock.
+  std::atomic<int> refcnt_;
   // If the process is tombstoned, the event removing it from the tree has been
   // processed, but refcnt>0 keeps it alive.
-  bool tombstoned_;
+  std::atomic<bool> tombstoned_;
+};
+
+// A process and its ancestors, from the process "up" to the root. Every process
+// keeps its parent alive, so retaining the first process pins the whole chain
+// and iteration neither allocates nor touches reference counts.
+class AncestryView {
+ public:
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Process;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Process *;
+    using reference = const Process &;
+
+    Iterator() : p_(nullptr) {}
+    explicit Iterator(const Process *p) : p_(p) {}
+
+    reference operator*() const { return *p_; }
+    pointer operator->() const { return p_; }
+    Iterator &operator++() {
+      p_ = p_->parent_.get();
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator it = *this;
+      ++*this;
+      return it;
+    }
+    friend bool operator==(const Iterator &lhs, const Iterator &rhs) {
+      return lhs.p_ == rhs.p_;
+    }
+    friend bool operator!=(const Iterator &lhs, const Iterator &rhs) {
+      return !(lhs == rhs);
+    }
+
+   private:
+    const Process *p_;
+  };
+
+  explicit AncestryView(std::shared_ptr<const Process> p)
+      : process_(std::move(p)) {}
+
+  Iterator begin() const { return Iterator(process_.get()); }
+  Iterator end() const { return Iterator(); }
+  size_t size() const { return process_ ? process_->depth_ + 1 : 0; }
+  bool empty() const { return !process_; }
+
+  // The process the view was created from.
+  const Process &front() const { return *process_; }
+
+ private:
+  std::shared_ptr<const Process> process_;
 };
 
 }  // namespace santa::santad::process_tree
@@ -13,14 +13,24 @@
 /// limitations under the License.
 #include "Source/santad/ProcessTree/process_tree.h"
 
+#include <fcntl.h>
+#include <stdio.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cerrno>
+#include <chrono>
 #include <cstdint>
+#include <deque>
+#include <fstream>
 #include <functional>
 #include <memory>
 #include <optional>
+#include <string>
+#include <thread>
 #include <typeindex>
 #include <utility>
 #include <vector>
@@ -30,151 +40,490 @@
 #include "Source/santad/ProcessTree/process_tree.pb.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/synchronization/mutex.h"
 
 namespace santa::santad::process_tree {
 
-void ProcessTree::BackfillInsertChildren(
-    absl::flat_hash_map<pid_t, std::vector<Process>> &parent_map,
-    std::shared_ptr<Process> parent, const Process &unlinked_proc) {
-  auto proc = std::make_shared<Process>(
-      unlinked_proc.pid_, unlinked_proc.effective_cred_,
-      // Re-use shared pointers from parent if value equivalent
-      (parent && *(unlinked_proc.program_) == *(parent->program_))
-          ? parent->program_
-          : unlinked_proc.program_,
-      parent);
-  {
-    absl::MutexLock lock(&mtx_);
-    map_.emplace(unlinked_proc.pid_, proc);
+namespace {
+
+// Upper bound on threads used to parallelize backfill.
+static constexpr size_t kMaxBackfillThreads = 8;
+
+// Invoke f for each index in [0, n) across a pool of threads, returning once
+// all invocations have completed.
+void ParallelFor(size_t n, const std::function<void(size_t)> &f) {
+  size_t num_threads = std::min<size_t>(
+      {std::max(std::thread::hardware_concurrency(), 1u), kMaxBackfillThreads,
+       n});
+  std::atomic<size_t> next = 0;
+  auto worker = [&] {
+    for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < n;) {
+      f(i);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; i++) {
+    threads.emplace_back(worker);
   }
+  worker();
+  for (auto &t : threads) {
+    t.join();
+  }
+}
 
-  // The only case where we should not have a parent is the root processes
-  // (e.g. init, kthreadd).
-  if (parent) {
-    for (auto &annotator : annotators_) {
-      annotator->AnnotateFork(*this, *(proc->parent_), *proc);
-      if (proc->program_ != proc->parent_->program_) {
-        annotator->AnnotateExec(*this, *(proc->parent_), *proc);
+}  // namespace
+
+absl::Status ProcessTree::Backfill() {
+  return Backfill(::santa::pb::v1::process_tree::Snapshot::default_instance());
+}
+
+absl::Status ProcessTree::Backfill(
+    const ::santa::pb::v1::process_tree::Snapshot &snapshot) {
+  auto start = std::chrono::steady_clock::now();
+
+  std::optional<std::vector<pid_t>> pids = BackfillListPids();
+  if (!pids.has_value()) {
+    return absl::InternalError("Failed to list pids");
+  }
+
+  std::vector<std::shared_ptr<const Program>> snapshot_programs;
+  snapshot_programs.reserve(snapshot.programs_size());
+  for (const auto &prog : snapshot.programs()) {
+    snapshot_programs.push_back(std::make_shared<const Program>(Program{
+        .executable = prog.executable(),
+        .arguments = {prog.arguments().begin(), prog.arguments().end()},
+    }));
+  }
+  // A pid may appear more than once, e.g. both before and after an exec.
+  absl::flat_hash_map<
+      pid_t,
+      std::vector<const ::santa::pb::v1::process_tree::Snapshot::Process *>>
+      snapshot_procs;
+  for (const auto &proc : snapshot.processes()) {
+    if (proc.program() < snapshot_programs.size()) {
+      snapshot_procs[proc.pid()].push_back(&proc);
+    }
+  }
+
+  // Processes may exit at any point during the scan; those that fail to load
+  // are left empty and skipped.
+  std::vector<std::optional<BackfillEntry>> entries(pids->size());
+  ParallelFor(pids->size(), [&](size_t i) {
+    pid_t pid = (*pids)[i];
+
+    // Checking that a snapshotted process and its parent are still the same
+    // processes is cheaper than loading the process from scratch.
+    if (auto it = snapshot_procs.find(pid); it != snapshot_procs.end()) {
+      for (const auto *proc : it->second) {
+        const struct Pid snapshot_pid = {.pid = pid,
+                                         .pidversion = proc->pidversion()};
+        bool parent_live =
+            proc->parent_pid() == 0 ||
+            IsLive({.pid = proc->parent_pid(),
+                    .pidversion = proc->parent_pidversion()});
+        if (parent_live && IsLive(snapshot_pid)) {
+          entries[i].emplace(BackfillEntry{
+              .proc = Process(snapshot_pid,
+                              Cred{.uid = proc->uid(), .gid = proc->gid()},
+                              snapshot_programs[proc->program()], nullptr),
+              .ppid = proc->parent_pid(),
+              .annotations = &proc->annotations(),
+          });
+          return;
+        }
       }
     }
+
+    if (auto entry = BackfillLoad(pid); entry.ok()) {
+      entries[i].emplace(*std::move(entry));
+    }
+  });
+
+  BackfillInsert(entries);
+
+  backfill_duration_ms_ =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count();
+  return absl::OkStatus();
+}
+
+void ProcessTree::BackfillInsert(
+    const std::vector<std::optional<BackfillEntry>> &entries) {
+  absl::flat_hash_map<pid_t, std::vector<const BackfillEntry *>> parent_map;
+  for (const auto &entry : entries) {
+    // Guard against processes reporting themselves as their parent (e.g. the
+    // kernel on macOS), which would otherwise form a cycle.
+    if (entry && entry->proc.pid_.pid != entry->ppid) {
+      parent_map[entry->ppid].push_back(&*entry);
+    }
   }
 
-  for (const Process &child : parent_map[unlinked_proc.pid_.pid]) {
-    BackfillInsertChildren(parent_map, proc, child);
+  // Restored annotations are set before the process is published, so need no
+  // lock.
+  auto make_proc = [this](const BackfillEntry &entry,
+                          std::shared_ptr<const Process> parent) {
+    auto proc = std::make_shared<Process>(
+        entry.proc.pid_, entry.proc.effective_cred_,
+        programs_->Intern(*entry.proc.program_), std::move(parent));
+    if (entry.annotations) {
+      for (const auto &annotator : annotators_) {
+        if (auto a = annotator->FromProto(*entry.annotations); a) {
+          const Annotator &x = *a;
+          if (std::optional<size_t> slot = SlotFor(typeid(x)); slot) {
+            proc->annotations_[*slot] = std::move(a);
+          }
+        }
+      }
+    }
+    return proc;
+  };
+
+  // Create linked processes one level at a time from the roots (e.g. init,
+  // kthreadd) down, so every parent exists before its children.
+  std::vector<std::vector<std::shared_ptr<Process>>> levels;
+  std::vector<std::shared_ptr<Process>> level;
+  for (const BackfillEntry *root : parent_map[0]) {
+    level.push_back(make_proc(*root, nullptr));
+  }
+  while (!level.empty()) {
+    std::vector<std::shared_ptr<Process>> next_level;
+    for (const auto &parent : level) {
+      auto it = parent_map.find(parent->pid_.pid);
+      if (it == parent_map.end()) {
+        continue;
+      }
+      for (const BackfillEntry *child : it->second) {
+        next_level.push_back(make_proc(*child, parent));
+      }
+    }
+    levels.push_back(std::move(level));
+    level = std::move(next_level);
   }
-}
 
-void ProcessTree::HandleFork(uint64_t timestamp, const Process &parent,
-                             const Pid new_pid) {
-  if (Step(timestamp)) {
-    std::shared_ptr<Process> child;
-    {
-      absl::MutexLock lock(&mtx_);
-      child = std::make_shared<Process>(new_pid, parent.effective_cred_,
-                                        parent.program_, map_[parent.pid_]);
-      map_.emplace(new_pid, child);
+  // Bulk insert, taking each shard lock once.
+  std::array<std::vector<std::shared_ptr<Process>>, kMapShards> by_shard;
+  std::array<std::vector<std::shared_ptr<Process>>, kMapShards> by_parent_shard;
+  for (const auto &lvl : levels) {
+    for (const auto &proc : lvl) {
+      by_shard[&ShardFor(proc->pid_.pid) - shards_.data()].push_back(proc);
+      if (proc->parent_) {
+        by_parent_shard[&ShardFor(proc->parent_->pid_.pid) - shards_.data()]
+            .push_back(proc);
+      }
+    }
+  }
+  for (size_t i = 0; i < kMapShards; i++) {
+    MapShard &shard = shards_[i];
+    absl::MutexLock lock(&shard.mtx);
+    shard.map.reserve(shard.map.size() + by_shard[i].size());
+    for (const auto &proc : by_shard[i]) {
+      shard.map.emplace(proc->pid_, proc);
     }
-    for (const auto &annotator : annotators_) {
-      annotator->AnnotateFork(*this, parent, *child);
+    for (const auto &proc : by_parent_shard[i]) {
+      shard.children[proc->parent_->pid_].insert(proc->pid_);
     }
   }
+
+  // Annotations flow from parent to child, so each level is annotated only
+  // after the previous one. Processes within a level are independent.
+  for (size_t depth = 1; depth < levels.size(); depth++) {
+    const auto &lvl = levels[depth];
+    ParallelFor(lvl.size(), [&](size_t i) {
+      const Process &proc = *lvl[i];
+      for (auto &annotator : annotators_) {
+        annotator->AnnotateFork(*this, *proc.parent_, proc);
+        if (proc.program_ != proc.parent_->program_) {
+          annotator->AnnotateExec(*this, *proc.parent_, proc);
+        }
+      }
+    });
+  }
 }
 
-void ProcessTree::HandleExec(uint64_t timestamp, const Process &p,
-                             const Pid new_pid, const Program prog,
-                             const Cred c) {
-  if (Step(timestamp)) {
-    // TODO(nickmg): should struct pid be reworked and only pid_version be
-    // passed?
-    assert(new_pid.pid == p.pid_.pid);
+bool ProcessTree::HandleFork(uint64_t timestamp, const Process &parent,
+                             const Pid new_pid) {
+  if (!Step(timestamp)) {
+    return false;
+  }
 
-    auto new_proc = std::make_shared<Process>(
-        new_pid, c, std::make_shared<const Program>(prog), p.parent_);
-    {
-      absl::MutexLock lock(&mtx_);
-      remove_at_.push_back({timestamp, p.pid_});
-      map_.emplace(new_proc->pid_, new_proc);
+  std::shared_ptr<Process> parent_proc;
+  {
+    MapShard &shard = ShardFor(parent.pid_.pid);
+    absl::ReaderMutexLock lock(&shard.mtx);
+    parent_proc = GetLocked(shard, parent.pid_).value_or(nullptr);
+  }
+  auto child = std::make_shared<Process>(new_pid, parent.effective_cred_,
+                                         parent.program_, parent_proc);
+  {
+    MapShard &shard = ShardFor(new_pid.pid);
+    absl::MutexLock lock(&shard.mtx);
+    shard.map.emplace(new_pid, child);
+  }
+  if (parent_proc) {
+    LinkChild(parent_proc->pid_, new_pid);
+  }
+  for (const auto &annotator : annotators_) {
+    annotator->AnnotateFork(*this, parent, *child);
+  }
+  return true;
+}
+
+bool ProcessTree::HandleExec(uint64_t timestamp, const Process &p,
+                             const Pid new_pid, Program prog, const Cred c) {
+  if (!Step(timestamp)) {
+    return false;
+  }
+
+  // TODO(nickmg): should struct pid be reworked and only pid_version be
+  // passed?
+  assert(new_pid.pid == p.pid_.pid);
+
+  auto new_proc = std::make_shared<Process>(
+      new_pid, c, programs_->Intern(std::move(prog)), p.parent_);
+  {
+    MapShard &shard = ShardFor(new_pid.pid);
+    absl::MutexLock lock(&shard.mtx);
+    shard.map.emplace(new_proc->pid_, new_proc);
+  }
+  if (p.parent_) {
+    LinkChild(p.parent_->pid_, new_pid);
+  }
+  {
+    absl::MutexLock lock(&step_mtx_);
+    remove_at_.push({timestamp, p.pid_});
+  }
+  for (const auto &annotator : annotators_) {
+    annotator->AnnotateExec(*this, p, *new_proc);
+  }
+  return true;
+}
+
+bool ProcessTree::HandleExit(uint64_t timestamp, const Process &p) {
+  if (!Step(timestamp)) {
+    return false;
+  }
+
+  absl::MutexLock lock(&step_mtx_);
+  remove_at_.push({timestamp, p.pid_});
+  return true;
+}
+
+bool ProcessTree::Step(uint64_t timestamp) {
+  std::vector<struct Pid> expired;
+  {
+    absl::MutexLock lock(&step_mtx_);
+    // Nothing has fallen out of the window until it has been filled.
+    uint64_t new_cutoff = seen_timestamps_.size() < dedupe_window_
+                              ? 0
+                              : *seen_timestamps_.begin();
+    if (timestamp < new_cutoff) {
+      // Event timestamp is before the rolling window of seen events.
+      // This event may or may not have been processed, but be conservative
+      // and do not reprocess.
+      return false;
     }
-    for (const auto &annotator : annotators_) {
-      annotator->AnnotateExec(*this, p, *new_proc);
+
+    if (!seen_timestamps_.insert(timestamp).second) {
+      // Event seen, signal it should not be reprocessed.
+      return false;
+    }
+    if (seen_timestamps_.size() > dedupe_window_) {
+      seen_timestamps_.erase(seen_timestamps_.begin());
     }
+
+    while (!remove_at_.empty() && remove_at_.top().first < new_cutoff) {
+      expired.push_back(remove_at_.top().second);
+      remove_at_.pop();
+    }
+  }
+
+  // Map shards are only locked after releasing step_mtx_ so that event
+  // deduplication and lookups never wait on each other.
+  for (const struct Pid &pid : expired) {
+    Remove(pid);
   }
+
+  return true;
 }
 
-void ProcessTree::HandleExit(uint64_t timestamp, const Process &p) {
-  if (Step(timestamp)) {
-    absl::MutexLock lock(&mtx_);
-    remove_at_.push_back({timestamp, p.pid_});
+bool ProcessTree::Remove(const Pid target) {
+  std::shared_ptr<const Process> parent;
+  {
+    MapShard &shard = ShardFor(target.pid);
+    absl::MutexLock lock(&shard.mtx);
+    auto proc = GetLocked(shard, target);
+    if (!proc) {
+      return false;
+    }
+    // Pairs with ReleaseProcess: either the releaser observes the tombstone
+    // after dropping the last reference, or this observes no references.
+    (*proc)->tombstoned_.store(true);
+    if ((*proc)->refcnt_.load() > 0) {
+      return false;
+    }
+    parent = EraseLocked(shard, **proc);
+  }
+
+  if (parent) {
+    UnlinkChild(parent->pid_, target);
   }
+  return true;
 }
 
-bool ProcessTree::Step(uint64_t timestamp) {
-  absl::MutexLock lock(&mtx_);
-  uint64_t new_cutoff = seen_timestamps_.front();
-  if (timestamp < new_cutoff) {
-    // Event timestamp is before the rolling list of seen events.
-    // This event may or may not have been processed, but be conservative and
-    // do not reprocess.
-    return false;
+void ProcessTree::ReapTombstoned(const Pid target) {
+  std::shared_ptr<const Process> parent;
+  {
+    MapShard &shard = ShardFor(target.pid);
+    absl::MutexLock lock(&shard.mtx);
+    auto proc = GetLocked(shard, target);
+    if (!proc || !(*proc)->tombstoned_.load() ||
+        (*proc)->refcnt_.load() > 0) {
+      return;
+    }
+    parent = EraseLocked(shard, **proc);
   }
 
-  // seen_timestamps_ is sorted, so only look for the value if it's possibly
-  // within the array.
-  if (timestamp < seen_timestamps_.back()) {
-    // TODO(nickmg): If array is made bigger, replace with a binary search.
-    for (const auto seen_ts : seen_timestamps_) {
-      if (seen_ts == timestamp) {
-        // Event seen, signal it should not be reprocessed.
-        return false;
-      }
+  if (parent) {
+    UnlinkChild(parent->pid_, target);
+  }
+}
+
+std::shared_ptr<const Process> ProcessTree::EraseLocked(MapShard &shard,
+                                                        const Process &proc) {
+  // Copy out the parent before erasing, as the map may hold the last
+  // reference to proc.
+  std::shared_ptr<const Process> parent = proc.parent_;
+  const struct Pid pid = proc.pid_;
+  shard.children.erase(pid);
+  shard.map.erase(pid);
+  return parent;
+}
+
+bool ProcessTree::Reclaim(const Pid target) {
+  std::shared_ptr<const Process> parent;
+  {
+    MapShard &shard = ShardFor(target.pid);
+    absl::MutexLock lock(&shard.mtx);
+    auto proc = GetLocked(shard, target);
+    if (!proc) {
+      return false;
     }
+    parent = EraseLocked(shard, **proc);
   }
 
-  auto insert_point =
-      std::find_if(seen_timestamps_.rbegin(), seen_timestamps_.rend(),
-                   [&](uint64_t x) { return x < timestamp; });
-  std::move(seen_timestamps_.begin() + 1, insert_point.base(),
-            seen_timestamps_.begin());
-  *insert_point = timestamp;
+  if (parent) {
+    UnlinkChild(parent->pid_, target);
+  }
+  return true;
+}
 
-  for (auto it = remove_at_.begin(); it != remove_at_.end();) {
-    if (it->first < new_cutoff) {
-      if (auto target = GetLocked(it->second);
-          target && (*target)->refcnt_ > 0) {
-        (*target)->tombstoned_ = true;
-      } else {
-        map_.erase(it->second);
-      }
-      it = remove_at_.erase(it);
+size_t ProcessTree::Reconcile() {
+  absl::MutexLock reconcile_lock(&reconcile_mtx_);
+
+  std::vector<struct Pid> pids;
+  for (MapShard &shard : shards_) {
+    absl::ReaderMutexLock lock(&shard.mtx);
+    for (const auto &[pid, _] : shard.map) {
+      pids.push_back(pid);
+    }
+  }
+  // Liveness is checked without holding any shard lock. A process seen dead
+  // for the first time may simply have exited with its exit event still in
+  // flight, so it is given until the next pass to be removed normally.
+  // Processes that stay retained are tracked until their retains are deemed
+  // leaked.
+  absl::flat_hash_map<struct Pid, size_t> dead;
+  size_t evicted = 0;
+  for (const struct Pid &pid : pids) {
+    if (IsLive(pid)) {
+      continue;
+    }
+    size_t passes = 1;
+    if (auto it = dead_.find(pid); it != dead_.end()) {
+      passes = it->second + 1;
+    }
+    if (passes >= kLeakedRetainPasses) {
+      evicted += Reclaim(pid);
+    } else if (passes > 1 && Remove(pid)) {
+      evicted++;
     } else {
-      it++;
+      dead.emplace(pid, passes);
     }
   }
 
-  return true;
+  dead_ = std::move(dead);
+  evictions_ += evicted;
+  over_budget_ = pids.size() - evicted > max_processes_;
+  return evicted;
+}
+
+void ProcessTree::LinkChild(const Pid parent, const Pid child) {
+  MapShard &shard = ShardFor(parent.pid);
+  absl::MutexLock lock(&shard.mtx);
+  shard.children[parent].insert(child);
+}
+
+void ProcessTree::UnlinkChild(const Pid parent, const Pid child) {
+  MapShard &shard = ShardFor(parent.pid);
+  absl::MutexLock lock(&shard.mtx);
+  if (auto it = shard.children.find(parent); it != shard.children.end()) {
+    it->second.erase(child);
+    if (it->second.empty()) {
+      shard.children.erase(it);
+    }
+  }
 }
 
-void ProcessTree::RetainProcess(std::vector<struct Pid> &pids) {
-  absl::MutexLock lock(&mtx_);
+void ProcessTree::RetainProcess(const std::vector<struct Pid> &pids) {
+  // Visit pids grouped by shard so each shard lock is taken once. The shared
+  // lock only excludes removal; the count itself is atomic.
+  std::vector<std::pair<MapShard *, struct Pid>> by_shard;
+  by_shard.reserve(pids.size());
   for (const struct Pid &p : pids) {
-    auto proc = GetLocked(p);
-    if (proc) {
-      (*proc)->refcnt_++;
+    by_shard.emplace_back(&ShardFor(p.pid), p);
+  }
+  std::sort(by_shard.begin(), by_shard.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+
+  for (auto it = by_shard.begin(); it != by_shard.end();) {
+    MapShard &shard = *it->first;
+    absl::ReaderMutexLock lock(&shard.mtx);
+    for (; it != by_shard.end() && it->first == &shard; ++it) {
+      if (auto proc = GetLocked(shard, it->second); proc) {
+        (*proc)->refcnt_.fetch_add(1);
+      }
     }
   }
 }
 
-void ProcessTree::ReleaseProcess(std::vector<struct Pid> &pids) {
-  absl::MutexLock lock(&mtx_);
+void ProcessTree::ReleaseProcess(const std::vector<struct Pid> &pids) {
   for (const struct Pid &p : pids) {
-    auto proc = GetLocked(p);
-    if (proc) {
-      if (--(*proc)->refcnt_ == 0 && (*proc)->tombstoned_) {
-        map_.erase(p);
+    bool reap = false;
+    {
+      MapShard &shard = ShardFor(p.pid);
+      absl::ReaderMutexLock lock(&shard.mtx);
+      auto proc = GetLocked(shard, p);
+      if (!proc) {
+        continue;
+      }
+      // A pid may have been absent from the tree when it was retained, so
+      // never drop the count below zero.
+      int refs = (*proc)->refcnt_.load();
+      while (refs > 0 &&
+             !(*proc)->refcnt_.compare_exchange_weak(refs, refs - 1)) {
       }
+      reap = refs == 1 && (*proc)->tombstoned_.load();
+    }
+
+    // Reclamation needs the exclusive lock, so it is done separately and only
+    // by the holder of the last reference.
+    if (reap) {
+      ReapTombstoned(p);
     }
   }
 }
@@ -185,49 +534,119 @@ Annotation get/set
 ---
 */
 
+std::optional<size_t> ProcessTree::SlotFor(const std::type_info &type) const {
+  for (size_t slot = 0; slot < kMaxAnnotators; ++slot) {
+    if (annotator_types_[slot] && *annotator_types_[slot] == type) {
+      return slot;
+    }
+  }
+  return std::nullopt;
+}
+
+std::array<const std::type_info *, kMaxAnnotators> ProcessTree::AssignSlots(
+    const std::vector<std::unique_ptr<Annotator>> &annotators) {
+  std::array<const std::type_info *, kMaxAnnotators> types{};
+  for (size_t slot = 0; slot < std::min(annotators.size(), kMaxAnnotators);
+       ++slot) {
+    const Annotator &x = *annotators[slot];
+    types[slot] = &typeid(x);
+  }
+  return types;
+}
+
 void ProcessTree::AnnotateProcess(const Process &p,
                                   std::shared_ptr<const Annotator> a) {
-  absl::MutexLock lock(&mtx_);
+  MapShard &shard = ShardFor(p.pid_.pid);
+  absl::MutexLock lock(&shard.mtx);
+  auto proc = GetLocked(shard, p.pid_);
+  if (!proc) {
+    return;
+  }
+  // Only annotations from annotators registered with this tree are stored.
   const Annotator &x = *a;
-  map_[p.pid_]->annotations_.emplace(std::type_index(typeid(x)), std::move(a));
+  std::optional<size_t> slot = SlotFor(typeid(x));
+  if (!slot) {
+    return;
+  }
+  // Annotations are immutable once set.
+  if (!(*proc)->annotations_[*slot]) {
+    (*proc)->annotations_[*slot] = std::move(a);
+  }
 }
 
 std::optional<::santa::pb::v1::process_tree::Annotations>
 ProcessTree::ExportAnnotations(const Pid p) {
   auto proc = Get(p);
-  if (!proc || (*proc)->annotations_.empty()) {
+  if (!proc || std::none_of((*proc)->annotations_.begin(),
+                            (*proc)->annotations_.end(),
+                            [](const auto &annotation) { return annotation; })) {
     return std::nullopt;
   }
   ::santa::pb::v1::process_tree::Annotations a;
-  for (const auto &[_, annotation] : (*proc)->annotations_) {
+  for (const auto &annotation : (*proc)->annotations_) {
+    if (!annotation) continue;
     if (auto x = annotation->Proto(); x) a.MergeFrom(*x);
   }
   return a;
 }
 
+::santa::pb::v1::process_tree::Snapshot ProcessTree::ExportSnapshot() const {
+  ::santa::pb::v1::process_tree::Snapshot snapshot;
+  // Programs are interned, so identical programs share a pointer.
+  absl::flat_hash_map<const Program *, uint32_t> program_ids;
+
+  for (const MapShard &shard : shards_) {
+    absl::ReaderMutexLock lock(&shard.mtx);
+    for (const auto &[_, proc] : shard.map) {
+      auto [it, inserted] =
+          program_ids.emplace(proc->program_.get(), program_ids.size());
+      if (inserted) {
+        auto *prog = snapshot.add_programs();
+        prog->set_executable(proc->program_->executable);
+        for (const std::string &arg : proc->program_->arguments) {
+          prog->add_arguments(arg);
+        }
+      }
+
+      auto *p = snapshot.add_processes();
+      p->set_pid(proc->pid_.pid);
+      p->set_pidversion(proc->pid_.pidversion);
+      if (proc->parent_) {
+        p->set_parent_pid(proc->parent_->pid_.pid);
+        p->set_parent_pidversion(proc->parent_->pid_.pidversion);
+      }
+      p->set_program(it->second);
+      p->set_uid(proc->effective_cred_.uid);
+      p->set_gid(proc->effective_cred_.gid);
+      for (const auto &annotation : proc->annotations_) {
+        if (!annotation) continue;
+        if (auto x = annotation->Proto(); x) {
+          p->mutable_annotations()->MergeFrom(*x);
+        }
+      }
+    }
+  }
+
+  return snapshot;
+}
+
 /*
 ---
 Tree inspection methods
 ---
 */
 
-std::vector<std::shared_ptr<const Process>> ProcessTree::RootSlice(
-    std::shared_ptr<const Process> p) const {
-  std::vector<std::shared_ptr<const Process>> slice;
-  while (p) {
-    slice.push_back(p);
-    p = p->parent_;
-  }
-  return slice;
+AncestryView ProcessTree::RootSlice(std::shared_ptr<const Process> p) const {
+  return AncestryView(std::move(p));
 }
 
 void ProcessTree::Iterate(
     std::function<void(std::shared_ptr<const Process> p)> f) const {
   std::vector<std::shared_ptr<const Process>> procs;
-  {
-    absl::ReaderMutexLock lock(&mtx_);
-    procs.reserve(map_.size());
-    for (auto &[_, proc] : map_) {
+  for (const MapShard &shard : shards_) {
+    absl::ReaderMutexLock lock(&shard.mtx);
+    procs.reserve(procs.size() + shard.map.size());
+    for (auto &[_, proc] : shard.map) {
       procs.push_back(proc);
     }
   }
@@ -239,66 +658,195 @@ void ProcessTree::Iterate(
 
 std::optional<std::shared_ptr<const Process>> ProcessTree::Get(
     const Pid target) const {
-  absl::ReaderMutexLock lock(&mtx_);
-  return GetLocked(target);
+  const MapShard &shard = ShardFor(target.pid);
+  absl::ReaderMutexLock lock(&shard.mtx);
+  return GetLocked(shard, target);
 }
 
 std::optional<std::shared_ptr<Process>> ProcessTree::GetLocked(
-    const Pid target) const {
-  auto it = map_.find(target);
-  if (it == map_.end()) {
+    const MapShard &shard, const Pid target) const {
+  auto it = shard.map.find(target);
+  if (it == shard.map.end()) {
     return std::nullopt;
   }
   return it->second;
 }
 
+ProcessTree::MapShard &ProcessTree::ShardFor(pid_t pid) const {
+  return shards_[absl::Hash<pid_t>{}(pid) % kMapShards];
+}
+
 std::shared_ptr<const Process> ProcessTree::GetParent(const Process &p) const {
   return p.parent_;
 }
 
+std::vector<std::shared_ptr<const Process>> ProcessTree::Children(
+    const Pid p) const {
+  std::vector<struct Pid> child_pids;
+  {
+    const MapShard &shard = ShardFor(p.pid);
+    absl::ReaderMutexLock lock(&shard.mtx);
+    if (auto it = shard.children.find(p); it != shard.children.end()) {
+      child_pids.assign(it->second.begin(), it->second.end());
+    }
+  }
+
+  std::vector<std::shared_ptr<const Process>> children;
+  children.reserve(child_pids.size());
+  for (const struct Pid &child_pid : child_pids) {
+    if (auto child = Get(child_pid); child) {
+      children.push_back(*child);
+    }
+  }
+  return children;
+}
+
+std::vector<std::shared_ptr<const Process>> ProcessTree::Descendants(
+    const Pid p) const {
+  std::vector<std::shared_ptr<const Process>> descendants;
+  IterateDescendants(p, [&descendants](std::shared_ptr<const Process> proc) {
+    descendants.push_back(std::move(proc));
+  });
+  return descendants;
+}
+
+void ProcessTree::IterateDescendants(
+    const Pid p, std::function<void(std::shared_ptr<const Process>)> f) const {
+  std::deque<struct Pid> frontier = {p};
+  // Guard against cycles should a pid be reused while its previous owner is
+  // still in the index.
+  absl::flat_hash_set<struct Pid> visited = {p};
+  while (!frontier.empty()) {
+    struct Pid next = frontier.front();
+    frontier.pop_front();
+    for (auto &child : Children(next)) {
+      if (!visited.insert(child->pid_).second) {
+        continue;
+      }
+      frontier.push_back(child->pid_);
+      f(std::move(child));
+    }
+  }
+}
+
+ProcessTree::Stats ProcessTree::GetStats() const {
+  size_t processes = 0;
+  size_t tombstones = 0;
+  for (const MapShard &shard : shards_) {
+    absl::ReaderMutexLock lock(&shard.mtx);
+    processes += shard.map.size();
+    for (const auto &[_, proc] : shard.map) {
+      tombstones += proc->tombstoned_.load();
+    }
+  }
+
+  return Stats{
+      .processes = processes,
+      .tombstones = tombstones,
+      .evictions = evictions_.load(),
+      .programs = programs_->Size(),
+      .program_bytes = programs_->Bytes(),
+      .backfill_duration_ms = backfill_duration_ms_.load(),
+  };
+}
+
 #if SANTA_PROCESS_TREE_DEBUG
 void ProcessTree::DebugDump(std::ostream &stream) const {
-  absl::ReaderMutexLock lock(&mtx_);
-  stream << map_.size() << " processes" << std::endl;
-  DebugDumpLocked(stream, 0, 0);
+  std::vector<std::shared_ptr<const Process>> roots;
+  size_t count = 0;
+  Iterate([&](std::shared_ptr<const Process> p) {
+    count++;
+    if (!p->parent_) {
+      roots.push_back(p);
+    }
+  });
+  stream << count << " processes" << std::endl;
+  for (const auto &root : roots) {
+    DebugDumpChildren(stream, *root, 0);
+  }
 }
 
-void ProcessTree::DebugDumpLocked(std::ostream &stream, int depth,
-                                  pid_t ppid) const
-    ABSL_SHARED_LOCKS_REQUIRED(mtx_) {
-  for (auto &[_, process] : map_) {
-    if ((ppid == 0 && !process->parent_) ||
-        (process->parent_ && process->parent_->pid_.pid == ppid)) {
-      stream << std::string(2 * depth, ' ') << process->pid_.pid
-             << process->program_->executable << std::endl;
-      DebugDumpLocked(stream, depth + 1, process->pid_.pid);
-    }
+void ProcessTree::DebugDumpChildren(std::ostream &stream, const Process &p,
+                                    int depth) const {
+  stream << std::string(2 * depth, ' ') << p.pid_.pid << p.program_->executable
+         << std::endl;
+  for (const auto &child : Children(p.pid_)) {
+    DebugDumpChildren(stream, *child, depth + 1);
   }
 }
 #endif
 
 absl::StatusOr<std::shared_ptr<ProcessTree>> CreateTree(
-    std::vector<std::unique_ptr<Annotator>> annotations) {
+    std::vector<std::unique_ptr<Annotator>> annotations,
+    const std::optional<::santa::pb::v1::process_tree::Snapshot> &snapshot,
+    size_t max_processes) {
   absl::flat_hash_set<std::type_index> seen;
   for (const auto &annotator : annotations) {
-    if (seen.count(std::type_index(typeid(annotator)))) {
+    const Annotator &x = *annotator;
+    if (seen.count(std::type_index(typeid(x)))) {
       return absl::InvalidArgumentError(
           "Multiple annotators of the same class");
     }
-    seen.emplace(std::type_index(typeid(annotator)));
+    seen.emplace(std::type_index(typeid(x)));
+  }
+
+  // Each annotator needs one of the tree's kMaxAnnotators slots.
+  if (seen.size() > kMaxAnnotators) {
+    return absl::InvalidArgumentError("Too many annotators");
   }
 
   if (seen.empty()) {
     return nullptr;
   }
 
-  auto tree = std::make_shared<ProcessTree>(std::move(annotations));
-  if (auto status = tree->Backfill(); !status.ok()) {
+  auto tree = std::make_shared<ProcessTree>(
+      std::move(annotations), ProcessTree::kDefaultDedupeWindow, max_processes);
+  absl::Status status =
+      snapshot ? tree->Backfill(*snapshot) : tree->Backfill();
+  if (!status.ok()) {
     return status;
   }
   return tree;
 }
 
+absl::Status WriteSnapshot(
+    const ::santa::pb::v1::process_tree::Snapshot &snapshot,
+    const std::string &path) {
+  // Write to a temporary file first so a crash mid-write never leaves a
+  // truncated snapshot behind. Snapshots hold process arguments, so they are
+  // only readable by the owner.
+  std::string tmp_path = path + ".tmp";
+  unlink(tmp_path.c_str());
+  int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return absl::ErrnoToStatus(errno, "Failed to create snapshot");
+  }
+  bool written = snapshot.SerializeToFileDescriptor(fd) && fsync(fd) == 0;
+  close(fd);
+  if (!written) {
+    unlink(tmp_path.c_str());
+    return absl::InternalError("Failed to write snapshot");
+  }
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+    unlink(tmp_path.c_str());
+    return absl::InternalError("Failed to replace snapshot");
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<::santa::pb::v1::process_tree::Snapshot> ReadSnapshot(
+    const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return absl::NotFoundError("No snapshot");
+  }
+  ::santa::pb::v1::process_tree::Snapshot snapshot;
+  if (!snapshot.ParseFromIstream(&in)) {
+    return absl::DataLossError("Failed to parse snapshot");
+  }
+  return snapshot;
+}
+
 /*
 ----
 Tokens
@@ -308,9 +856,14 @@ Tokens
 ProcessToken::ProcessToken(std::shared_ptr<ProcessTree> tree,
                            std::vector<struct Pid> pids)
     : tree_(std::move(tree)), pids_(std::move(pids)) {
-  tree_->RetainProcess(pids);
+  tree_->RetainProcess(pids_);
 }
 
-ProcessToken::~ProcessToken() { tree_->ReleaseProcess(pids_); }
+ProcessToken::~ProcessToken() {
+  // Moved-from tokens no longer hold a tree or pids.
+  if (tree_) {
+    tree_->ReleaseProcess(pids_);
+  }
+}
 
 }  // namespace santa::santad::process_tree
@@ -14,12 +14,25 @@
 #ifndef SANTA__SANTAD_PROCESSTREE_TREE_H
 #define SANTA__SANTAD_PROCESSTREE_TREE_H
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <queue>
+#include <string>
+#include <typeindex>
 #include <typeinfo>
+#include <utility>
 #include <vector>
 
 #include "Source/santad/ProcessTree/process.h"
+#include "Source/santad/ProcessTree/process_tree.pb.h"
+#include "Source/santad/ProcessTree/program_pool.h"
+#include "absl/container/btree_set.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/synchronization/mutex.h"
@@ -33,8 +46,28 @@ class ProcessTreeTestPeer;
 
 class ProcessTree {
  public:
-  explicit ProcessTree(std::vector<std::unique_ptr<Annotator>> &&annotators)
-      : annotators_(std::move(annotators)), seen_timestamps_({}) {}
+  // Default number of most recent event timestamps remembered for
+  // deduplication. Removal of exited processes is deferred until their exit
+  // event falls out of this window.
+  static constexpr size_t kDefaultDedupeWindow = 32;
+
+  // Default number of processes the tree may hold before it is considered
+  // over budget, and should be reconciled again sooner.
+  static constexpr size_t kDefaultMaxProcesses = 65536;
+
+  // Number of consecutive Reconcile passes a dead process may remain
+  // retained before its retains are assumed to have leaked, and it is erased
+  // regardless.
+  static constexpr size_t kLeakedRetainPasses = 5;
+
+  explicit ProcessTree(std::vector<std::unique_ptr<Annotator>> &&annotators,
+                       size_t dedupe_window = kDefaultDedupeWindow,
+                       size_t max_processes = kDefaultMaxProcesses)
+      : annotators_(std::move(annotators)),
+        annotator_types_(AssignSlots(annotators_)),
+        programs_(ProgramPool::Create()),
+        dedupe_window_(std::max<size_t>(dedupe_window, 1)),
+        max_processes_(max_processes) {}
   ProcessTree(const ProcessTree &) = delete;
   ProcessTree &operator=(const ProcessTree &) = delete;
   ProcessTree(ProcessTree &&) = delete;
@@ -43,9 +76,16 @@ class ProcessTree {
   // Initialize the tree with the processes currently running on the system.
   absl::Status Backfill();
 
+  // As above, but processes from the snapshot that are still running are
+  // restored from it, along with their annotations, rather than re-loaded
+  // from the system.
+  absl::Status Backfill(const ::santa::pb::v1::process_tree::Snapshot &snapshot);
+
   // Inform the tree of a fork event, in which the parent process spawns a child
   // with the only difference between the two being the pid.
-  void HandleFork(uint64_t timestamp, const Process &parent,
+  // Each Handle method returns whether the event was applied, or ignored as a
+  // duplicate of an event the tree has already processed.
+  bool HandleFork(uint64_t timestamp, const Process &parent,
                   struct Pid new_pid);
 
   // Inform the tree of an exec event, in which the program and potentially cred
@@ -56,22 +96,23 @@ class ProcessTree {
   // N.B. new_pid is required as the "pid version" will have changed.
   // It is a programming error to pass a new_pid such that
   // p.pid_.pid != new_pid.pid.
-  void HandleExec(uint64_t timestamp, const Process &p, struct Pid new_pid,
+  bool HandleExec(uint64_t timestamp, const Process &p, struct Pid new_pid,
                   struct Program prog, struct Cred c);
 
   // Inform the tree of a process exit.
-  void HandleExit(uint64_t timestamp, const Process &p);
+  bool HandleExit(uint64_t timestamp, const Process &p);
 
   // Mark the given pids as needing to be retained in the tree's map for future
   // access. Normally, Processes are removed once all clients process past the
   // event which would remove the Process (e.g. exit), however in cases where
   // async processing occurs, the Process may need to be accessed after the
   // exit.
-  void RetainProcess(std::vector<struct Pid> &pids);
+  // Pids sharing a map shard are retained under a single shared lock.
+  void RetainProcess(const std::vector<struct Pid> &pids);
 
   // Release previously retained processes, signaling that the client is done
   // processing the event that retained them.
-  void ReleaseProcess(std::vector<struct Pid> &pids);
+  void ReleaseProcess(const std::vector<struct Pid> &pids);
 
   // Annotate the given process with an Annotator (state).
   void AnnotateProcess(const Process &p, std::shared_ptr<const Annotator> a);
@@ -85,12 +126,14 @@ class ProcessTree {
   std::optional<::santa::pb::v1::process_tree::Annotations> ExportAnnotations(
       struct Pid p);
 
+  // Capture every process in the tree, with its program and annotations.
+  ::santa::pb::v1::process_tree::Snapshot ExportSnapshot() const;
+
   // Atomically get the slice of Processes going from the given process "up"
   // to the root. The root process has no parent. N.B. There may be more than
   // one root process. E.g. on Linux, both init (PID 1) and kthread (PID 2)
   // are considered roots, as they are reported to have PPID=0.
-  std::vector<std::shared_ptr<const Process>> RootSlice(
-      std::shared_ptr<const Process> p) const;
+  AncestryView RootSlice(std::shared_ptr<const Process> p) const;
 
   // Call f for all processes in the tree. The list of processes is captured
   // before invoking f, so it is safe to mutate the tree in f.
@@ -102,6 +145,52 @@ class ProcessTree {
   // Traverse the tree from the given Process to its parent.
   std::shared_ptr<const Process> GetParent(const Process &p) const;
 
+  // Get the processes in the tree whose parent is the given process. This is
+  // the inverse of GetParent, so children forked before an exec remain
+  // children of the pre-exec Process.
+  std::vector<std::shared_ptr<const Process>> Children(struct Pid p) const;
+
+  // Get all processes below the given process, in breadth first order.
+  std::vector<std::shared_ptr<const Process>> Descendants(struct Pid p) const;
+
+  // Call f for each process below the given process, in breadth first order.
+  // At most one map shard lock is held at a time and none are held while f
+  // runs, so it is safe to mutate the tree in f.
+  void IterateDescendants(
+      struct Pid p,
+      std::function<void(std::shared_ptr<const Process>)> f) const;
+
+  // Evict processes that are no longer running but are still in the tree,
+  // e.g. because their exit event was dropped, or a client leaked a retain.
+  // A process is evicted once it has been seen dead by two consecutive calls.
+  // As with exits, a retained process is only tombstoned, and is erased once
+  // its last reference is released. If it is still retained after
+  // kLeakedRetainPasses calls, it is erased anyway, and later releases of it
+  // are no-ops. This is intended to be called periodically. Returns the
+  // number of processes evicted.
+  size_t Reconcile();
+
+  // Whether the tree held more than max_processes after the last Reconcile,
+  // in which case the next call should not wait for the usual interval.
+  bool OverBudget() const { return over_budget_.load(); }
+
+  // Point-in-time counters describing the state of the tree, suitable for
+  // exporting as metrics.
+  struct Stats {
+    // Processes in the tree, and how many of those have exited but are still
+    // retained.
+    size_t processes;
+    size_t tombstones;
+    // Total processes evicted by Reconcile.
+    uint64_t evictions;
+    // Number of distinct interned programs and their approximate footprint.
+    size_t programs;
+    size_t program_bytes;
+    // Wall time taken by the most recent Backfill.
+    uint64_t backfill_duration_ms;
+  };
+  Stats GetStats() const;
+
 #if SANTA_PROCESS_TREE_DEBUG
   // Dump the tree in a human readable form to the given ostream.
   void DebugDump(std::ostream &stream) const;
@@ -109,50 +198,168 @@ class ProcessTree {
 
  private:
   friend class ProcessTreeTestPeer;
-  void BackfillInsertChildren(
-      absl::flat_hash_map<pid_t, std::vector<Process>> &parent_map,
-      std::shared_ptr<Process> parent, const Process &unlinked_proc);
+
+  // Returns this tree's annotation slot for the given annotator type, or
+  // nullopt if no annotator of that type is registered with the tree.
+  std::optional<size_t> SlotFor(const std::type_info &type) const;
+  // Assigns each annotator the slot matching its registration order. Only the
+  // first kMaxAnnotators annotators are assigned a slot.
+  static std::array<const std::type_info *, kMaxAnnotators> AssignSlots(
+      const std::vector<std::unique_ptr<Annotator>> &annotators);
+
+  // A process discovered during backfill, not yet linked to its parent.
+  struct BackfillEntry {
+    Process proc;
+    pid_t ppid;
+    // Annotations to restore, when the process was loaded from a snapshot.
+    const ::santa::pb::v1::process_tree::Annotations *annotations = nullptr;
+  };
+
+  // Platform specific backfill helpers: list all pids on the system, and load
+  // a single pid along with the pid of its parent.
+  static std::optional<std::vector<pid_t>> BackfillListPids();
+  static absl::StatusOr<BackfillEntry> BackfillLoad(pid_t pid);
+
+  // Link the loaded processes into the tree with a single lock acquisition
+  // per shard, then run annotators over them one tree level at a time.
+  void BackfillInsert(
+      const std::vector<std::optional<BackfillEntry>> &entries);
 
   // Mark that an event with the given timestamp is being processed.
   // Returns whether the given timestamp is "novel", and the tree should be
   // updated with the results of the event.
   bool Step(uint64_t timestamp);
 
-  std::optional<std::shared_ptr<Process>> GetLocked(struct Pid target) const
-      ABSL_SHARED_LOCKS_REQUIRED(mtx_);
-
-  void DebugDumpLocked(std::ostream &stream, int depth, pid_t ppid) const;
+  // The process map is split into independently locked shards keyed by pid so
+  // that events for unrelated processes (e.g. from different ES clients) do
+  // not contend on a single lock. All versions of a given pid live in the same
+  // shard.
+  static constexpr size_t kMapShards = 16;
+
+  struct MapShard {
+    mutable absl::Mutex mtx;
+    absl::flat_hash_map<const struct Pid, std::shared_ptr<Process>> map
+        ABSL_GUARDED_BY(mtx);
+    // Index of parent pid to the pids of its children. Entries live in the
+    // shard of the parent.
+    absl::flat_hash_map<const struct Pid, absl::flat_hash_set<struct Pid>>
+        children ABSL_GUARDED_BY(mtx);
+  };
+
+  MapShard &ShardFor(pid_t pid) const;
+
+  std::optional<std::shared_ptr<Process>> GetLocked(const MapShard &shard,
+                                                    struct Pid target) const
+      ABSL_SHARED_LOCKS_REQUIRED(shard.mtx);
+
+  // Remove the given pid from the map, or tombstone it if it is still
+  // retained. Returns whether the process was erased.
+  bool Remove(struct Pid target);
+
+  // Erase the given process whatever its reference count. Returns whether it
+  // was present.
+  bool Reclaim(struct Pid target);
+
+  // Erase a tombstoned process once its last reference is released. This
+  // re-checks both under the exclusive shard lock, as a concurrent retain or
+  // removal may have raced the caller.
+  void ReapTombstoned(struct Pid target);
+
+  // Platform specific check that the given pid is running and has not since
+  // exec'd or been reused.
+  static bool IsLive(const struct Pid &pid);
+
+  // Drop the given process from the map and the children index. Returns the
+  // parent of the process, which must then be passed to UnlinkChild once the
+  // shard lock is released.
+  std::shared_ptr<const Process> EraseLocked(MapShard &shard,
+                                             const Process &proc)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(shard.mtx);
+
+  // Add or remove child from the children index of parent.
+  void LinkChild(struct Pid parent, struct Pid child);
+  void UnlinkChild(struct Pid parent, struct Pid child);
+
+  void DebugDumpChildren(std::ostream &stream, const Process &p,
+                         int depth) const;
 
   std::vector<std::unique_ptr<Annotator>> annotators_;
-
-  mutable absl::Mutex mtx_;
-  absl::flat_hash_map<const struct Pid, std::shared_ptr<Process>> map_
-      ABSL_GUARDED_BY(mtx_);
-  // List of pids which should be removed from map_, and at the timestamp at
-  // which they should be.
+  // Annotator type occupying each annotation slot, or nullptr for unused
+  // slots. Immutable after construction.
+  const std::array<const std::type_info *, kMaxAnnotators> annotator_types_;
+
+  std::atomic<uint64_t> backfill_duration_ms_ = 0;
+
+  // Processes running identical programs share a single interned Program.
+  std::shared_ptr<ProgramPool> programs_;
+
+  mutable std::array<MapShard, kMapShards> shards_;
+
+  // Orders pending removals so the earliest timestamp is at the top of the
+  // heap.
+  struct LaterRemoval {
+    bool operator()(const std::pair<uint64_t, struct Pid> &lhs,
+                    const std::pair<uint64_t, struct Pid> &rhs) const {
+      return lhs.first > rhs.first;
+    }
+  };
+
+  const size_t dedupe_window_;
+  const size_t max_processes_;
+
+  // Serializes Reconcile calls. dead_ holds the processes found dead by the
+  // previous call, and for how many consecutive calls they have been dead.
+  absl::Mutex reconcile_mtx_;
+  absl::flat_hash_map<struct Pid, size_t> dead_ ABSL_GUARDED_BY(reconcile_mtx_);
+  std::atomic<uint64_t> evictions_ = 0;
+  std::atomic<bool> over_budget_ = false;
+
+  // Guards the event bookkeeping used by Step. This is independent of the map
+  // shards so that deduplicating an event never blocks lookups.
+  absl::Mutex step_mtx_;
+  // Min-heap of pids which should be removed from the map, and the timestamp
+  // at which they should be.
   // Elements are removed when the timestamp falls out of the seen_timestamps_
-  // list below, signifying that all clients have synced past the timestamp.
-  std::vector<std::pair<uint64_t, struct Pid>> remove_at_ ABSL_GUARDED_BY(mtx_);
-  // Rolling list of event timestamps processed by the tree.
+  // window below, signifying that all clients have synced past the timestamp.
+  std::priority_queue<std::pair<uint64_t, struct Pid>,
+                      std::vector<std::pair<uint64_t, struct Pid>>,
+                      LaterRemoval>
+      remove_at_ ABSL_GUARDED_BY(step_mtx_);
+  // Rolling window of the most recent dedupe_window_ event timestamps
+  // processed by the tree.
   // This is used to ensure an event only gets processed once, even if events
   // come out of order.
-  std::array<uint64_t, 32> seen_timestamps_ ABSL_GUARDED_BY(mtx_);
+  absl::btree_set<uint64_t> seen_timestamps_ ABSL_GUARDED_BY(step_mtx_);
 };
 
 template <typename T>
 std::optional<std::shared_ptr<const T>> ProcessTree::GetAnnotation(
     const Process &p) const {
-  auto it = p.annotations_.find(std::type_index(typeid(T)));
-  if (it == p.annotations_.end()) {
+  std::optional<size_t> slot = SlotFor(typeid(T));
+  if (!slot || !p.annotations_[*slot]) {
     return std::nullopt;
   }
-  return std::dynamic_pointer_cast<const T>(it->second);
+  return std::static_pointer_cast<const T>(p.annotations_[*slot]);
 }
 
 // Create a new tree, ensuring the provided annotations are valid and that
-// backfill is successful.
+// backfill is successful. If given, the backfill is merged with the snapshot.
+// max_processes sets the tree's memory budget, see ProcessTree::OverBudget.
 absl::StatusOr<std::shared_ptr<ProcessTree>> CreateTree(
-    std::vector<std::unique_ptr<Annotator>> annotations);
+    std::vector<std::unique_ptr<Annotator>> annotations,
+    const std::optional<::santa::pb::v1::process_tree::Snapshot> &snapshot =
+        std::nullopt,
+    size_t max_processes = ProcessTree::kDefaultMaxProcesses);
+
+// Persist a snapshot to the given path, replacing any existing file
+// atomically.
+absl::Status WriteSnapshot(
+    const ::santa::pb::v1::process_tree::Snapshot &snapshot,
+    const std::string &path);
+
+// Read a snapshot previously written by WriteSnapshot.
+absl::StatusOr<::santa::pb::v1::process_tree::Snapshot> ReadSnapshot(
+    const std::string &path);
 
 // ProcessTokens provide a lifetime based approach to retaining processes
 // in a ProcessTree. When a token is created with a list of pids that may need
@@ -174,8 +381,14 @@ class ProcessToken {
     return *this = ProcessToken(other.tree_, other.pids_);
   }
   ProcessToken &operator=(ProcessToken &&other) noexcept {
-    tree_ = std::move(other.tree_);
-    pids_ = std::move(other.pids_);
+    if (this != &other) {
+      // Release the pids this token held before taking over other's.
+      if (tree_) {
+        tree_->ReleaseProcess(pids_);
+      }
+      tree_ = std::move(other.tree_);
+      pids_ = std::move(other.pids_);
+    }
     return *this;
   }
 
@@ -0,0 +1,448 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+
+// Replays a fork/exec/exit trace through a ProcessTree and reports throughput,
+// per-call latency and peak memory.
+//
+// The tree is first backfilled from the live system and the trace's root
+// process is mapped onto this process, so every replayed process hangs off of
+// a real tree. Traces are read from a serialized
+// santa.pb.v1.process_tree.Trace, or generated synthetically.
+//
+// Usage: process_tree_bench [--trace=PATH] [--write_trace=PATH]
+//                           [--events=N] [--programs=N] [--max_live=N]
+//                           [--writers=N] [--readers=N] [--token_threads=N]
+//
+// Each writer thread replays the full trace, mirroring multiple ES clients
+// delivering the same events to the tree. Token threads concurrently create
+// and destroy ProcessTokens for the process and parent of random events, as
+// is done for every event delivered to a tree aware client.
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "Source/santad/ProcessTree/annotations/originator.h"
+#include "Source/santad/ProcessTree/process.h"
+#include "Source/santad/ProcessTree/process_tree.h"
+#include "Source/santad/ProcessTree/process_tree_trace.pb.h"
+
+namespace ptpb = ::santa::pb::v1::process_tree;
+
+namespace santa::santad::process_tree {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Set on every pid version from the trace so replayed processes can never
+// collide with backfilled ones.
+static constexpr uint64_t kTraceVersionBit = 1ull << 63;
+
+struct Options {
+  std::string trace_path;
+  std::string write_trace_path;
+  size_t events = 1'000'000;
+  size_t programs = 64;
+  size_t max_live = 10'000;
+  int writers = 1;
+  int readers = 0;
+  int token_threads = 0;
+};
+
+bool ParseOptions(int argc, char **argv, Options &opts) {
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg(argv[i]);
+    size_t eq = arg.find('=');
+    if (arg.substr(0, 2) != "--" || eq == std::string_view::npos) {
+      return false;
+    }
+    std::string_view key = arg.substr(2, eq - 2);
+    std::string value(arg.substr(eq + 1));
+
+    if (key == "trace") {
+      opts.trace_path = value;
+    } else if (key == "write_trace") {
+      opts.write_trace_path = value;
+    } else if (key == "events") {
+      opts.events = std::stoull(value);
+    } else if (key == "programs") {
+      opts.programs = std::max<size_t>(std::stoull(value), 3);
+    } else if (key == "max_live") {
+      opts.max_live = std::max<size_t>(std::stoull(value), 2);
+    } else if (key == "writers") {
+      opts.writers = std::max(std::stoi(value), 1);
+    } else if (key == "readers") {
+      opts.readers = std::max(std::stoi(value), 0);
+    } else if (key == "token_threads") {
+      opts.token_threads = std::max(std::stoi(value), 0);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Generate a random trace of forks, execs and exits below a single root. Exec
+// targets are skewed towards a few common programs, as on real hosts.
+ptpb::Trace SyntheticTrace(const Options &opts) {
+  std::mt19937_64 rng(42);
+  ptpb::Trace trace;
+  trace.set_root_pid(1);
+  trace.set_root_pidversion(1);
+
+  for (size_t i = 0; i < opts.programs; i++) {
+    ptpb::Trace::Program *prog = trace.add_programs();
+    switch (i) {
+      case 0: prog->set_executable("/bin/sh"); break;
+      case 1: prog->set_executable("/usr/bin/login"); break;
+      case 2: prog->set_executable("/usr/sbin/cron"); break;
+      default: prog->set_executable("/usr/bin/prog" + std::to_string(i));
+    }
+    prog->add_arguments(prog->executable());
+    prog->add_arguments("--arg=" + std::to_string(i));
+  }
+
+  std::vector<std::pair<int32_t, uint64_t>> live = {{1, 1}};
+  int32_t next_pid = 2;
+  uint64_t next_pidversion = 2;
+  uint64_t timestamp = 1;
+
+  for (size_t i = 0; i < opts.events; i++) {
+    size_t idx = rng() % live.size();
+    int roll = rng() % 100;
+    ptpb::Trace::Event *event = trace.add_events();
+    event->set_timestamp(timestamp++);
+    event->set_pid(live[idx].first);
+    event->set_pidversion(live[idx].second);
+
+    // The root only ever forks so that the trace stays connected.
+    if (idx == 0 || (roll < 40 && live.size() < opts.max_live)) {
+      auto *fork = event->mutable_fork();
+      fork->set_child_pid(next_pid++);
+      fork->set_child_pidversion(next_pidversion++);
+      live.push_back({fork->child_pid(), fork->child_pidversion()});
+    } else if (roll < 75) {
+      auto *exec = event->mutable_exec();
+      exec->set_new_pidversion(next_pidversion++);
+      exec->set_program(
+          std::min(rng() % opts.programs, rng() % opts.programs));
+      live[idx].second = exec->new_pidversion();
+    } else {
+      event->mutable_exit();
+      live[idx] = live.back();
+      live.pop_back();
+    }
+  }
+
+  return trace;
+}
+
+struct Replayer {
+  ProcessTree &tree;
+  const ptpb::Trace &trace;
+  std::vector<Program> programs;
+  struct Pid root;
+
+  struct Pid MapPid(int32_t pid, uint64_t pidversion) const {
+    if (pid == trace.root_pid() && pidversion == trace.root_pidversion()) {
+      return root;
+    }
+    return Pid{.pid = pid, .pidversion = pidversion | kTraceVersionBit};
+  }
+
+  struct ReplayCounts {
+    // Calls the tree applied, rather than rejected as duplicates of an event
+    // another writer already applied.
+    uint64_t applied = 0;
+    // Events skipped without calling into the tree.
+    uint64_t skipped = 0;
+  };
+
+  // Replay every event, recording the latency of each tree call.
+  ReplayCounts Replay(std::vector<uint64_t> &latencies) const {
+    ReplayCounts counts;
+    latencies.reserve(trace.events_size());
+    for (const ptpb::Trace::Event &event : trace.events()) {
+      // As with ES events, events for processes unknown to the tree are
+      // ignored.
+      auto proc = tree.Get(MapPid(event.pid(), event.pidversion()));
+      if (!proc) {
+        counts.skipped++;
+        continue;
+      }
+
+      bool applied;
+      Clock::time_point start = Clock::now();
+      switch (event.event_case()) {
+        case ptpb::Trace::Event::kFork:
+          applied = tree.HandleFork(event.timestamp(), **proc,
+                                    MapPid(event.fork().child_pid(),
+                                           event.fork().child_pidversion()));
+          break;
+        case ptpb::Trace::Event::kExec:
+          applied = tree.HandleExec(
+              event.timestamp(), **proc,
+              MapPid(event.pid(), event.exec().new_pidversion()),
+              programs[event.exec().program() % programs.size()],
+              Cred{.uid = event.exec().uid(), .gid = event.exec().gid()});
+          break;
+        case ptpb::Trace::Event::kExit:
+          applied = tree.HandleExit(event.timestamp(), **proc);
+          break;
+        default: counts.skipped++; continue;
+      }
+      latencies.push_back(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                               start)
+              .count());
+      counts.applied += applied;
+    }
+    return counts;
+  }
+
+  // Query random trace processes until done is set. Returns the number of
+  // queries made.
+  uint64_t Read(const std::atomic<bool> &done, uint64_t seed) const {
+    std::mt19937_64 rng(seed);
+    uint64_t ops = 0;
+    while (!done.load(std::memory_order_relaxed)) {
+      const ptpb::Trace::Event &event =
+          trace.events(rng() % trace.events_size());
+      struct Pid pid = MapPid(event.pid(), event.pidversion());
+      if (auto proc = tree.Get(pid); proc) {
+        (void)tree.RootSlice(*proc);
+        (void)tree.ExportAnnotations(pid);
+      }
+      ops++;
+    }
+    return ops;
+  }
+
+  // Create and destroy tokens pinning random trace processes until done is
+  // set. Returns the number of tokens created.
+  uint64_t Tokens(std::shared_ptr<ProcessTree> shared_tree,
+                  const std::atomic<bool> &done, uint64_t seed) const {
+    std::mt19937_64 rng(seed);
+    uint64_t ops = 0;
+    while (!done.load(std::memory_order_relaxed)) {
+      const ptpb::Trace::Event &event =
+          trace.events(rng() % trace.events_size());
+      ProcessToken token(shared_tree,
+                         {MapPid(event.pid(), event.pidversion()), root});
+      ops++;
+    }
+    return ops;
+  }
+};
+
+uint64_t Percentile(std::vector<uint64_t> &sorted, double pct) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  return sorted[std::min(sorted.size() - 1,
+                         static_cast<size_t>(pct * sorted.size()))];
+}
+
+long PeakRSSKiB() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;  // bytes on macOS
+#else
+  return usage.ru_maxrss;  // KiB on Linux
+#endif
+}
+
+}  // namespace
+}  // namespace santa::santad::process_tree
+
+using namespace santa::santad::process_tree;
+
+int main(int argc, char **argv) {
+  Options opts;
+  if (!ParseOptions(argc, argv, opts)) {
+    fprintf(stderr,
+            "Usage: %s [--trace=PATH] [--write_trace=PATH] [--events=N] "
+            "[--programs=N] [--max_live=N] [--writers=N] [--readers=N] "
+            "[--token_threads=N]\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  ptpb::Trace trace;
+  if (!opts.trace_path.empty()) {
+    std::ifstream in(opts.trace_path, std::ios::binary);
+    if (!trace.ParseFromIstream(&in)) {
+      fprintf(stderr, "Failed to read trace: %s\n", opts.trace_path.c_str());
+      return EXIT_FAILURE;
+    }
+  } else {
+    trace = SyntheticTrace(opts);
+  }
+
+  if (!opts.write_trace_path.empty()) {
+    std::ofstream out(opts.write_trace_path, std::ios::binary);
+    if (!trace.SerializeToOstream(&out)) {
+      fprintf(stderr, "Failed to write trace: %s\n",
+              opts.write_trace_path.c_str());
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (trace.events_size() == 0 || trace.programs_size() == 0) {
+    fprintf(stderr, "Trace has no events or programs\n");
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::unique_ptr<Annotator>> annotators;
+  annotators.emplace_back(std::make_unique<OriginatorAnnotator>());
+
+  Clock::time_point backfill_start = Clock::now();
+  auto tree_status = CreateTree(std::move(annotators));
+  if (!tree_status.ok()) {
+    fprintf(stderr, "Failed to create tree: %s\n",
+            tree_status.status().ToString().c_str());
+    return EXIT_FAILURE;
+  }
+  std::shared_ptr<ProcessTree> tree = *tree_status;
+  double backfill_secs =
+      std::chrono::duration<double>(Clock::now() - backfill_start).count();
+
+  size_t backfilled = 0;
+  tree->Iterate([&backfilled](auto) { backfilled++; });
+  printf("backfill: %zu processes in %.3fs\n", backfilled, backfill_secs);
+
+  auto self = LoadPID(getpid());
+  if (!self.ok() || !tree->Get(self->pid_)) {
+    fprintf(stderr, "Benchmark process is missing from the tree\n");
+    return EXIT_FAILURE;
+  }
+
+  Replayer replayer{.tree = *tree, .trace = trace, .root = self->pid_};
+  for (const ptpb::Trace::Program &prog : trace.programs()) {
+    replayer.programs.push_back(Program{
+        .executable = prog.executable(),
+        .arguments = {prog.arguments().begin(), prog.arguments().end()},
+    });
+  }
+
+  std::atomic<bool> done = false;
+  std::vector<uint64_t> reader_ops(opts.readers);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < opts.readers; i++) {
+    readers.emplace_back(
+        [&, i] { reader_ops[i] = replayer.Read(done, /*seed=*/i); });
+  }
+  std::vector<uint64_t> token_ops(opts.token_threads);
+  std::vector<std::thread> token_threads;
+  for (int i = 0; i < opts.token_threads; i++) {
+    token_threads.emplace_back([&, i] {
+      token_ops[i] = replayer.Tokens(tree, done, /*seed=*/1000 + i);
+    });
+  }
+
+  std::vector<std::vector<uint64_t>> latencies(opts.writers);
+  std::vector<Replayer::ReplayCounts> counts(opts.writers);
+  Clock::time_point replay_start = Clock::now();
+  std::vector<std::thread> writers;
+  for (int i = 0; i < opts.writers; i++) {
+    writers.emplace_back(
+        [&, i] { counts[i] = replayer.Replay(latencies[i]); });
+  }
+  for (auto &t : writers) {
+    t.join();
+  }
+  double replay_secs =
+      std::chrono::duration<double>(Clock::now() - replay_start).count();
+
+  done = true;
+  for (auto &t : readers) {
+    t.join();
+  }
+  for (auto &t : token_threads) {
+    t.join();
+  }
+
+  // Every tree call recorded one latency sample.
+  std::vector<uint64_t> all_latencies;
+  for (auto &l : latencies) {
+    all_latencies.insert(all_latencies.end(), l.begin(), l.end());
+  }
+  std::sort(all_latencies.begin(), all_latencies.end());
+
+  // With several writers, most calls are duplicates of an event another
+  // writer already applied, so distinct events and tree calls are reported
+  // separately.
+  uint64_t applied_events = 0;
+  uint64_t skipped_events = 0;
+  for (const Replayer::ReplayCounts &c : counts) {
+    applied_events += c.applied;
+    skipped_events += c.skipped;
+  }
+  uint64_t calls = all_latencies.size();
+  printf("replay: %llu events applied, %llu skipped (%d writers) in %.3fs, "
+         "%.0f events/sec\n",
+         (unsigned long long)applied_events,
+         (unsigned long long)skipped_events, opts.writers, replay_secs,
+         applied_events / replay_secs);
+  printf("calls: %llu tree calls, %llu duplicates, %.0f calls/sec\n",
+         (unsigned long long)calls,
+         (unsigned long long)(calls - applied_events), calls / replay_secs);
+  printf("latency: p50=%lluns p99=%lluns (%zu calls)\n",
+         (unsigned long long)Percentile(all_latencies, 0.50),
+         (unsigned long long)Percentile(all_latencies, 0.99),
+         all_latencies.size());
+
+  if (opts.readers > 0) {
+    uint64_t total_reads = 0;
+    for (uint64_t ops : reader_ops) {
+      total_reads += ops;
+    }
+    printf("readers: %llu queries (%d readers), %.0f queries/sec\n",
+           (unsigned long long)total_reads, opts.readers,
+           total_reads / replay_secs);
+  }
+
+  if (opts.token_threads > 0) {
+    uint64_t total_tokens = 0;
+    for (uint64_t ops : token_ops) {
+      total_tokens += ops;
+    }
+    printf("tokens: %llu tokens (%d threads), %.0f tokens/sec\n",
+           (unsigned long long)total_tokens, opts.token_threads,
+           total_tokens / replay_secs);
+  }
+
+  size_t remaining = 0;
+  tree->Iterate([&remaining](auto) { remaining++; });
+  ProcessTree::Stats stats = tree->GetStats();
+  printf("tree: %zu processes, %zu programs (%zu bytes)\n", remaining,
+         stats.programs, stats.program_bytes);
+  printf("peak rss: %ld KiB\n", PeakRSSKiB());
+
+  return EXIT_SUCCESS;
+}
@@ -15,17 +15,20 @@
 
 #import <Foundation/Foundation.h>
 #include <bsm/libbsm.h>
+#include <errno.h>
 #include <libproc.h>
 #include <mach/message.h>
+#include <signal.h>
 #include <string.h>
 #include <sys/sysctl.h>
 
 #include <memory>
+#include <optional>
+#include <utility>
 #include <vector>
 
 #include "Source/common/SystemResources.h"
 #include "Source/santad/ProcessTree/process.h"
-#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 
@@ -138,37 +141,46 @@ absl::StatusOr<Process> LoadPID(pid_t pid) {
                  nullptr);
 }
 
-absl::Status ProcessTree::Backfill() {
-  std::optional<std::vector<pid_t>> pid_list = GetPidList();
-  if (!pid_list.has_value()) {
-    return absl::InternalError("GetPidList() failed");
+bool ProcessTree::IsLive(const struct Pid &pid) {
+  task_name_t task;
+  mach_msg_type_number_t size = TASK_AUDIT_TOKEN_COUNT;
+  audit_token_t token;
+
+  // Without a task name port the pidversion can't be checked, so fall back to
+  // whether the pid exists at all.
+  if (task_name_for_pid(mach_task_self(), pid.pid, &task) != KERN_SUCCESS) {
+    return kill(pid.pid, 0) == 0 || errno == EPERM;
   }
 
-  absl::flat_hash_map<pid_t, std::vector<Process>> parent_map;
-  for (pid_t pid : pid_list.value()) {
-    auto proc_status = LoadPID(pid);
-    if (proc_status.ok()) {
-      auto unlinked_proc = proc_status.value();
-
-      // Determine ppid
-      // Alternatively, there's a sysctl interface:
-      //  https://chromium.googlesource.com/chromium/chromium/+/master/base/process_util_openbsd.cc#32
-      struct proc_bsdinfo bsdinfo;
-      if (proc_pidinfo(pid, PROC_PIDTBSDINFO, 0, &bsdinfo, sizeof(bsdinfo)) !=
-          PROC_PIDTBSDINFO_SIZE) {
-        continue;
-      };
-
-      parent_map[bsdinfo.pbi_ppid].push_back(unlinked_proc);
-    }
+  kern_return_t kr = task_info(task, TASK_AUDIT_TOKEN, (task_info_t)&token, &size);
+  mach_port_deallocate(mach_task_self(), task);
+  if (kr != KERN_SUCCESS) {
+    return kill(pid.pid, 0) == 0 || errno == EPERM;
+  }
+
+  return PidFromAuditToken(token) == pid;
+}
+
+std::optional<std::vector<pid_t>> ProcessTree::BackfillListPids() {
+  return GetPidList();
+}
+
+absl::StatusOr<ProcessTree::BackfillEntry> ProcessTree::BackfillLoad(pid_t pid) {
+  auto proc_status = LoadPID(pid);
+  if (!proc_status.ok()) {
+    return proc_status.status();
   }
 
-  auto &roots = parent_map[0];
-  for (const Process &p : roots) {
-    BackfillInsertChildren(parent_map, std::shared_ptr<Process>(), p);
+  // Determine ppid
+  // Alternatively, there's a sysctl interface:
+  //  https://chromium.googlesource.com/chromium/chromium/+/master/base/process_util_openbsd.cc#32
+  struct proc_bsdinfo bsdinfo;
+  if (proc_pidinfo(pid, PROC_PIDTBSDINFO, 0, &bsdinfo, sizeof(bsdinfo)) !=
+      PROC_PIDTBSDINFO_SIZE) {
+    return absl::NotFoundError("proc_pidinfo failed");
   }
 
-  return absl::OkStatus();
+  return BackfillEntry{.proc = *std::move(proc_status), .ppid = (pid_t)bsdinfo.pbi_ppid};
 }
 
 }  // namespace santa::santad::process_tree
@@ -15,13 +15,18 @@
 #import <XCTest/XCTest.h>
 
 #include <bsm/libbsm.h>
+#include <sys/stat.h>
 
+#include <algorithm>
 #include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "Source/santad/ProcessTree/annotations/annotator.h"
 #include "Source/santad/ProcessTree/process.h"
 #include "Source/santad/ProcessTree/process_tree_test_helpers.h"
+#include "absl/status/status.h"
 #include "absl/synchronization/mutex.h"
 
 namespace ptpb = ::santa::pb::v1::process_tree;
@@ -61,6 +66,23 @@ void TestAnnotator::AnnotateExec(ProcessTree &tree, const Process &orig_process,
 std::optional<::ptpb::Annotations> TestAnnotator::Proto() const {
   return std::nullopt;
 }
+
+class OtherAnnotator : public Annotator {
+ public:
+  void AnnotateFork(ProcessTree &tree, const Process &parent, const Process &child) override {}
+  void AnnotateExec(ProcessTree &tree, const Process &orig_process,
+                    const Process &new_process) override {}
+  std::optional<::ptpb::Annotations> Proto() const override { return std::nullopt; }
+};
+
+template <int N>
+class NumberedAnnotator : public Annotator {
+ public:
+  void AnnotateFork(ProcessTree &tree, const Process &parent, const Process &child) override {}
+  void AnnotateExec(ProcessTree &tree, const Process &orig_process,
+                    const Process &new_process) override {}
+  std::optional<::ptpb::Annotations> Proto() const override { return std::nullopt; }
+};
 }  // namespace santa::santad::process_tree
 
 using namespace santa::santad::process_tree;
@@ -173,6 +195,90 @@ using namespace santa::santad::process_tree;
   XCTAssertTrue(annotation.has_value());
 }
 
+- (void)testAnnotationFromUnregisteredAnnotator {
+  std::vector<std::unique_ptr<Annotator>> annotators{};
+  annotators.emplace_back(std::make_unique<TestAnnotator>());
+  self.tree = std::make_shared<ProcessTreeTestPeer>(std::move(annotators));
+  self.initProc = self.tree->InsertInit();
+
+  // Annotations are only stored for annotator types registered with the tree.
+  self.tree->AnnotateProcess(*self.initProc, std::make_shared<OtherAnnotator>());
+  XCTAssertFalse(self.tree->GetAnnotation<OtherAnnotator>(*self.initProc).has_value());
+  XCTAssertFalse(self.tree->ExportAnnotations(self.initProc->pid_).has_value());
+
+  self.tree->AnnotateProcess(*self.initProc, std::make_shared<TestAnnotator>());
+  XCTAssertTrue(self.tree->GetAnnotation<TestAnnotator>(*self.initProc).has_value());
+}
+
+- (void)testAnnotationSlotsPerTree {
+  // Slots are assigned per tree, so trees may together use more annotator
+  // types than a single tree can hold.
+  std::vector<std::unique_ptr<Annotator>> first{};
+  first.emplace_back(std::make_unique<NumberedAnnotator<0>>());
+  first.emplace_back(std::make_unique<NumberedAnnotator<1>>());
+  first.emplace_back(std::make_unique<NumberedAnnotator<2>>());
+  first.emplace_back(std::make_unique<NumberedAnnotator<3>>());
+  auto firstTree = std::make_shared<ProcessTreeTestPeer>(std::move(first));
+  auto firstInit = firstTree->InsertInit();
+
+  std::vector<std::unique_ptr<Annotator>> second{};
+  second.emplace_back(std::make_unique<NumberedAnnotator<4>>());
+  second.emplace_back(std::make_unique<NumberedAnnotator<0>>());
+  auto secondTree = std::make_shared<ProcessTreeTestPeer>(std::move(second));
+  auto secondInit = secondTree->InsertInit();
+
+  firstTree->AnnotateProcess(*firstInit, std::make_shared<NumberedAnnotator<3>>());
+  secondTree->AnnotateProcess(*secondInit, std::make_shared<NumberedAnnotator<4>>());
+  secondTree->AnnotateProcess(*secondInit, std::make_shared<NumberedAnnotator<0>>());
+
+  XCTAssertTrue(firstTree->GetAnnotation<NumberedAnnotator<3>>(*firstInit).has_value());
+  XCTAssertFalse(firstTree->GetAnnotation<NumberedAnnotator<0>>(*firstInit).has_value());
+  XCTAssertFalse(firstTree->GetAnnotation<NumberedAnnotator<4>>(*firstInit).has_value());
+  XCTAssertTrue(secondTree->GetAnnotation<NumberedAnnotator<4>>(*secondInit).has_value());
+  XCTAssertTrue(secondTree->GetAnnotation<NumberedAnnotator<0>>(*secondInit).has_value());
+  XCTAssertFalse(secondTree->GetAnnotation<NumberedAnnotator<3>>(*secondInit).has_value());
+
+  std::vector<std::unique_ptr<Annotator>> tooMany{};
+  tooMany.emplace_back(std::make_unique<NumberedAnnotator<0>>());
+  tooMany.emplace_back(std::make_unique<NumberedAnnotator<1>>());
+  tooMany.emplace_back(std::make_unique<NumberedAnnotator<2>>());
+  tooMany.emplace_back(std::make_unique<NumberedAnnotator<3>>());
+  tooMany.emplace_back(std::make_unique<NumberedAnnotator<4>>());
+  auto status = CreateTree(std::move(tooMany));
+  XCTAssertFalse(status.ok());
+  XCTAssertEqual(status.status().code(), absl::StatusCode::kInvalidArgument);
+}
+
+- (void)testRootSlice {
+  uint64_t event_id = 1;
+  const struct Cred cred = {.uid = 0, .gid = 0};
+
+  // PID 1.1: fork() -> PID 2.2: fork() -> PID 3.3: exec() -> PID 3.4
+  const struct Pid shell_pid = {.pid = 2, .pidversion = 2};
+  self.tree->HandleFork(event_id++, *self.initProc, shell_pid);
+  const struct Pid child_pid = {.pid = 3, .pidversion = 3};
+  self.tree->HandleFork(event_id++, **self.tree->Get(shell_pid), child_pid);
+  const struct Pid child_exec_pid = {.pid = 3, .pidversion = 4};
+  self.tree->HandleExec(event_id++, **self.tree->Get(child_pid), child_exec_pid,
+                        {.executable = "/bin/ls", .arguments = {}}, cred);
+
+  auto child = *self.tree->Get(child_exec_pid);
+  AncestryView slice = self.tree->RootSlice(child);
+  XCTAssertEqual(slice.size(), 3);
+  XCTAssertEqual(&slice.front(), child.get());
+
+  // The exec'd process replaces its pre-exec self in the lineage.
+  std::vector<struct Pid> lineage;
+  for (const Process &p : slice) {
+    lineage.push_back(p.pid_);
+  }
+  XCTAssertTrue(lineage == (std::vector<struct Pid>{child_exec_pid, shell_pid, self.initProc->pid_}));
+
+  // The view keeps the chain alive after the processes leave the tree.
+  self.tree = nullptr;
+  XCTAssertEqual(std::distance(slice.begin(), slice.end()), 3);
+}
+
 - (void)testCleanup {
   uint64_t event_id = 1;
   const struct Pid child_pid = {.pid = 2, .pidversion = 2};
@@ -203,6 +309,160 @@ using namespace santa::santad::process_tree;
   }
 }
 
+- (void)testDuplicateEvents {
+  const struct Pid child_pid = {.pid = 2, .pidversion = 2};
+  const struct Pid dup_pid = {.pid = 3, .pidversion = 3};
+  XCTAssertTrue(self.tree->HandleFork(10, *self.initProc, child_pid));
+
+  // An event with the same timestamp as the most recent one is not reprocessed...
+  XCTAssertFalse(self.tree->HandleFork(10, *self.initProc, dup_pid));
+  XCTAssertFalse(self.tree->Get(dup_pid).has_value());
+
+  // ... but an earlier, unseen timestamp within the window still is.
+  XCTAssertTrue(self.tree->HandleFork(5, *self.initProc, dup_pid));
+  XCTAssertTrue(self.tree->Get(dup_pid).has_value());
+}
+
+- (void)testConfigurableDedupeWindow {
+  static constexpr size_t kWindow = 4;
+  std::vector<std::unique_ptr<Annotator>> annotators{};
+  self.tree = std::make_shared<ProcessTreeTestPeer>(std::move(annotators), kWindow);
+  self.initProc = self.tree->InsertInit();
+
+  uint64_t event_id = 1;
+  const struct Pid child_pid = {.pid = 2, .pidversion = 2};
+  self.tree->HandleFork(event_id++, *self.initProc, child_pid);
+  self.tree->HandleExit(event_id++, **self.tree->Get(child_pid));
+
+  struct Pid churn_pid = {.pid = 3, .pidversion = 3};
+  for (size_t i = 0; i < kWindow; i++) {
+    self.tree->HandleFork(event_id++, *self.initProc, churn_pid);
+    churn_pid.pid++;
+  }
+  XCTAssertTrue(self.tree->Get(child_pid).has_value());
+
+  // The exit has now fallen out of the window.
+  self.tree->HandleFork(event_id++, *self.initProc, churn_pid);
+  XCTAssertFalse(self.tree->Get(child_pid).has_value());
+
+  // Timestamps older than the window are never reprocessed.
+  const struct Pid stale_pid = {.pid = 100, .pidversion = 100};
+  self.tree->HandleFork(1, *self.initProc, stale_pid);
+  XCTAssertFalse(self.tree->Get(stale_pid).has_value());
+}
+
+- (void)testProgramInterning {
+  uint64_t event_id = 1;
+  const struct Program prog = {.executable = "/bin/sh", .arguments = {"/bin/sh", "-c", "true"}};
+  const struct Cred cred = {.uid = 0, .gid = 0};
+
+  // Two unrelated processes exec the same program...
+  const struct Pid a_pid = {.pid = 2, .pidversion = 2};
+  const struct Pid b_pid = {.pid = 3, .pidversion = 3};
+  self.tree->HandleFork(event_id++, *self.initProc, a_pid);
+  self.tree->HandleFork(event_id++, *self.initProc, b_pid);
+
+  const struct Pid a_exec_pid = {.pid = 2, .pidversion = 4};
+  const struct Pid b_exec_pid = {.pid = 3, .pidversion = 5};
+  self.tree->HandleExec(event_id++, **self.tree->Get(a_pid), a_exec_pid, prog, cred);
+  self.tree->HandleExec(event_id++, **self.tree->Get(b_pid), b_exec_pid, prog, cred);
+
+  // ... and share a single Program instance.
+  auto a = *self.tree->Get(a_exec_pid);
+  auto b = *self.tree->Get(b_exec_pid);
+  XCTAssertEqual(a->program_, b->program_);
+  XCTAssertEqual(*a->program_, prog);
+
+  ProcessTree::Stats stats = self.tree->GetStats();
+  XCTAssertEqual(stats.programs, 1);
+  XCTAssertGreaterThan(stats.program_bytes, 0);
+}
+
+- (void)testChildrenAndDescendants {
+  uint64_t event_id = 1;
+  const struct Cred cred = {.uid = 0, .gid = 0};
+
+  // Wide: init forks several children.
+  static constexpr int kWidth = 8;
+  for (int i = 0; i < kWidth; i++) {
+    const struct Pid pid = {.pid = 100 + i, .pidversion = (uint64_t)(100 + i)};
+    self.tree->HandleFork(event_id++, *self.initProc, pid);
+  }
+  XCTAssertEqual(self.tree->Children(self.initProc->pid_).size(), kWidth);
+
+  // Deep: a chain of processes below the first child.
+  static constexpr int kDepth = 16;
+  struct Pid parent_pid = {.pid = 100, .pidversion = 100};
+  for (int i = 0; i < kDepth; i++) {
+    const struct Pid pid = {.pid = 200 + i, .pidversion = (uint64_t)(200 + i)};
+    self.tree->HandleFork(event_id++, **self.tree->Get(parent_pid), pid);
+    parent_pid = pid;
+  }
+  XCTAssertEqual(self.tree->Children({.pid = 100, .pidversion = 100}).size(), 1);
+  XCTAssertEqual(self.tree->Descendants({.pid = 100, .pidversion = 100}).size(), kDepth);
+  XCTAssertEqual(self.tree->Descendants(self.initProc->pid_).size(), kWidth + kDepth);
+
+  // An exec'd process is a child of its original parent, and the pre-exec
+  // version is dropped once the exec falls out of the event window.
+  const struct Pid exec_pid = {.pid = 101, .pidversion = 1000};
+  self.tree->HandleExec(event_id++, **self.tree->Get({.pid = 101, .pidversion = 101}), exec_pid,
+                        {.executable = "/bin/sh", .arguments = {}}, cred);
+  for (int i = 0; i < 32; i++) {
+    const struct Pid pid = {.pid = 300 + i, .pidversion = (uint64_t)(300 + i)};
+    self.tree->HandleFork(event_id++, **self.tree->Get(exec_pid), pid);
+  }
+  XCTAssertEqual(self.tree->Children(exec_pid).size(), 32);
+
+  self.tree->HandleFork(event_id++, **self.tree->Get(exec_pid), {.pid = 400, .pidversion = 400});
+  auto children = self.tree->Children(self.initProc->pid_);
+  XCTAssertEqual(children.size(), kWidth);
+  XCTAssertTrue(std::any_of(children.begin(), children.end(),
+                            [&](const auto &child) { return child->pid_ == exec_pid; }));
+}
+
+- (void)testBackfillInsert {
+  std::vector<std::unique_ptr<Annotator>> annotators{};
+  annotators.emplace_back(std::make_unique<TestAnnotator>());
+  self.tree = std::make_shared<ProcessTreeTestPeer>(std::move(annotators));
+
+  const struct Cred cred = {.uid = 0, .gid = 0};
+  auto make_proc = [&](int pid, std::string executable) {
+    return Process({.pid = pid, .pidversion = (uint64_t)pid}, cred,
+                   std::make_shared<Program>((Program){.executable = executable, .arguments = {}}),
+                   nullptr);
+  };
+
+  // Entries arrive in pid order rather than tree order, and may reference
+  // parents that exited mid-scan.
+  std::vector<std::pair<Process, pid_t>> procs;
+  procs.emplace_back(make_proc(4, "/bin/zsh"), 3);
+  procs.emplace_back(make_proc(1, "/sbin/launchd"), 0);
+  procs.emplace_back(make_proc(3, std::string(kAnnotatedExecutable)), 2);
+  procs.emplace_back(make_proc(2, "/bin/sh"), 1);
+  procs.emplace_back(make_proc(5, "/bin/zsh"), 3);
+  procs.emplace_back(make_proc(6, "/bin/orphan"), 99);
+  procs.emplace_back(make_proc(7, "/bin/self"), 7);
+  self.tree->InsertBackfill(std::move(procs));
+
+  size_t count = 0;
+  self.tree->Iterate([&count](auto) { count++; });
+  XCTAssertEqual(count, 5);
+  XCTAssertFalse(self.tree->Get({.pid = 6, .pidversion = 6}).has_value());
+  XCTAssertFalse(self.tree->Get({.pid = 7, .pidversion = 7}).has_value());
+
+  XCTAssertEqual(self.tree->Children({.pid = 3, .pidversion = 3}).size(), 2);
+  XCTAssertEqual(self.tree->Descendants({.pid = 1, .pidversion = 1}).size(), 4);
+
+  // Annotations are applied top down, reaching every descendant of login.
+  XCTAssertFalse(
+      self.tree->GetAnnotation<TestAnnotator>(**self.tree->Get({.pid = 2, .pidversion = 2}))
+          .has_value());
+  for (int pid : {3, 4, 5}) {
+    auto proc = *self.tree->Get({.pid = pid, .pidversion = (uint64_t)pid});
+    XCTAssertTrue(self.tree->GetAnnotation<TestAnnotator>(*proc).has_value());
+  }
+}
+
 - (void)testRefcountCleanup {
   uint64_t event_id = 1;
   const struct Pid child_pid = {.pid = 2, .pidversion = 2};
@@ -243,4 +503,192 @@ using namespace santa::santad::process_tree;
   }
 }
 
+- (void)testProcessTokenConcurrentRetain {
+  uint64_t event_id = 1;
+  const struct Pid child_pid = {.pid = 2, .pidversion = 2};
+  self.tree->HandleFork(event_id++, *self.initProc, child_pid);
+
+  // Many tokens pinning the same pids concurrently, as when several ES clients
+  // handle events for the same process.
+  std::vector<std::optional<ProcessToken>> tokens(64);
+  auto *tokens_ptr = &tokens;
+  dispatch_apply(tokens.size(), DISPATCH_APPLY_AUTO, ^(size_t i) {
+    (*tokens_ptr)[i].emplace(self.tree, std::vector<struct Pid>{self.initProc->pid_, child_pid});
+  });
+
+  self.tree->HandleExit(event_id++, **self.tree->Get(child_pid));
+  for (int i = 0; i < 64; i++) {
+    struct Pid churn_pid = {.pid = 100 + i, .pidversion = (uint64_t)(100 + i)};
+    self.tree->HandleFork(event_id++, *self.initProc, churn_pid);
+  }
+
+  // Released concurrently, the exited child is only removed with the last
+  // token.
+  dispatch_apply(tokens.size() - 1, DISPATCH_APPLY_AUTO, ^(size_t i) {
+    (*tokens_ptr)[i].reset();
+  });
+  XCTAssertTrue(self.tree->Get(child_pid).has_value());
+
+  tokens.back().reset();
+  XCTAssertFalse(self.tree->Get(child_pid).has_value());
+  XCTAssertTrue(self.tree->Get(self.initProc->pid_).has_value());
+}
+
+- (void)testProcessTokenAssignment {
+  uint64_t event_id = 1;
+  const struct Pid first_pid = {.pid = 2, .pidversion = 2};
+  const struct Pid second_pid = {.pid = 3, .pidversion = 3};
+  self.tree->HandleFork(event_id++, *self.initProc, first_pid);
+  self.tree->HandleFork(event_id++, *self.initProc, second_pid);
+
+  ProcessToken token(self.tree, {first_pid});
+  ProcessToken other(self.tree, {second_pid});
+  self.tree->HandleExit(event_id++, **self.tree->Get(first_pid));
+  self.tree->HandleExit(event_id++, **self.tree->Get(second_pid));
+  for (int i = 0; i < 64; i++) {
+    struct Pid churn_pid = {.pid = 100 + i, .pidversion = (uint64_t)(100 + i)};
+    self.tree->HandleFork(event_id++, *self.initProc, churn_pid);
+  }
+  XCTAssertTrue(self.tree->Get(first_pid).has_value());
+  XCTAssertTrue(self.tree->Get(second_pid).has_value());
+
+  // Assigning over a live token releases the pids it held.
+  token = other;
+  XCTAssertFalse(self.tree->Get(first_pid).has_value());
+  XCTAssertTrue(self.tree->Get(second_pid).has_value());
+
+  // Moved-from tokens release nothing, so the pids are only released once.
+  ProcessToken moved(std::move(other));
+  token = std::move(moved);
+  XCTAssertTrue(self.tree->Get(second_pid).has_value());
+
+  token = ProcessToken(self.tree, {});
+  XCTAssertFalse(self.tree->Get(second_pid).has_value());
+}
+
+- (void)testReconcile {
+  uint64_t event_id = 1;
+  // The pidversion will not match the live process with this pid.
+  const struct Pid stale_pid = {.pid = getpid(), .pidversion = 1};
+  self.tree->HandleFork(event_id++, *self.initProc, stale_pid);
+  const struct Pid self_pid = LoadPID(getpid())->pid_;
+  self.tree->HandleFork(event_id++, *self.initProc, self_pid);
+
+  // Dead processes get a grace period of one pass...
+  self.tree->Reconcile();
+  XCTAssertTrue(self.tree->Get(stale_pid).has_value());
+
+  // ... and are then evicted, even if they were never removed. Live processes
+  // are left alone.
+  size_t evicted = self.tree->Reconcile();
+  XCTAssertGreaterThan(evicted, 0);
+  XCTAssertEqual(self.tree->GetStats().evictions, evicted);
+  XCTAssertFalse(self.tree->Get(stale_pid).has_value());
+  XCTAssertTrue(self.tree->Get(self_pid).has_value());
+}
+
+- (void)testReconcileRetained {
+  uint64_t event_id = 1;
+  const struct Pid stale_pid = {.pid = getpid(), .pidversion = 1};
+  self.tree->HandleFork(event_id++, *self.initProc, stale_pid);
+  self.tree->RetainProcess({stale_pid});
+
+  // A retained process is only tombstoned by eviction...
+  self.tree->Reconcile();
+  self.tree->Reconcile();
+  XCTAssertTrue(self.tree->Get(stale_pid).has_value());
+  XCTAssertEqual(self.tree->GetStats().tombstones, 1);
+
+  // ... and erased with its last reference.
+  self.tree->ReleaseProcess({stale_pid});
+  XCTAssertFalse(self.tree->Get(stale_pid).has_value());
+}
+
+- (void)testReconcileLeakedRetain {
+  uint64_t event_id = 1;
+  const struct Pid stale_pid = {.pid = getpid(), .pidversion = 1};
+  self.tree->HandleFork(event_id++, *self.initProc, stale_pid);
+  // The token is never released.
+  auto leaked = std::make_unique<ProcessToken>(self.tree, std::vector<struct Pid>{stale_pid});
+
+  for (size_t i = 1; i < ProcessTree::kLeakedRetainPasses; i++) {
+    self.tree->Reconcile();
+    XCTAssertTrue(self.tree->Get(stale_pid).has_value());
+  }
+
+  // Once the retain is deemed leaked, the process is erased anyway...
+  self.tree->Reconcile();
+  XCTAssertFalse(self.tree->Get(stale_pid).has_value());
+  XCTAssertEqual(self.tree->GetStats().tombstones, 0);
+
+  // ... and a late release finds nothing to release.
+  leaked.reset();
+  XCTAssertFalse(self.tree->Get(stale_pid).has_value());
+}
+
+- (void)testReconcileOverBudget {
+  std::vector<std::unique_ptr<Annotator>> annotators{};
+  self.tree = std::make_shared<ProcessTreeTestPeer>(
+      std::move(annotators), ProcessTree::kDefaultDedupeWindow, /*max_processes=*/1);
+  self.initProc = self.tree->InsertInit();
+
+  uint64_t event_id = 1;
+  const struct Pid stale_pid = {.pid = getpid(), .pidversion = 1};
+  self.tree->HandleFork(event_id++, *self.initProc, stale_pid);
+
+  // Dead processes keep their grace period while the tree is over budget.
+  XCTAssertEqual(self.tree->Reconcile(), 0);
+  XCTAssertTrue(self.tree->Get(stale_pid).has_value());
+  XCTAssertTrue(self.tree->OverBudget());
+
+  XCTAssertGreaterThan(self.tree->Reconcile(), 0);
+  XCTAssertFalse(self.tree->Get(stale_pid).has_value());
+  XCTAssertFalse(self.tree->OverBudget());
+}
+
+- (void)testSnapshot {
+  std::vector<std::unique_ptr<Annotator>> annotators{};
+  annotators.emplace_back(std::make_unique<TestAnnotator>());
+  self.tree = std::make_shared<ProcessTreeTestPeer>(std::move(annotators));
+  self.initProc = self.tree->InsertInit();
+
+  uint64_t event_id = 1;
+  const struct Cred cred = {.uid = 0, .gid = 0};
+  const struct Pid login_pid = {.pid = 2, .pidversion = 2};
+  self.tree->HandleFork(event_id++, *self.initProc, login_pid);
+  const struct Pid login_exec_pid = {.pid = 2, .pidversion = 3};
+  self.tree->HandleExec(event_id++, **self.tree->Get(login_pid), login_exec_pid,
+                        {.executable = std::string(kAnnotatedExecutable), .arguments = {}}, cred);
+  const struct Pid shell_pid = {.pid = 3, .pidversion = 3};
+  self.tree->HandleFork(event_id++, **self.tree->Get(login_exec_pid), shell_pid);
+
+  ptpb::Snapshot snapshot = self.tree->ExportSnapshot();
+  XCTAssertEqual(snapshot.processes_size(), 4);
+  // The forked shell shares login's program.
+  XCTAssertEqual(snapshot.programs_size(), 2);
+
+  for (const auto &proc : snapshot.processes()) {
+    if (proc.pid() == shell_pid.pid) {
+      XCTAssertEqual(proc.parent_pid(), login_exec_pid.pid);
+      XCTAssertEqual(proc.parent_pidversion(), login_exec_pid.pidversion);
+      XCTAssertEqual(snapshot.programs(proc.program()).executable(), kAnnotatedExecutable);
+    }
+  }
+
+  NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+  XCTAssertTrue(WriteSnapshot(snapshot, path.UTF8String).ok());
+  // Snapshots contain process arguments and must only be readable by the owner
+  struct stat sb;
+  XCTAssertEqual(stat(path.UTF8String, &sb), 0);
+  XCTAssertEqual(sb.st_mode & 0777, 0600);
+  // Rewriting replaces the previous snapshot
+  XCTAssertTrue(WriteSnapshot(snapshot, path.UTF8String).ok());
+  auto read = ReadSnapshot(path.UTF8String);
+  XCTAssertTrue(read.ok());
+  XCTAssertEqual(read->SerializeAsString(), snapshot.SerializeAsString());
+  [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+
+  XCTAssertTrue(absl::IsNotFound(ReadSnapshot(path.UTF8String).status()));
+}
+
 @end
@@ -14,6 +14,8 @@
 #ifndef SANTA__SANTAD_PROCESSTREE_TREE_TEST_HELPERS_H
 #define SANTA__SANTAD_PROCESSTREE_TREE_TEST_HELPERS_H
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "Source/santad/ProcessTree/process_tree.h"
 
@@ -22,9 +24,13 @@ namespace santa::santad::process_tree {
 class ProcessTreeTestPeer : public ProcessTree {
  public:
   explicit ProcessTreeTestPeer(
-      std::vector<std::unique_ptr<Annotator>> &&annotators)
-      : ProcessTree(std::move(annotators)) {}
+      std::vector<std::unique_ptr<Annotator>> &&annotators,
+      size_t dedupe_window = kDefaultDedupeWindow,
+      size_t max_processes = kDefaultMaxProcesses)
+      : ProcessTree(std::move(annotators), dedupe_window, max_processes) {}
   std::shared_ptr<const Process> InsertInit();
+  // Insert (process, ppid) pairs as if discovered by Backfill.
+  void InsertBackfill(std::vector<std::pair<Process, pid_t>> procs);
 };
 
 }  // namespace santa::santad::process_tree
@@ -15,6 +15,8 @@
 
 #include <memory>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include "Source/santad/ProcessTree/process.h"
 #include "Source/santad/ProcessTree/process_tree.h"
@@ -24,19 +26,29 @@ namespace santa::santad::process_tree {
 class ProcessTreeTestPeer : public ProcessTree {
  public:
   std::shared_ptr<const Process> InsertInit();
+  void InsertBackfill(std::vector<std::pair<Process, pid_t>> procs);
 };
 
 std::shared_ptr<const Process> ProcessTreeTestPeer::InsertInit() {
-  absl::MutexLock lock(&mtx_);
   struct Pid initpid = {
       .pid = 1,
       .pidversion = 1,
   };
+  MapShard &shard = ShardFor(initpid.pid);
+  absl::MutexLock lock(&shard.mtx);
   auto proc = std::make_shared<Process>(
       initpid, (Cred){.uid = 0, .gid = 0},
       std::make_shared<Program>((Program){.executable = "/init", .arguments = {"/init"}}), nullptr);
-  map_.emplace(initpid, proc);
+  shard.map.emplace(initpid, proc);
   return proc;
 }
 
+void ProcessTreeTestPeer::InsertBackfill(std::vector<std::pair<Process, pid_t>> procs) {
+  std::vector<std::optional<BackfillEntry>> entries;
+  for (auto &[proc, ppid] : procs) {
+    entries.emplace_back(BackfillEntry{.proc = std::move(proc), .ppid = ppid});
+  }
+  BackfillInsert(entries);
+}
+
 }  // namespace santa::santad::process_tree
@@ -0,0 +1,102 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+#include "Source/santad/ProcessTree/program_pool.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "Source/santad/ProcessTree/process.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa::santad::process_tree {
+
+std::shared_ptr<ProgramPool> ProgramPool::Create() {
+  return std::make_shared<ProgramPool>();
+}
+
+std::shared_ptr<const Program> ProgramPool::Intern(Program prog) {
+  Shard &shard = ShardFor(ProgramHash{}(prog));
+
+  // Most execs run a program that is already interned, which only needs a
+  // shared lock.
+  {
+    absl::ReaderMutexLock lock(&shard.mtx);
+    if (auto it = shard.programs.find(prog); it != shard.programs.end()) {
+      if (auto existing = it->second.lock()) {
+        return existing;
+      }
+    }
+  }
+
+  absl::MutexLock lock(&shard.mtx);
+  if (auto it = shard.programs.find(prog); it != shard.programs.end()) {
+    if (auto existing = it->second.lock()) {
+      return existing;
+    }
+    // The last reference is being dropped concurrently. Replace the entry; the
+    // pending Release will notice it no longer owns the slot.
+    shard.bytes -= ProgramBytes(*it->first);
+    shard.programs.erase(it);
+  }
+
+  const Program *raw = new Program(std::move(prog));
+  std::shared_ptr<const Program> interned(
+      raw, [pool = shared_from_this()](const Program *p) { pool->Release(p); });
+  shard.programs.emplace(raw, interned);
+  shard.bytes += ProgramBytes(*raw);
+  return interned;
+}
+
+void ProgramPool::Release(const Program *p) {
+  {
+    Shard &shard = ShardFor(ProgramHash{}(*p));
+    absl::MutexLock lock(&shard.mtx);
+    if (auto it = shard.programs.find(p);
+        it != shard.programs.end() && it->first == p) {
+      shard.bytes -= ProgramBytes(*p);
+      shard.programs.erase(it);
+    }
+  }
+  delete p;
+}
+
+size_t ProgramPool::Size() const {
+  size_t size = 0;
+  for (const Shard &shard : shards_) {
+    absl::ReaderMutexLock lock(&shard.mtx);
+    size += shard.programs.size();
+  }
+  return size;
+}
+
+size_t ProgramPool::Bytes() const {
+  size_t bytes = 0;
+  for (const Shard &shard : shards_) {
+    absl::ReaderMutexLock lock(&shard.mtx);
+    bytes += shard.bytes;
+  }
+  return bytes;
+}
+
+size_t ProgramPool::ProgramBytes(const Program &p) {
+  size_t bytes = sizeof(Program) + p.executable.capacity() +
+                 p.arguments.capacity() * sizeof(std::string);
+  for (const std::string &arg : p.arguments) {
+    bytes += arg.capacity();
+  }
+  return bytes;
+}
+
+}  // namespace santa::santad::process_tree
@@ -0,0 +1,98 @@
+/// Copyright 2026 North Pole Security, Inc.
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     https://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+#ifndef SANTA__SANTAD_PROCESSTREE_PROGRAM_POOL_H
+#define SANTA__SANTAD_PROCESSTREE_PROGRAM_POOL_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+
+#include "Source/santad/ProcessTree/process.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
+#include "absl/synchronization/mutex.h"
+
+namespace santa::santad::process_tree {
+
+// ProgramPool interns Program objects so that processes running the same
+// executable with the same arguments share a single immutable instance.
+// Entries are owned by the returned shared_ptrs and are dropped from the pool
+// once the last reference goes away, so the pool only grows with the number of
+// distinct live programs. As with the process tree map, the pool is sharded so
+// that concurrent execs of different programs don't contend on a single lock.
+class ProgramPool : public std::enable_shared_from_this<ProgramPool> {
+ public:
+  static std::shared_ptr<ProgramPool> Create();
+
+  ProgramPool() = default;
+  ProgramPool(const ProgramPool &) = delete;
+  ProgramPool &operator=(const ProgramPool &) = delete;
+  ProgramPool(ProgramPool &&) = delete;
+  ProgramPool &operator=(ProgramPool &&) = delete;
+
+  // Return a shared Program equal to prog, reusing a live instance if one
+  // exists.
+  std::shared_ptr<const Program> Intern(Program prog);
+
+  // Number of distinct programs currently in the pool.
+  size_t Size() const;
+
+  // Approximate heap footprint of all programs currently in the pool.
+  size_t Bytes() const;
+
+ private:
+  // Heterogeneous hash/eq so entries keyed by pointer can be looked up by
+  // value.
+  struct ProgramHash {
+    using is_transparent = void;
+    size_t operator()(const Program *p) const { return (*this)(*p); }
+    size_t operator()(const Program &p) const {
+      return absl::HashOf(p.executable, p.arguments);
+    }
+  };
+  struct ProgramEq {
+    using is_transparent = void;
+    bool operator()(const Program *lhs, const Program *rhs) const {
+      return *lhs == *rhs;
+    }
+    bool operator()(const Program *lhs, const Program &rhs) const {
+      return *lhs == rhs;
+    }
+    bool operator()(const Program &lhs, const Program *rhs) const {
+      return lhs == *rhs;
+    }
+  };
+
+  static constexpr size_t kShards = 16;
+
+  struct Shard {
+    mutable absl::Mutex mtx;
+    absl::flat_hash_map<const Program *, std::weak_ptr<const Program>,
+                        ProgramHash, ProgramEq>
+        programs ABSL_GUARDED_BY(mtx);
+    size_t bytes ABSL_GUARDED_BY(mtx) = 0;
+  };
+
+  static size_t ProgramBytes(const Program &p);
+
+  Shard &ShardFor(size_t hash) { return shards_[hash % kShards]; }
+
+  void Release(const Program *p);
+
+  std::array<Shard, kShards> shards_;
+};
+
+}  // namespace santa::santad::process_tree
+
+#endif
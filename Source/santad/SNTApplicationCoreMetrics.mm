@@ -68,6 +68,9 @@ static void RegisterEventLogType(SNTMetricSet *metricSet) {
       case SNTEventLogTypeProtobufStreamZstd:
         [logType set:@"protobufstreamzstd" forFieldValues:@[]];
         break;
+      case SNTEventLogTypeProtobufColumnar:
+        [logType set:@"protobufcolumnar" forFieldValues:@[]];
+        break;
       case SNTEventLogTypeSyslog: [logType set:@"syslog" forFieldValues:@[]]; break;
       case SNTEventLogTypeNull: [logType set:@"null" forFieldValues:@[]]; break;
       case SNTEventLogTypeFilelog: [logType set:@"file" forFieldValues:@[]]; break;
@@ -37,4 +37,9 @@
 
 + (NSString *const)databasePath;
 
+///
+///  Location of the persisted process tree snapshot.
+///
++ (NSString *)processTreeSnapshotPath;
+
 @end
@@ -26,11 +26,16 @@
 static NSString *const kDatabasePath = @"/var/db/santa";
 static NSString *const kRulesDatabaseName = @"rules.db";
 static NSString *const kEventsDatabaseName = @"events.db";
+static NSString *const kProcessTreeSnapshotName = @"process_tree.snapshot";
 
 + (NSString *const)databasePath {
   return kDatabasePath;
 }
 
++ (NSString *)processTreeSnapshotPath {
+  return [kDatabasePath stringByAppendingPathComponent:kProcessTreeSnapshotName];
+}
+
 + (SNTEventTable *)eventTable {
   static SNTEventTable *eventDatabase;
   static dispatch_once_t eventDatabaseToken;
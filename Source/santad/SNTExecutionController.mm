@@ -25,8 +25,8 @@
 #include <utmpx.h>
 
 #include <memory>
-#include <set>
 #include <string>
+#include <string_view>
 #include <utility>
 
 #include "Source/common/BranchPrediction.h"
@@ -55,6 +55,7 @@
 #import "Source/santad/SNTNotificationQueue.h"
 #import "Source/santad/SNTPolicyProcessor.h"
 #import "Source/santad/SNTSyncdQueue.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/synchronization/mutex.h"
 
 using santa::Message;
@@ -65,8 +66,10 @@ using santa::Unit;
 
 static const size_t kMaxAllowedPathLength = MAXPATHLEN - 1;  // -1 to account for null terminator
 
-void UpdateTeamIDFilterLocked(std::set<std::string> &filterSet, NSArray<NSString *> *filter) {
+void UpdateTeamIDFilterLocked(absl::flat_hash_set<std::string> &filterSet,
+                              NSArray<NSString *> *filter) {
   filterSet.clear();
+  filterSet.reserve(filter.count);
 
   for (NSString *prefix in filter) {
     filterSet.insert(santa::NSStringToUTF8String(prefix));
@@ -97,7 +100,7 @@ void UpdatePrefixFilterLocked(std::unique_ptr<PrefixTree<Unit>> &tree,
 @implementation SNTExecutionController {
   std::shared_ptr<TTYWriter> _ttyWriter;
   absl::Mutex _entitlementFilterMutex;
-  std::set<std::string> _entitlementsTeamIDFilter;
+  absl::flat_hash_set<std::string> _entitlementsTeamIDFilter;
   std::unique_ptr<PrefixTree<Unit>> _entitlementsPrefixFilter;
   std::unique_ptr<SantaCache<std::pair<pid_t, int>, bool>> _procSignalCache;
 }
@@ -285,7 +288,8 @@ static NSString *const kPrinterProxyPostMonterey =
 
         absl::ReaderMutexLock lock(&self->_entitlementFilterMutex);
 
-        if (teamID && self->_entitlementsTeamIDFilter.count(std::string(teamID)) > 0) {
+        // Heterogeneous lookup avoids allocating a std::string on every exec.
+        if (teamID && self->_entitlementsTeamIDFilter.contains(std::string_view(teamID))) {
           // Dropping entitlement logging for configured TeamID
           return nil;
         }
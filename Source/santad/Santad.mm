@@ -15,8 +15,11 @@
 
 #include "Source/santad/Santad.h"
 
+#include <signal.h>
+
 #include <cstdlib>
 #include <memory>
+#include <string>
 
 #include "Source/common/PrefixTree.h"
 #import "Source/common/SNTCommonEnums.h"
@@ -59,6 +62,13 @@ using santa::TTYWriter;
 using santa::Unit;
 using santa::WatchItems;
 
+// How often the process tree is checked for processes that exited without the
+// tree being informed.
+static const uint64_t kProcessTreeReconcileIntervalSec = 60;
+// When the process tree is over budget, dead processes still get a grace
+// period, but a follow-up pass evicts them without waiting a full interval.
+static const uint64_t kProcessTreeOverBudgetReconcileDelaySec = 5;
+
 static NSString *ClientModeName(SNTClientMode mode) {
   switch (mode) {
     case SNTClientModeMonitor: return @"Monitor";
@@ -762,6 +772,65 @@ void SantadMain(std::shared_ptr<EndpointSecurityAPI> esapi, std::shared_ptr<Logg
     }
   }
 
+  // Keep the process tree bounded if exit events are missed, and persist it
+  // periodically and on shutdown so annotations survive a restart. SantadMain
+  // never returns, so the dispatch sources live for the lifetime of the daemon.
+  dispatch_source_t process_tree_reconcile_timer = nil;
+  dispatch_source_t process_tree_sigterm_source = nil;
+  if (process_tree) {
+    std::string snapshot_path = [SNTDatabaseController processTreeSnapshotPath].UTF8String;
+    void (^write_snapshot)(void) = ^{
+      if (absl::Status status =
+              santa::santad::process_tree::WriteSnapshot(process_tree->ExportSnapshot(),
+                                                         snapshot_path);
+          !status.ok()) {
+        LOGW(@"Failed to write process tree snapshot: %@", @(status.ToString().c_str()));
+      }
+    };
+
+    dispatch_queue_t process_tree_queue = dispatch_queue_create(
+        "com.northpolesec.santa.daemon.process_tree",
+        dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+
+    process_tree_reconcile_timer =
+        dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, process_tree_queue);
+    dispatch_source_set_timer(
+        process_tree_reconcile_timer,
+        dispatch_time(DISPATCH_TIME_NOW, kProcessTreeReconcileIntervalSec * NSEC_PER_SEC),
+        kProcessTreeReconcileIntervalSec * NSEC_PER_SEC, NSEC_PER_SEC);
+    dispatch_source_set_event_handler(process_tree_reconcile_timer, ^{
+      if (size_t evicted = process_tree->Reconcile(); evicted > 0) {
+        LOGD(@"Evicted %zu dead processes from the process tree", evicted);
+      }
+      if (process_tree->OverBudget()) {
+        dispatch_time_t when = dispatch_time(
+            DISPATCH_TIME_NOW, kProcessTreeOverBudgetReconcileDelaySec * NSEC_PER_SEC);
+        dispatch_after(when, process_tree_queue, ^{
+          if (size_t evicted = process_tree->Reconcile(); evicted > 0) {
+            LOGD(@"Evicted %zu dead processes from the over budget process tree", evicted);
+          }
+        });
+      }
+      write_snapshot();
+    });
+    dispatch_resume(process_tree_reconcile_timer);
+
+    // When launchd stops the daemon, write a final snapshot from the process
+    // tree queue rather than signal context, then re-raise SIGTERM with its
+    // default disposition so the daemon terminates exactly as it otherwise
+    // would. If termination races the write, restoring falls back to the last
+    // periodic snapshot.
+    signal(SIGTERM, SIG_IGN);
+    process_tree_sigterm_source =
+        dispatch_source_create(DISPATCH_SOURCE_TYPE_SIGNAL, SIGTERM, 0, process_tree_queue);
+    dispatch_source_set_event_handler(process_tree_sigterm_source, ^{
+      write_snapshot();
+      signal(SIGTERM, SIG_DFL);
+      raise(SIGTERM);
+    });
+    dispatch_resume(process_tree_sigterm_source);
+  }
+
   // IMPORTANT: ES will hold up third party execs until early boot clients make
   // their first subscription. Ensuring the `Authorizer` client is enabled first
   // means that the AUTH EXEC event is subscribed first and Santa can apply
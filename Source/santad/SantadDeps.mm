@@ -17,6 +17,7 @@
 
 #include <cstdlib>
 #include <memory>
+#include <optional>
 
 #include "Source/common/RingBuffer.h"
 #import "Source/common/SNTExportConfiguration.h"
@@ -24,16 +25,21 @@
 #import "Source/common/SNTMetricSet.h"
 #import "Source/common/SNTStrengthify.h"
 #import "Source/common/SNTXPCControlInterface.h"
+#include "Source/common/String.h"
 #include "Source/common/TelemetryEventMap.h"
 #include "Source/common/faa/WatchItems.h"
 #import "Source/santad/DataLayer/SNTEventTable.h"
 #import "Source/santad/DataLayer/SNTRuleTable.h"
 #include "Source/santad/EventProviders/EndpointSecurity/EndpointSecurityAPI.h"
+#include "Source/santad/Logs/EndpointSecurity/Writers/FSSpool/ZstdLevelController.h"
 #include "Source/santad/ProcessTree/annotations/originator.h"
 #include "Source/santad/ProcessTree/process_tree.h"
 #import "Source/santad/SNTDatabaseController.h"
 #include "Source/santad/SNTDecisionCache.h"
 #include "Source/santad/TTYWriter.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/time/time.h"
 
 using santa::AuthResultCache;
 using santa::Enricher;
@@ -45,6 +51,130 @@ using santa::WatchItems;
 
 namespace santa {
 
+static void RegisterProcessTreeMetrics(
+    SNTMetricSet *metric_set,
+    std::shared_ptr<santa::santad::process_tree::ProcessTree> process_tree) {
+  SNTMetricInt64Gauge *programs =
+      [metric_set int64GaugeWithName:@"/santa/process_tree/programs"
+                          fieldNames:@[]
+                            helpText:@"Number of distinct programs interned by the process tree"];
+  SNTMetricInt64Gauge *programBytes =
+      [metric_set int64GaugeWithName:@"/santa/process_tree/program_bytes"
+                          fieldNames:@[]
+                            helpText:@"Approximate memory used by programs interned by the "
+                                     @"process tree"];
+  SNTMetricInt64Gauge *processes =
+      [metric_set int64GaugeWithName:@"/santa/process_tree/processes"
+                          fieldNames:@[]
+                            helpText:@"Number of processes in the process tree"];
+  SNTMetricInt64Gauge *tombstones =
+      [metric_set int64GaugeWithName:@"/santa/process_tree/tombstones"
+                          fieldNames:@[]
+                            helpText:@"Number of exited processes still retained by the "
+                                     @"process tree"];
+  SNTMetricCounter *evictions =
+      [metric_set counterWithName:@"/santa/process_tree/evictions"
+                       fieldNames:@[]
+                         helpText:@"Number of dead processes evicted from the process tree"];
+  SNTMetricInt64Gauge *backfillDuration =
+      [metric_set int64GaugeWithName:@"/santa/process_tree/backfill_duration_ms"
+                          fieldNames:@[]
+                            helpText:@"Time taken by the most recent process tree backfill, in "
+                                     @"milliseconds"];
+
+  std::weak_ptr<santa::santad::process_tree::ProcessTree> weak_tree = process_tree;
+  __block uint64_t reportedEvictions = 0;
+  [metric_set registerCallback:^{
+    auto tree = weak_tree.lock();
+    if (!tree) {
+      return;
+    }
+
+    santa::santad::process_tree::ProcessTree::Stats stats = tree->GetStats();
+    [processes set:stats.processes forFieldValues:@[]];
+    [tombstones set:stats.tombstones forFieldValues:@[]];
+    [evictions incrementBy:stats.evictions - reportedEvictions forFieldValues:@[]];
+    reportedEvictions = stats.evictions;
+    [programs set:stats.programs forFieldValues:@[]];
+    [programBytes set:stats.program_bytes forFieldValues:@[]];
+    [backfillDuration set:stats.backfill_duration_ms forFieldValues:@[]];
+  }];
+}
+
+static void RegisterLoggerMetrics(SNTMetricSet *metric_set, Logger *logger) {
+  SNTMetricInt64Gauge *queueDepth =
+      [metric_set int64GaugeWithName:@"/santa/logger/queue_depth"
+                          fieldNames:@[]
+                            helpText:@"Number of events waiting to be written by the logger"];
+  SNTMetricCounter *queueDrops =
+      [metric_set counterWithName:@"/santa/logger/queue_drops"
+                       fieldNames:@[]
+                         helpText:@"Number of events dropped because the logger queue was full"];
+  SNTMetricCounter *eventDrops = [metric_set
+      counterWithName:@"/santa/logger/event_drops"
+           fieldNames:@[ @"Event" ]
+             helpText:@"Number of events dropped by the logger under load, by event type"];
+
+  __block uint64_t reportedDrops = 0;
+  __block absl::flat_hash_map<santa::TelemetryEvent, uint64_t> reportedEventDrops;
+  [metric_set registerCallback:^{
+    std::optional<santa::Writer::Stats> stats = logger->GetWriterStats();
+    if (!stats) {
+      return;
+    }
+
+    [queueDepth set:stats->queue_depth forFieldValues:@[]];
+    [queueDrops incrementBy:stats->dropped - reportedDrops forFieldValues:@[]];
+    reportedDrops = stats->dropped;
+
+    for (const auto &[event, dropped] : stats->dropped_by_event) {
+      uint64_t &reported = reportedEventDrops[event];
+      [eventDrops incrementBy:dropped - reported
+               forFieldValues:@[ santa::StringToNSString(santa::TelemetryEventName(event)) ]];
+      reported = dropped;
+    }
+  }];
+
+  SNTMetricInt64Gauge *compressionLevel =
+      [metric_set int64GaugeWithName:@"/santa/logger/compression/level"
+                          fieldNames:@[]
+                            helpText:@"Zstd compression level currently used for spool files"];
+  SNTMetricCounter *compressionBytesIn =
+      [metric_set counterWithName:@"/santa/logger/compression/bytes_in"
+                       fieldNames:@[]
+                         helpText:@"Number of uncompressed bytes written to spool files"];
+  SNTMetricCounter *compressionBytesOut =
+      [metric_set counterWithName:@"/santa/logger/compression/bytes_out"
+                       fieldNames:@[]
+                         helpText:@"Number of compressed bytes written to spool files"];
+  SNTMetricInt64Gauge *compressionThroughput = [metric_set
+      int64GaugeWithName:@"/santa/logger/compression/throughput"
+              fieldNames:@[]
+                helpText:@"Uncompressed bytes compressed per second of compression time, since the "
+                         @"previous export. Not reported when compressing with workers"];
+
+  __block ::fsspool::ZstdLevelController::Stats reportedCompression{};
+  [metric_set registerCallback:^{
+    std::optional<::fsspool::ZstdLevelController::Stats> stats = logger->GetCompressionStats();
+    if (!stats) {
+      return;
+    }
+
+    uint64_t bytesIn = stats->bytes_in - reportedCompression.bytes_in;
+    absl::Duration elapsed = stats->compression_time - reportedCompression.compression_time;
+
+    [compressionLevel set:stats->level forFieldValues:@[]];
+    [compressionBytesIn incrementBy:bytesIn forFieldValues:@[]];
+    [compressionBytesOut incrementBy:stats->bytes_out - reportedCompression.bytes_out
+                      forFieldValues:@[]];
+    if (elapsed > absl::ZeroDuration()) {
+      [compressionThroughput set:(int64_t)(bytesIn / absl::ToDoubleSeconds(elapsed))
+                  forFieldValues:@[]];
+    }
+    reportedCompression = *stats;
+  }];
+}
+
 std::unique_ptr<SantadDeps> SantadDeps::Create(SNTConfigurator *configurator,
                                                SNTMetricSet *metric_set,
                                                santa::ProcessControlBlock processControlBlock) {
@@ -142,12 +272,26 @@ std::unique_ptr<SantadDeps> SantadDeps::Create(SNTConfigurator *configurator,
       [configurator spoolDirectory], spool_dir_threshold_bytes, spool_file_threshold_bytes,
       spool_flush_timeout_ms, telemetry_export_frequency_secs,
       [configurator telemetryExportTimeoutSec], [configurator telemetryExportBatchThresholdSizeMB],
-      [configurator telemetryExportMaxFilesPerBatch]);
+      [configurator telemetryExportMaxFilesPerBatch],
+      {
+          .queue_capacity = [configurator spoolQueueCapacity],
+          .queue_full_policy = [configurator spoolQueueFullPolicy],
+          .zstd_dictionary_path = [configurator spoolZstdDictionaryPath],
+          .zstd_compression_level = static_cast<int>([configurator spoolZstdCompressionLevel]),
+          .zstd_workers = static_cast<int>([configurator spoolZstdWorkers]),
+          .zstd_adaptive_level = static_cast<bool>([configurator spoolZstdAdaptiveLevel]),
+          .zstd_frame_records = [configurator spoolZstdFrameRecords],
+          .zstd_frame_size_kb = [configurator spoolZstdFrameSizeKB],
+          .string_table_encoding = static_cast<bool>([configurator spoolStringTableEncoding]),
+      });
   if (!logger) {
     LOGE(@"Failed to create logger.");
     exit(EXIT_FAILURE);
   }
 
+  // The logger is owned by SantadDeps, which lives for the life of the daemon.
+  RegisterLoggerMetrics(metric_set, logger.get());
+
   // Attempt to create WatchItems from the following data sources with
   // decending order of precedence:
   // 1. Rules stored in the rules database
@@ -205,12 +349,29 @@ std::unique_ptr<SantadDeps> SantadDeps::Create(SNTConfigurator *configurator,
     }
   }
 
-  auto tree_status = santa::santad::process_tree::CreateTree(std::move(annotators));
+  // Restore annotations from the previous run when possible.
+  std::optional<::santa::pb::v1::process_tree::Snapshot> snapshot;
+  if (!annotators.empty()) {
+    auto snapshot_status = santa::santad::process_tree::ReadSnapshot(
+        [SNTDatabaseController processTreeSnapshotPath].UTF8String);
+    if (snapshot_status.ok()) {
+      snapshot = *std::move(snapshot_status);
+    } else if (!absl::IsNotFound(snapshot_status.status())) {
+      LOGW(@"Ignoring process tree snapshot: %@",
+           @(snapshot_status.status().ToString().c_str()));
+    }
+  }
+
+  auto tree_status = santa::santad::process_tree::CreateTree(
+      std::move(annotators), snapshot, [configurator processTreeMaxProcesses]);
   if (!tree_status.ok()) {
     LOGE(@"Failed to create process tree: %@", @(tree_status.status().ToString().c_str()));
     exit(EXIT_FAILURE);
   }
   process_tree = *tree_status;
+  if (process_tree) {
+    RegisterProcessTreeMetrics(metric_set, process_tree);
+  }
 
   return std::make_unique<SantadDeps>(
       esapi, std::move(logger), std::move(metrics), std::move(watch_items),
@@ -375,6 +375,88 @@ changes in the release notes of any future release that changes them.`,
       defaultValue: 10,
       enableIf: (data) => data.EventLogType == "protobuf",
     },
+    {
+      key: "SpoolQueueCapacity",
+      description: `If \`EventLogType\` is set to \`protobuf\`, SpoolQueueCapacity defines the maximum number of
+        events held in memory while waiting to be written to the spool directory`,
+      type: "integer",
+      defaultValue: 65536,
+      enableIf: (data) => data.EventLogType == "protobuf",
+    },
+    {
+      key: "SpoolQueueFullPolicy",
+      description: `If \`EventLogType\` is set to \`protobuf\`, SpoolQueueFullPolicy defines what happens to new events
+        when the spool queue is full. \`drop\` drops new events, \`block\` waits for space in the queue, and
+        \`droplowpriority\` sheds events by priority: fork, exit and close events are dropped first, and
+        execution, file access and security events last. This also applies when the spool is out of space`,
+      type: "string",
+      defaultValue: "drop",
+      possibleValues: [
+        { value: "drop" },
+        { value: "block" },
+        { value: "droplowpriority" },
+      ],
+      enableIf: (data) => data.EventLogType == "protobuf",
+    },
+    {
+      key: "SpoolZstdDictionaryPath",
+      description: `If \`EventLogType\` is set to \`protobufstreamzstd\`, SpoolZstdDictionaryPath is the path to a
+        zstd dictionary used to compress spool files. Files compressed with a dictionary record its ID and can
+        only be decoded with the same dictionary, e.g. \`santactl printlog --zstd-dictionary <path>\``,
+      type: "string",
+    },
+    {
+      key: "SpoolZstdCompressionLevel",
+      description: `If \`EventLogType\` is set to \`protobufstreamzstd\`, SpoolZstdCompressionLevel defines the zstd
+        compression level used for spool files. When \`SpoolZstdAdaptiveLevel\` is enabled, this is the highest
+        level used. If \`EventLogType\` is set to \`protobufcolumnar\`, this is the level used to compress each
+        column`,
+      type: "integer",
+      defaultValue: 3,
+    },
+    {
+      key: "SpoolZstdWorkers",
+      description: `If \`EventLogType\` is set to \`protobufstreamzstd\`, SpoolZstdWorkers defines the number of
+        background threads used to compress spool files. When 0, compression happens as events are spooled`,
+      type: "integer",
+      defaultValue: 0,
+    },
+    {
+      key: "SpoolZstdAdaptiveLevel",
+      description: `If \`EventLogType\` is set to \`protobufstreamzstd\` and this key is true, the compression level is
+        lowered as events back up waiting to be spooled, and raised back towards \`SpoolZstdCompressionLevel\` once
+        the backlog clears`,
+      type: "bool",
+      defaultValue: false,
+    },
+    {
+      key: "SpoolZstdFrameRecords",
+      description: `If \`EventLogType\` is set to \`protobufstreamzstd\` and this key is non-zero, spool files are
+        split into independently decompressible zstd frames of at most this many records, followed by an index of
+        the frames. The files remain valid zstd streams, and readers aware of the index can seek within them by
+        event time. When 0, each spool file is a single frame`,
+      type: "integer",
+      defaultValue: 0,
+    },
+    {
+      key: "SpoolZstdFrameSizeKB",
+      description: `If \`EventLogType\` is set to \`protobufstreamzstd\` and this key is non-zero, spool files are
+        split into independently decompressible zstd frames of roughly this many uncompressed KB, followed by an
+        index of the frames. When combined with \`SpoolZstdFrameRecords\`, frames end at whichever limit is reached
+        first`,
+      type: "integer",
+      defaultValue: 0,
+    },
+    {
+      key: "SpoolStringTableEncoding",
+      description: `If \`EventLogType\` is set to one of the \`protobufstream\` types and this key is true, strings
+        repeated within a spool file, such as paths, team IDs and environment variables, are written once to a
+        per-file table and referenced from later events. This reduces file sizes beyond what compression alone
+        achieves, at some CPU cost. Files are decoded before being exported, and \`santactl printlog\` decodes them
+        transparently`,
+      type: "bool",
+      defaultValue: false,
+    },
     {
       key: "EnableMachineIDDecoration",
       description: `If this key is true, the \`MachineID\` will be added to each log entry.`,